@@ -0,0 +1,638 @@
+	/* Nautical almanac tables */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Hourly Greenwich hour angle and declination of the Sun, Moon,
+ * Aries and the four navigational planets, as in the daily pages of
+ * the Nautical Almanac, with the v and d corrections and horizontal
+ * parallax.
+ *
+ * Positions are apparent: the ephemerides are evaluated at TT, the
+ * planets for light time, then nutation and annual aberration are
+ * applied, and GHA is reckoned from Greenwich apparent sidereal time.
+ * Everything that depends only on the hour (TT, nutation, obliquity,
+ * sidereal time and the Earth's position) is computed once per hour
+ * for all the bodies.  The accuracy is that of the ephemerides:
+ * about 0.01 degrees for the Sun, 10" for the Moon and somewhat
+ * worse for the planets.
+ *
+ * Days are shared out among threads.  v is the hour's change of GHA
+ * beyond the standard rate, 14d19.0' for the Moon and 15d for the
+ * others, and d the hour's change of declination, both in minutes of
+ * arc and signed, tabulated hourly for every body.
+ *
+ * A table saved with AlmanacWrite() can be mapped back with
+ * AlmanacOpen() and queried for any instant it covers.  Queries
+ * interpolate a cubic through the four nearest hours, with GHA taken
+ * relative to its standard rate so that the curve is smooth across
+ * 360 degrees; they need no trig and take well under a microsecond.
+ * Over 2024 the interpolated values are within 0.002' of
+ * almanacPositions(), mostly the rounding of the tables to float.
+ *
+ * void
+ * almanacPositions(double jd, double gha[], double dec[], double hp[])
+ *	GHA, declination and HP of every body at one instant.
+ *
+ * int
+ * AlmanacCompute(double jd0, int ndays, int nthreads, Almanac *alm)
+ *	Tables for ndays days from 0h UT on jd0.
+ *
+ * int
+ * AlmanacWrite(const Almanac *alm, const char *filename)
+ *	Save tables as a binary file.
+ *
+ * int
+ * AlmanacPrint(const Almanac *alm, FILE *ofile)
+ *	Print tables as daily pages.
+ *
+ * int
+ * AlmanacOpen(const char *filename, Almanac *alm)
+ *	Map tables saved by AlmanacWrite().
+ *
+ * int
+ * AlmanacGhaDec(const Almanac *alm, int body, double jd,
+ *		double *gha, double *dec)
+ * int
+ * AlmanacGhaDec_n(const Almanac *alm, int n, const int *body,
+ *		const double *jd, double *gha, double *dec)
+ *	GHA and declination of a body at any instant in the tables.
+ *
+ * void
+ * FreeAlmanac(Almanac *alm)
+ */
+
+#define	ALM_MAGIC	"ALMANAC"
+#define	ALM_VERSION	1
+#define	KAPPA		(20.49552/3600.)	/* constant of aberration, deg */
+#define	SOLAR_PARALLAX	(8.794/60.)		/* arcminutes at 1 AU */
+#define	LIGHT_TIME	0.0057755183		/* days per AU */
+#define	MOON_RATE	(14. + 19./60.)		/* v standard, degrees/hour */
+
+const char *almanacBodies[ALM_NBODIES] = {
+	"Aries", "Sun", "Moon", "Venus", "Mars", "Jupiter", "Saturn",
+} ;
+
+static const PlanetFunc planetFuncs[ALM_NBODIES] = {
+	NULL, NULL, NULL, Venus, Mars, Jupiter, Saturn,
+} ;
+
+/**
+ * Header of an almanac file, followed by nhours+1 rows of
+ * AlmanacEntry, one per body.
+ */
+typedef	struct {
+	  char	magic[8] ;
+	  uint32_t version ;
+	  uint32_t nbodies ;
+	  uint32_t nhours ;
+	  uint32_t pad ;
+	  double jd0 ;
+	} AlmanacHeader ;
+
+
+/**
+ * Apparent ecliptic to equatorial, with GHA from the apparent
+ * sidereal time gast, all degrees.
+ */
+static void
+toGha(double lat, double lon, double ce, double se, double gast,
+	double *gha, double *dec)
+{
+	double	cb = cosd(lat), sb = sind(lat) ;
+	double	cl = cosd(lon), sl = sind(lon) ;
+
+	*dec = asind(sb*ce + cb*se*sl) ;
+	*gha = limitAngle(gast - atan2d(cb*sl*ce - sb*se, cb*cl)) ;
+}
+
+/**
+ * Annual aberration in ecliptic coordinates, ignoring the
+ * eccentricity of the Earth's orbit.  Meeus, ch. 23.
+ */
+static void
+aberration(double *lat, double *lon, double sunlon)
+{
+	double	x = (sunlon - *lon) ;
+	*lon -= KAPPA * cosd(x) / cosd(*lat) ;
+	*lat -= KAPPA * sind(*lat) * sind(x) ;
+}
+
+
+/**
+ * Greenwich hour angle, declination (degrees) and horizontal
+ * parallax (minutes of arc) of each body, ALM_ARIES to ALM_SATURN,
+ * at UT Julian date jd.
+ */
+void
+almanacPositions(double jd, double gha[], double dec[], double hp[])
+{
+	double	jde = convertTime(jd, TS_UT1, TS_TT) ;
+	double	dpsi, deps, eps, ce, se, gast ;
+	double	slat, slon, srad, lat, lon, r, tau ;
+	PlanetState p, earth ;
+	SplitJD	sj ;
+	int	b, k ;
+
+	nutation(&dpsi, &deps, jde) ;
+	dpsi /= 3600. ;
+	eps = obliquity(jde) + deps / 3600. ;
+	ce = cosd(eps) ;
+	se = sind(eps) ;
+	splitJD(jd, &sj) ;
+	gast = splitJD2sidereal(&sj) * 15. + dpsi * ce ;
+
+	gha[ALM_ARIES] = limitAngle(gast) ;
+	dec[ALM_ARIES] = hp[ALM_ARIES] = 0. ;
+
+	/* the Sun, and from it the Earth */
+	SunEcliptic(jde, &slat, &slon, &srad) ;
+	earth.lat = -slat ;
+	earth.lon = slon + 180. ;
+	earth.R = srad ;
+	toGha(slat, slon + dpsi - KAPPA / srad, ce, se, gast,
+		&gha[ALM_SUN], &dec[ALM_SUN]) ;
+	hp[ALM_SUN] = SOLAR_PARALLAX / srad ;
+
+	MoonPrecise(jde, &p) ;
+	toGha(p.lat, p.lon + dpsi, ce, se, gast, &gha[ALM_MOON], &dec[ALM_MOON]) ;
+	hp[ALM_MOON] = p.ad * 60. ;
+
+	for(b = ALM_VENUS; b < ALM_NBODIES; ++b) {
+	  tau = 0. ;
+	  for(k = 0; k < 2; ++k) {		/* light time */
+	    (*planetFuncs[b])(jde - tau, &p) ;
+	    deltaPolar(earth.lat, earth.lon, earth.R, p.lat, p.lon, p.R,
+		&lat, &lon, &r) ;
+	    tau = LIGHT_TIME * r ;
+	  }
+	  aberration(&lat, &lon, slon) ;
+	  toGha(lat, lon + dpsi, ce, se, gast, &gha[b], &dec[b]) ;
+	  hp[b] = SOLAR_PARALLAX / r ;
+	}
+}
+
+
+typedef	struct {
+	  Almanac *alm ;
+} AlmanacJob ;
+
+/**
+ * One day of the tables.  The first hour of the next day is computed
+ * too, for the last hour's v and d, but only the last day writes that
+ * row; otherwise it belongs to the next day's chunk, which may be
+ * running at the same time.
+ */
+static int
+almanacDay(TextChunk *chunk, void *arg)
+{
+	Almanac	*alm = ((AlmanacJob *)arg)->alm ;
+	double	gha[25][ALM_NBODIES], dec[25][ALM_NBODIES], hp[25][ALM_NBODIES] ;
+	double	rate, dg ;
+	int	h0 = chunk->index * 24 ;
+	int	nh = alm->nhours - h0 < 24 ? alm->nhours - h0 : 24 ;
+	int	last = h0 + nh == alm->nhours ? nh : nh-1 ;	/* last row written */
+	int	h, b ;
+
+	for(h = 0; h <= nh; ++h)
+	  almanacPositions(alm->jd0 + (h0 + h) / 24., gha[h], dec[h], hp[h]) ;
+
+	for(h = 0; h <= last; ++h)
+	  for(b = 0; b < ALM_NBODIES; ++b) {
+	    AlmanacEntry *e = &alm->rows[(size_t)(h0 + h) * ALM_NBODIES + b] ;
+	    e->gha = gha[h][b] ;
+	    e->dec = dec[h][b] ;
+	    e->hp = hp[h][b] ;
+	    if( h == nh )
+	      continue ;		/* trailing row, v and d stay zero */
+	    rate = b == ALM_MOON ? MOON_RATE : 15. ;
+	    dg = limitAngleSigned(gha[h+1][b] - gha[h][b] - rate) ;
+	    e->v = dg * 60. ;
+	    e->d = (dec[h+1][b] - dec[h][b]) * 60. ;
+	  }
+	return 0 ;
+}
+
+
+/**
+ * Compute almanac tables for ndays days from jd0 (UT, taken back to
+ * 0h) on nthreads threads (numThreads() if <= 0).  The table has
+ * one more row, 0h after the last day, whose v and d are zero.
+ * @return 0, or -1 on error.
+ */
+int
+AlmanacCompute(double jd0, int ndays, int nthreads, Almanac *alm)
+{
+	AlmanacJob job ;
+	TextChunk *chunks ;
+	int	i, rval ;
+
+	memset(alm, 0, sizeof(*alm)) ;
+	if( ndays <= 0 )
+	  return -1 ;
+	alm->jd0 = floor(jd0 - .5) + .5 ;
+	alm->nhours = ndays * 24 ;
+	alm->rows = calloc((size_t)(alm->nhours + 1) * ALM_NBODIES,
+		sizeof(AlmanacEntry)) ;
+	chunks = calloc(ndays, sizeof(*chunks)) ;
+	if( alm->rows == NULL || chunks == NULL ) {
+	  free(chunks) ;
+	  FreeAlmanac(alm) ;
+	  return -1 ;
+	}
+	for(i = 0; i < ndays; ++i)
+	  chunks[i].index = i ;
+	job.alm = alm ;
+	rval = runTextChunks(chunks, ndays, nthreads, almanacDay, &job) ;
+	free(chunks) ;
+	if( rval != 0 )
+	  FreeAlmanac(alm) ;
+	return rval ;
+}
+
+
+void
+FreeAlmanac(Almanac *alm)
+{
+	if( alm->map != NULL )
+	  munmap(alm->map, alm->mapsize) ;
+	else
+	  free(alm->rows) ;
+	memset(alm, 0, sizeof(*alm)) ;
+}
+
+
+/**
+ * Write almanac tables to a binary file, in the machine's byte order.
+ * @return 0 on success, -1 on error.
+ */
+int
+AlmanacWrite(const Almanac *alm, const char *filename)
+{
+	AlmanacHeader h ;
+	size_t	n = (size_t)(alm->nhours + 1) * ALM_NBODIES ;
+	FILE	*ofile ;
+	int	ok ;
+
+	if( (ofile = fopen(filename, "w")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+	memset(&h, 0, sizeof(h)) ;
+	memcpy(h.magic, ALM_MAGIC, sizeof(h.magic)) ;
+	h.version = ALM_VERSION ;
+	h.nbodies = ALM_NBODIES ;
+	h.nhours = alm->nhours ;
+	h.jd0 = alm->jd0 ;
+	ok = fwrite(&h, sizeof(h), 1, ofile) == 1 &&
+	  fwrite(alm->rows, sizeof(AlmanacEntry), n, ofile) == n ;
+	if( fclose(ofile) != 0 )
+	  ok = 0 ;
+	if( !ok )
+	  perror(filename) ;
+	return ok ? 0 : -1 ;
+}
+
+
+/**
+ * Map an almanac file written by AlmanacWrite().  The tables are
+ * read-only.
+ * @return number of hours, or -1 on error.
+ */
+int
+AlmanacOpen(const char *filename, Almanac *alm)
+{
+	const AlmanacHeader *h ;
+	struct stat st ;
+	char	*ptr ;
+	int	fd ;
+
+	memset(alm, 0, sizeof(*alm)) ;
+
+	if( (fd = open(filename, O_RDONLY)) < 0 ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+	if( fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*h) ) {
+	  fprintf(stderr, "%s: not an almanac\n", filename) ;
+	  close(fd) ;
+	  return -1 ;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) ;
+	close(fd) ;
+	if( ptr == MAP_FAILED ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	h = (const AlmanacHeader *)ptr ;
+	if( memcmp(h->magic, ALM_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->version != ALM_VERSION || h->nbodies != ALM_NBODIES ||
+	    h->nhours < 3 || h->nhours > INT32_MAX / ALM_NBODIES ||
+	    sizeof(*h) + ((size_t)h->nhours + 1) * ALM_NBODIES *
+		sizeof(AlmanacEntry) > (size_t)st.st_size )
+	{
+	  fprintf(stderr, "%s: not an almanac\n", filename) ;
+	  munmap(ptr, st.st_size) ;
+	  return -1 ;
+	}
+
+	alm->map = ptr ;
+	alm->mapsize = st.st_size ;
+	alm->jd0 = h->jd0 ;
+	alm->nhours = h->nhours ;
+	alm->rows = (AlmanacEntry *)(ptr + sizeof(*h)) ;
+	return alm->nhours ;
+}
+
+
+/**
+ * Cubic through hours k-1 .. k+2 of one body, at x hours past k.
+ * GHA is interpolated as its difference from the standard rate,
+ * which is small and continuous.
+ */
+static inline void
+interpolate4(const AlmanacEntry *e, double x, double rate,
+	double *gha, double *dec)
+{
+	const int step = ALM_NBODIES ;
+	double	g0 = e[0].gha ;
+	double	wm = -x * (x - 1.) * (x - 2.) * (1./6.) ;
+	double	w0 = (x + 1.) * (x - 1.) * (x - 2.) * .5 ;
+	double	w1 = -(x + 1.) * x * (x - 2.) * .5 ;
+	double	w2 = (x + 1.) * x * (x - 1.) * (1./6.) ;
+	double	rm = limitAngleSigned(e[-step].gha - g0 + rate) ;
+	double	r1 = limitAngleSigned(e[step].gha - g0 - rate) ;
+	double	r2 = limitAngleSigned(e[2*step].gha - g0 - 2.*rate) ;
+
+	*gha = limitAngle(g0 + rate*x + wm*rm + w1*r1 + w2*r2) ;
+	*dec = wm*e[-step].dec + w0*e[0].dec + w1*e[step].dec + w2*e[2*step].dec ;
+}
+
+/**
+ * GHA and declination (degrees) of body ALM_ARIES .. ALM_SATURN at
+ * UT Julian date jd, interpolated from the tables.
+ * @return 0, or -1 if jd or body is outside the tables.
+ */
+int
+AlmanacGhaDec(const Almanac *alm, int body, double jd,
+	double *gha, double *dec)
+{
+	double	t = (jd - alm->jd0) * 24. ;
+	int	k ;
+
+	if( !(t >= 0. && t <= alm->nhours) || body < 0 || body >= ALM_NBODIES )
+	  return -1 ;
+	/* the four hours around t, shifted inside the table at the ends */
+	k = (int)t ;
+	k = k < 1 ? 1 : k > alm->nhours - 2 ? alm->nhours - 2 : k ;
+	interpolate4(&alm->rows[(size_t)k * ALM_NBODIES + body], t - k,
+		body == ALM_MOON ? MOON_RATE : 15., gha, dec) ;
+	return 0 ;
+}
+
+/**
+ * AlmanacGhaDec() for n (body, time) pairs.
+ * @return the number of pairs outside the tables; their gha and dec
+ * are NaN.
+ */
+int
+AlmanacGhaDec_n(const Almanac *alm, int n, const int *body,
+	const double *jd, double *gha, double *dec)
+{
+	int	i, bad = 0 ;
+
+	for(i = 0; i < n; ++i)
+	  if( AlmanacGhaDec(alm, body[i], jd[i], &gha[i], &dec[i]) < 0 ) {
+	    gha[i] = dec[i] = NAN ;
+	    ++bad ;
+	  }
+	return bad ;
+}
+
+
+/**
+ * Degrees and minutes to 0.1', as the almanac prints them.
+ */
+static void
+dm(double a, int *d, double *m)
+{
+	long	t = lround(fabs(a) * 600.) ;
+	*d = t / 600 ;
+	*m = (t % 600) / 10. ;
+}
+
+static void
+printGha(FILE *ofile, double a)
+{
+	int	d ;
+	double	m ;
+	dm(a, &d, &m) ;
+	fprintf(ofile, " %3d %04.1f", d % 360, m) ;
+}
+
+static void
+printDec(FILE *ofile, double a)
+{
+	int	d ;
+	double	m ;
+	dm(a, &d, &m) ;
+	fprintf(ofile, " %c%2d %04.1f", a < 0. ? 'S' : 'N', d, m) ;
+}
+
+/**
+ * Print the tables as daily pages: Aries and the planets, then the
+ * Sun and Moon, with GHA and declination to 0.1' and, as in the
+ * almanac, the planets' v and d for the middle of the day.
+ * @return 0, or -1 on a write error.
+ */
+int
+AlmanacPrint(const Almanac *alm, FILE *ofile)
+{
+	const AlmanacEntry *row, *e ;
+	int	day, h, b, y, m, d ;
+
+	for(day = 0; day * 24 < alm->nhours; ++day) {
+	  julian2date(alm->jd0 + day, &y, &m, &d) ;
+	  fprintf(ofile, "%s%04d-%02d-%02d\n\n UT   ARIES  ",
+		day > 0 ? "\f" : "", y, m, d) ;
+	  for(b = ALM_VENUS; b < ALM_NBODIES; ++b)
+	    fprintf(ofile, "  %-18s", almanacBodies[b]) ;
+	  fprintf(ofile, "\n       GHA   ") ;
+	  for(b = ALM_VENUS; b < ALM_NBODIES; ++b)
+	    fprintf(ofile, "     GHA      Dec  ") ;
+	  fputc('\n', ofile) ;
+	  for(h = 0; h < 24 && day*24 + h < alm->nhours; ++h) {
+	    row = alm->rows + (size_t)(day*24 + h) * ALM_NBODIES ;
+	    fprintf(ofile, " %2d", h) ;
+	    printGha(ofile, row[ALM_ARIES].gha) ;
+	    for(b = ALM_VENUS; b < ALM_NBODIES; ++b) {
+	      fputs("  ", ofile) ;
+	      printGha(ofile, row[b].gha) ;
+	      printDec(ofile, row[b].dec) ;
+	    }
+	    fputc('\n', ofile) ;
+	  }
+	  row = alm->rows + (size_t)(day*24 + 12) * ALM_NBODIES ;
+	  if( day*24 + 12 < alm->nhours ) {
+	    fprintf(ofile, "             ") ;
+	    for(b = ALM_VENUS; b < ALM_NBODIES; ++b)
+	      fprintf(ofile, "  v%5.1f   d%5.1f  ", row[b].v, fabs(row[b].d)) ;
+	    fputc('\n', ofile) ;
+	  }
+
+	  fprintf(ofile, "\n UT  SUN                   MOON\n"
+		"       GHA      Dec          GHA     v      Dec     d     HP\n") ;
+	  for(h = 0; h < 24 && day*24 + h < alm->nhours; ++h) {
+	    row = alm->rows + (size_t)(day*24 + h) * ALM_NBODIES ;
+	    fprintf(ofile, " %2d", h) ;
+	    printGha(ofile, row[ALM_SUN].gha) ;
+	    printDec(ofile, row[ALM_SUN].dec) ;
+	    e = &row[ALM_MOON] ;
+	    fputs("  ", ofile) ;
+	    printGha(ofile, e->gha) ;
+	    fprintf(ofile, " %4.1f", e->v) ;
+	    printDec(ofile, e->dec) ;
+	    fprintf(ofile, " %4.1f %5.1f\n", fabs(e->d), e->hp) ;
+	  }
+	  fputc('\n', ofile) ;
+	}
+	return ferror(ofile) ? -1 : 0 ;
+}
+
+
+
+#ifdef	STANDALONE
+
+#include <time.h>
+
+static	char	usage[] =
+"almanac - hourly GHA and declination for a year\n"
+"\n"
+"  usage:  almanac [options] year\n"
+"	-o file	write the binary table to file\n"
+"	-q	don't print the daily pages\n"
+"	-t n	use n threads\n"
+"\n"
+"          almanac -c file\n"
+"	time queries of a saved table and check them against\n"
+"	almanacPositions()\n"
+;
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+#define	NQUERY	1000000
+#define	NCHECK	20000
+
+static int
+check(const char *filename)
+{
+	Almanac	alm ;
+	static	int	body[NQUERY] ;
+	static	double	jd[NQUERY], gha[NQUERY], dec[NQUERY] ;
+	double	g[ALM_NBODIES], d[ALM_NBODIES], hp[ALM_NBODIES] ;
+	double	worstg[ALM_NBODIES], worstd[ALM_NBODIES], e, t0, t1 ;
+	int	i, b ;
+
+	if( AlmanacOpen(filename, &alm) < 0 )
+	  return 1 ;
+	srand(1) ;
+	for(i = 0; i < NQUERY; ++i) {
+	  body[i] = rand() % ALM_NBODIES ;
+	  jd[i] = alm.jd0 + rand() / (RAND_MAX + 1.) * alm.nhours / 24. ;
+	}
+	t0 = now() ;
+	AlmanacGhaDec_n(&alm, NQUERY, body, jd, gha, dec) ;
+	t1 = now() ;
+	printf("%d queries, %.1f ns each\n", NQUERY, (t1 - t0) / NQUERY * 1e9) ;
+
+	memset(worstg, 0, sizeof(worstg)) ;
+	memset(worstd, 0, sizeof(worstd)) ;
+	t0 = now() ;
+	for(i = 0; i < NCHECK; ++i) {
+	  almanacPositions(jd[i], g, d, hp) ;
+	  for(b = 0; b < ALM_NBODIES; ++b) {
+	    AlmanacGhaDec(&alm, b, jd[i], &gha[i], &dec[i]) ;
+	    e = fabs(limitAngleSigned(gha[i] - g[b])) * 60. ;
+	    worstg[b] = e > worstg[b] ? e : worstg[b] ;
+	    e = fabs(dec[i] - d[b]) * 60. ;
+	    worstd[b] = e > worstd[b] ? e : worstd[b] ;
+	  }
+	}
+	t1 = now() ;
+	printf("almanacPositions(), %.1f us for all bodies\n",
+		(t1 - t0) / NCHECK * 1e6) ;
+	printf("largest error, arcminutes:\n") ;
+	for(b = 0; b < ALM_NBODIES; ++b)
+	  printf("  %-8s GHA %.4f  Dec %.4f\n", almanacBodies[b],
+		worstg[b], worstd[b]) ;
+	FreeAlmanac(&alm) ;
+	return 0 ;
+}
+
+int
+main(int argc, char **argv)
+{
+	Almanac	alm ;
+	const char *ofilename = NULL ;
+	int	quiet = 0, nthreads = 0, year = 0 ;
+	double	jd0, t0, t1 ;
+
+	while( --argc > 0 ) {
+	  ++argv ;
+	  if( strcmp(*argv, "-o") == 0 && argc > 1 )
+	    ofilename = *++argv, --argc ;
+	  else if( strcmp(*argv, "-t") == 0 && argc > 1 )
+	    nthreads = atoi(*++argv), --argc ;
+	  else if( strcmp(*argv, "-q") == 0 )
+	    quiet = 1 ;
+	  else if( strcmp(*argv, "-c") == 0 && argc == 2 )
+	    exit(check(argv[1])) ;
+	  else if( **argv != '-' && year == 0 && (year = atoi(*argv)) != 0 )
+	    ;
+	  else {
+	    fputs(usage, stderr) ;
+	    exit(2) ;
+	  }
+	}
+	if( year == 0 ) {
+	  fputs(usage, stderr) ;
+	  exit(2) ;
+	}
+
+	jd0 = date2julian(year, 1, 1) ;
+	t0 = now() ;
+	if( AlmanacCompute(jd0, (int)(date2julian(year+1, 1, 1) - jd0),
+		nthreads, &alm) < 0 ) {
+	  fprintf(stderr, "almanac: out of memory\n") ;
+	  exit(1) ;
+	}
+	t1 = now() ;
+	fprintf(stderr, "%d hours computed in %.1f ms\n",
+		alm.nhours, (t1 - t0) * 1e3) ;
+
+	if( ofilename != NULL && AlmanacWrite(&alm, ofilename) < 0 )
+	  exit(1) ;
+	if( !quiet && AlmanacPrint(&alm, stdout) < 0 )
+	  exit(1) ;
+	FreeAlmanac(&alm) ;
+	exit(0) ;
+}
+
+#endif	/* STANDALONE */
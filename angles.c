@@ -0,0 +1,308 @@
+	/* Reduction of angles to a standard range */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Every reduction here is x - P*floor(x/P), followed by adding or
+ * subtracting P once if rounding in x/P put the result just outside
+ * the range.  That takes the same time for any argument, has no
+ * branches the compiler can't turn into selects, and is exact: for
+ * |x| >= 2P the subtraction is exact (Sterbenz), so the only rounding
+ * is of the final result.  The array forms vectorize when built with
+ * -O3 -fno-math-errno -fno-trapping-math for a target with vector
+ * rounding (e.g. -msse4.1); the default build runs them scalar.
+ *
+ * For radians, 2 pi is split into a leading part with 32 significant
+ * bits, so k * TWOPI_HI is exact for |k| < 2^21 (13 million radians),
+ * and the remainder.
+ *
+ * NaN and infinities give NaN.
+ *
+ * double
+ * limitAngle(double a)		[0, 360)
+ * double
+ * limitAngleSigned(double a)	[-180, 180)
+ * double
+ * limitHour(double h)		[0, 24)
+ * double
+ * limitHourSigned(double h)	[-12, 12)
+ * double
+ * limitRadians(double r)	[0, 2 pi)
+ * double
+ * limitRadiansSigned(double r)	[-pi, pi)
+ *	Reduce one angle.
+ *
+ * void
+ * limitAngles_n(int n, const double *in, double *out, int range)
+ *	Reduce an array of angles to one of the ranges above.
+ */
+
+#define	TWOPI		6.283185307179586
+#define	TWOPI_HI	6.2831853069365025	/* 0x401921fb54400000 */
+#define	TWOPI_LO	2.430840202602477e-10
+
+
+static inline double
+reduce(double x, double p, double rp)
+{
+	double	r = x - p * floor(x * rp) ;
+
+	r = r < 0. ? r + p : r ;
+	return r >= p ? r - p : r ;
+}
+
+static inline double
+reduceSigned(double x, double p, double rp)
+{
+	double	r = x - p * floor(x * rp + .5) ;
+
+	r = r < -.5*p ? r + p : r ;
+	return r >= .5*p ? r - p : r ;
+}
+
+static inline double
+reduceRadians(double x, double half)
+{
+	double	k = floor(x * (1./TWOPI) + half) ;
+	double	r = (x - k * TWOPI_HI) - k * TWOPI_LO ;
+	double	lo = -half * TWOPI ;
+
+	r = r < lo ? r + TWOPI : r ;
+	return r >= lo + TWOPI ? r - TWOPI : r ;
+}
+
+
+/**
+ * Return a % 360, in [0, 360)
+ */
+double
+limitAngle(double a)
+{
+	return reduce(a, 360., 1./360.) ;
+}
+
+/**
+ * Return a % 360, in [-180, 180)
+ */
+double
+limitAngleSigned(double a)
+{
+	return reduceSigned(a, 360., 1./360.) ;
+}
+
+/**
+ * Return h % 24, in [0, 24)
+ */
+double
+limitHour(double h)
+{
+	return reduce(h, 24., 1./24.) ;
+}
+
+/**
+ * Return h % 24, in [-12, 12)
+ */
+double
+limitHourSigned(double h)
+{
+	return reduceSigned(h, 24., 1./24.) ;
+}
+
+/**
+ * Return r % 2pi, in [0, 2pi)
+ */
+double
+limitRadians(double r)
+{
+	return reduceRadians(r, 0.) ;
+}
+
+/**
+ * Return r % 2pi, in [-pi, pi)
+ */
+double
+limitRadiansSigned(double r)
+{
+	return reduceRadians(r, .5) ;
+}
+
+
+/**
+ * Reduce n angles to a range: ANGLE_DEG, ANGLE_DEG_SIGNED, ANGLE_HOUR,
+ * ANGLE_HOUR_SIGNED, ANGLE_RAD or ANGLE_RAD_SIGNED.  out may be the
+ * same array as in.
+ */
+void
+limitAngles_n(int n, const double *in, double *out, int range)
+{
+	int	i ;
+
+	switch( range ) {
+	  case ANGLE_DEG:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduce(in[i], 360., 1./360.) ;
+	    break ;
+	  case ANGLE_DEG_SIGNED:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduceSigned(in[i], 360., 1./360.) ;
+	    break ;
+	  case ANGLE_HOUR:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduce(in[i], 24., 1./24.) ;
+	    break ;
+	  case ANGLE_HOUR_SIGNED:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduceSigned(in[i], 24., 1./24.) ;
+	    break ;
+	  case ANGLE_RAD:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduceRadians(in[i], 0.) ;
+	    break ;
+	  case ANGLE_RAD_SIGNED:
+	    for(i = 0; i < n; ++i)
+	      out[i] = reduceRadians(in[i], .5) ;
+	    break ;
+	}
+}
+
+
+
+#ifdef	STANDALONE
+
+/*
+ * Benchmark: the mean longitudes of the Moon and Sun over 10,000
+ * years either side of J2000, reduced by the loops and recursion this
+ * file replaced, by limitAngle() and by limitAngles_n(), checked
+ * against fmod().
+ */
+
+#include <string.h>
+#include <time.h>
+
+static	char	usage[] =
+"angles - benchmark angle reduction\n"
+"\n"
+"  usage:  angles [n]\n"
+"	n	number of angles, default 1000000\n"
+;
+
+static void
+oldRange(double *x)
+{
+	while( *x < 0. ) *x += 360. ;
+	if( *x >= 360. ) *x -= (int)*x/360*360 ;
+}
+
+static double
+oldLimitAngle(double a)
+{
+	if( a >= 360 ) {
+	  int ia = a;
+	  a -= ia;
+	  return ia % 360 + a;
+	} else if( a < 0 ) {
+	  return 360 - oldLimitAngle(-a);
+	}
+	return a;
+}
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+/**
+ * Largest difference from fmod(), allowing for results that fall
+ * either side of 0 = 360.
+ */
+static double
+check(int n, const double *in, const double *out, int *bad)
+{
+	double	worst = 0., ref, d ;
+	int	i ;
+
+	*bad = 0 ;
+	for(i = 0; i < n; ++i) {
+	  ref = fmod(in[i], 360.) ;
+	  if( ref < 0. ) ref += 360. ;
+	  d = fabs(out[i] - ref) ;
+	  if( d > 180. ) d = fabs(d - 360.) ;
+	  if( !(out[i] >= 0. && out[i] < 360.) ) ++*bad ;
+	  if( d > worst ) worst = d ;
+	}
+	return worst ;
+}
+
+int
+main(int argc, char **argv)
+{
+	double	*in, *out, t0, worst ;
+	int	n = 1000000, nold, i, bad ;
+
+	if( argc > 2 || (argc == 2 && (n = atoi(argv[1])) <= 0) ) {
+	  fputs(usage, stderr) ;
+	  exit(2) ;
+	}
+	in = malloc(n * sizeof(double)) ;
+	out = malloc(n * sizeof(double)) ;
+	if( in == NULL || out == NULL ) {
+	  perror("angles") ;
+	  exit(1) ;
+	}
+
+	srand(1) ;
+	for(i = 0; i < n; ++i) {
+	  double T = (rand() / (RAND_MAX + 1.) - .5) * 200. ;	/* centuries */
+	  in[i] = i & 1 ? 218.3164477 + 481267.88123421 * T :
+			  280.46646 + 36000.76983 * T ;
+	}
+	printf("%d angles, |a| up to %.3g degrees\n", n, 218. + 481268. * 100.) ;
+
+	/* the old loop takes time in proportion to the angle; a sample */
+	nold = n < 2000 ? n : 2000 ;
+	t0 = now() ;
+	for(i = 0; i < nold; ++i) {
+	  out[i] = in[i] ;
+	  oldRange(&out[i]) ;
+	}
+	printf("range() loop      %10.1f ns/angle\n", (now()-t0) / nold * 1e9) ;
+
+	t0 = now() ;
+	for(i = 0; i < n; ++i)
+	  out[i] = oldLimitAngle(in[i]) ;
+	printf("old limitAngle()  %10.1f ns/angle", (now()-t0) / n * 1e9) ;
+	worst = check(n, in, out, &bad) ;
+	printf(", worst %.3g, %d out of range\n", worst, bad) ;
+
+	t0 = now() ;
+	for(i = 0; i < n; ++i)
+	  out[i] = fmod(in[i], 360.) ;
+	printf("fmod()            %10.1f ns/angle\n", (now()-t0) / n * 1e9) ;
+
+	t0 = now() ;
+	for(i = 0; i < n; ++i)
+	  out[i] = limitAngle(in[i]) ;
+	printf("limitAngle()      %10.1f ns/angle", (now()-t0) / n * 1e9) ;
+	worst = check(n, in, out, &bad) ;
+	printf(", worst %.3g, %d out of range\n", worst, bad) ;
+
+	t0 = now() ;
+	limitAngles_n(n, in, out, ANGLE_DEG) ;
+	printf("limitAngles_n()   %10.1f ns/angle", (now()-t0) / n * 1e9) ;
+	worst = check(n, in, out, &bad) ;
+	printf(", worst %.3g, %d out of range\n", worst, bad) ;
+
+	free(in) ;
+	free(out) ;
+	exit(0) ;
+}
+
+#endif	/* STANDALONE */
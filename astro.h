@@ -263,6 +263,8 @@
 
 
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #ifndef	HIGH_PRECISION
 #define	HIGH_PRECISION	1
@@ -273,6 +275,8 @@
 #define	JD2000	2451545.0		/* Jan 0.5, 2000 */
 #define	JDUnix	2440587.5		/* Unix epoch: Jan 0.0 1970 */
 
+#define	AU_KMS_YR	4.740470446	/* 1 AU/year in km/s */
+
 #define	EarthTilt	23.439291111	/* degrees, epoch JD2000 */
 
 #define	RAD	(M_PI/180.)
@@ -347,6 +351,114 @@ typedef	struct {
 	  int	yale_cat;	/* Yale catalog # */
 	} YaleStar ;
 
+/**
+ * The result of LoadYaleCatalog().  The catalog owns all of its
+ * memory: the records are one block and the star names all live
+ * in one string pool.  FreeYaleCatalog() releases everything.
+ */
+typedef	struct {
+	  YaleStar *stars ;	/* star records */
+	  int	count ;		/* number of records */
+	  char	*names ;	/* string pool, all names */
+	  size_t namesize ;	/* bytes used in the pool */
+	} YaleCatalog ;
+
+/**
+ * Compact form of a catalog star, 24 bytes instead of the 80 of a
+ * YaleStar, for scanning large catalogs.  Positions are fixed point
+ * with 2^32 units per circle (0.0003"), so the whole sky can be
+ * filtered with integer compares.  Names and SAO numbers are held
+ * outside the record by StarCatalog; see catalog.c.
+ */
+typedef	struct {
+	  uint32_t ra ;		/* right ascension, CU_PER_DEG units */
+	  int32_t dec ;		/* declination, CU_PER_DEG units */
+	  uint32_t cat ;	/* catalog #, e.g. Yale */
+	  int16_t mag ;		/* magnitude * 1000 */
+	  int16_t pmr ;		/* proper motion, right ascension, mas/year */
+	  int16_t pmd ;		/* proper motion, declination, mas/year */
+	  uint16_t name ;	/* index into catalog name table, 0 = none */
+	  uint8_t type ;	/* index into starTypes[] */
+	  uint8_t spec ;	/* spectral class, e.g. 'K' */
+	  uint8_t cons ;	/* index into constellations[], 0 = unknown */
+	  uint8_t epoch ;	/* epoch - 1900 */
+	} CompactStar ;
+
+#define	CU_PER_DEG	(4294967296./360.)	/* compact units per degree */
+
+/**
+ * Size and orientation of a deep-sky object, kept beside its
+ * CompactStar record; see StarCatalogAddDSO().
+ */
+typedef	struct {
+	  uint16_t major ;	/* major axis, arcminutes * 10, 0 = unknown */
+	  uint16_t minor ;	/* minor axis, arcminutes * 10 */
+	  int16_t pa ;		/* position angle of major axis, degrees
+				 * east of north, -1 = unknown */
+	  uint16_t messier ;	/* Messier #, or 0 */
+	} DsoShape ;
+
+/**
+ * The fastest motion among the stars of a sky cell, so a query at
+ * another epoch knows how far outside its box to look.
+ */
+typedef	struct {
+	  uint32_t pm ;		/* largest |pmr|+|pmd|, mas/yr */
+	  uint32_t drift ;	/* largest (|pmr|+|pmd|) * |epoch-2000|, mas */
+	} CellMotion ;
+
+/**
+ * A catalog of CompactStar records.  Like YaleCatalog, it owns all
+ * of its memory; FreeStarCatalog() releases everything.
+ *
+ * Once StarCatalogIndex() has been called, the records are sorted
+ * by sky cell and by magnitude within each cell, cells[] gives the
+ * first record of each cell, and the lookup tables for
+ * StarCatalogFind() and friends are built.  A catalog opened from a
+ * file with StarCatalogOpen() is a read-only memory map of that file.
+ */
+typedef	struct {
+	  CompactStar *stars ;	/* star records */
+	  int	count ;		/* number of records */
+	  uint32_t *sao ;	/* SAO numbers, parallel to stars */
+	  DsoShape *shape ;	/* parallel to stars, or NULL if no DSOs */
+	  char	*names ;	/* string pool, all names */
+	  size_t namesize ;	/* bytes used in the pool */
+	  uint32_t *nameoff ;	/* offset of each name in the pool */
+	  int	nnames ;	/* entries in nameoff, including unused [0] */
+	  int32_t *zones ;	/* first cell of each declination zone */
+	  int32_t *cells ;	/* first record of each cell, or NULL */
+	  int	ncells ;	/* number of cells */
+	  CellMotion *motion ;	/* per cell; [ncells] is the whole catalog */
+	  int32_t *cathash ;	/* hash of catalog #, see StarCatalogFind() */
+	  uint32_t ncathash ;	/* slots in cathash, a power of 2 */
+	  int32_t *saohash ;	/* hash of SAO #, or NULL */
+	  uint32_t nsaohash ;
+	  int32_t *byname ;	/* named stars, sorted by name */
+	  int	nbyname ;
+	  int	nalloc ;	/* records allocated, see StarCatalogAdd() */
+	  size_t namealloc ;	/* bytes allocated for names */
+	  int	nnamealloc ;	/* entries allocated for nameoff */
+	  void	*map ;		/* file mapping, if opened from a file */
+	  size_t mapsize ;
+	} StarCatalog ;
+
+#define	CAT_ZONES	180	/* one-degree declination zones */
+
+/* Tycho catalog numbers TYC1-TYC2-TYC3 packed into CompactStar.cat */
+#define	TYC_NUMBER(t1,t2,t3)	((uint32_t)(t1)<<17 | (uint32_t)(t2)<<3 | (t3))
+#define	TYC1(n)			((n)>>17)
+#define	TYC2(n)			(((n)>>3) & 0x3fff)
+#define	TYC3(n)			((n) & 7)
+
+/* NGC and IC numbers in CompactStar.cat, tagged in the top two bits
+ * so they can't be taken for HR, HIP or Tycho numbers */
+#define	DSO_NGC(n)		((uint32_t)(n) | 0xc0000000u)
+#define	DSO_IC(n)		((uint32_t)(n) | 0x80000000u)
+#define	DSO_ISDSO(n)		(((n) & 0x80000000u) != 0)
+#define	DSO_ISIC(n)		(((n) & 0xc0000000u) == 0x80000000u)
+#define	DSO_NUM(n)		((n) & 0x3fffffff)
+
 	/* types */
 
 /* CG-Glob.Cluster	CO-Open  Cluster	 GC-Galac.Cluster
@@ -373,12 +485,46 @@ typedef	struct {
 
 
 
+	/* parseJulian() errors */
+#define	TIME_SYNTAX	1		/* not a date/time */
+#define	TIME_RANGE	2		/* a field out of range */
+
+/**
+ * A Julian date in two parts, for times finer than a double can carry
+ * (about 40 microseconds at current dates).  day is the integer JD at
+ * noon that starts the Julian day, frac the fraction of a day since,
+ * 0 <= frac < 1; frac has a resolution of about a picosecond.
+ */
+typedef	struct {
+	  int32_t day ;
+	  double frac ;
+	} SplitJD ;
+
+
+/**
+ * Sidereal time at evenly spaced times, see siderealSeriesInit()
+ */
+typedef	struct {
+	  SplitJD jd ;		/* start of the current stretch, UT */
+	  double step ;		/* days */
+	  int	apparent ;
+	  int	k, n ;		/* steps into the stretch, and its length */
+	  double g0, rate ;	/* mean sidereal time at jd, per step, degrees */
+	  double e0, de ;	/* equation of the equinoxes, degrees */
+	} SiderealSeries ;
+
+
 	/* time conversions */
 extern	double	date2julian(int y, int m, double d);
 extern	double	time2julian(int y, int m, int d, int hr, int mn, double s) ;
 extern	void	julian2date(double jdate, int *y, int *m, int *d) ;
 extern	void	julian2time(double jdate, int *y, int *m, int *d,
 			int *hr, int *mn, double *s) ;
+extern	void	date2julian_n(int n, const int *y, const int *m,
+			const double *d, double *jd) ;
+extern	void	julian2date_n(int n, const double *jd, int *y, int *m, int *d) ;
+extern	void	julian2time_n(int n, const double *jd, int *y, int *m, int *d,
+			int *hr, int *mn, double *s) ;
 extern	double	julian2hour(double jdate);
 extern	void	printDate(double jdate);
 extern	int	date2yday(int y, int m, int d) ;
@@ -388,8 +534,84 @@ extern	double	julianTime2sidereal(double jdate, double time) ;
 extern	double	time2sidereal(double jdate) ;
 extern	double	gmst2gast(double gmst, double JD);
 extern	double	siderealMean2Apparent(double jdate) ;
+extern	void	siderealSeriesInit(SiderealSeries *s, double jdate,
+			double step, int apparent) ;
+extern	double	siderealSeriesNext(SiderealSeries *s) ;
+extern	void	siderealSeries_n(SiderealSeries *s, int n, int nlon,
+			const double *lon, double *lst) ;
 extern	double	unix2julian(time_t) ;
 extern	double	jnow() ;
+extern	void	splitJD(double jdate, SplitJD *jd) ;
+extern	double	joinJD(const SplitJD *jd) ;
+extern	void	jnowSplit(SplitJD *jd) ;
+extern	void	unix2splitJD_n(int n, const int64_t *t, SplitJD *jd) ;
+extern	void	unixNs2splitJD_n(int n, const int64_t *ns, SplitJD *jd) ;
+extern	int64_t	splitJD2unixNs(const SplitJD *jd) ;
+extern	int	parseJulian(const char *s, size_t len, SplitJD *jd) ;
+extern	int	parseJulian_n(int n, const char *const *str, double *jd,
+			uint8_t *err) ;
+extern	int	iso2splitJD(const char *str, SplitJD *jd) ;
+extern	int	iso2splitJD_n(int n, const char *const *str, SplitJD *jd) ;
+extern	void	splitJD2time(const SplitJD *jd, int *y, int *m, int *d,
+			int *hr, int *mn, double *s) ;
+extern	double	splitJD2sidereal(const SplitJD *jd) ;
+
+	/* time scales */
+#define	TS_UTC		0		/* Coordinated Universal Time */
+#define	TS_UT1		1		/* Universal Time, Earth rotation */
+#define	TS_TAI		2		/* International Atomic Time */
+#define	TS_TT		3		/* Terrestrial Time */
+#define	TS_TDB		4		/* Barycentric Dynamical Time */
+
+extern	double	deltaT(double jd) ;
+extern	double	taiMinusUtc(double jd) ;
+extern	double	convertTime(double jd, int from, int to) ;
+extern	void	convertTimes(int n, const double *jd, int from, int to,
+			double *out) ;
+
+	/* time zones, see timezone.c */
+typedef	struct {
+	  int32_t offset ;	/* local time - UTC, seconds */
+	  uint8_t isdst ;
+	  char	abbr[11] ;	/* e.g. "CEST" */
+	} TimeZoneType ;
+
+typedef	struct {
+	  char	kind ;		/* 'J', 'n' or 'M', as in POSIX TZ */
+	  int16_t m, w, d ;	/* month, week, day; or day of year */
+	  int32_t secs ;	/* local time of day */
+	} TimeZoneDate ;
+
+typedef	struct {		/* daylight saving after the last transition */
+	  int32_t stdoff, dstoff ;
+	  TimeZoneDate start, end ;
+	  uint8_t stdtype, dsttype ;	/* TimeZone.types[] */
+	  uint8_t hasdst ;
+	} TimeZoneRule ;
+
+typedef	struct {
+	  char	name[64] ;
+	  int	n ;		/* transitions */
+	  int64_t *when ;	/* Unix time of each, ascending */
+	  uint8_t *type ;	/* types[] in force from each */
+	  int	ntypes ;
+	  TimeZoneType *types ;	/* types[0] before the first transition */
+	  int	nindex ;
+	  int64_t index0 ;	/* time of index[0] */
+	  int32_t *index ;	/* last transition before each 2^24 seconds */
+	  TimeZoneRule rule ;
+	} TimeZone ;
+
+extern	int	LoadTimeZone(const char *name, TimeZone *tz) ;
+extern	void	FreeTimeZone(TimeZone *tz) ;
+extern	int	tzOffset(const TimeZone *tz, double jd) ;
+extern	const char *tzAbbrev(const TimeZone *tz, double jd) ;
+extern	double	utc2local(const TimeZone *tz, double jd) ;
+extern	double	local2utc(const TimeZone *tz, double jd) ;
+extern	void	utc2local_n(const TimeZone *tz, int n, const double *jd,
+			double *out) ;
+extern	void	local2utc_n(const TimeZone *tz, int n, const double *jd,
+			double *out) ;
 
 	/* coordinate conversions */
 extern	void	equat2ecliptic(double decl, double RA,
@@ -406,6 +628,9 @@ extern	void	precessionRate(double decl, double RA, double *dd, double *dr,
 			double jdate) ;
 extern	void	precession(double decl0, double RA0, double jdate0,
 			   double *decl1, double *RA1, double jdate1) ;
+extern	void	precessionRad(double decl0, double RA0, double jdate0,
+			   double *decl1, double *RA1, double jdate1) ;
+extern	void	precessionMatrix(double jdate0, double jdate1, double m[3][3]) ;
 extern	void	nutation(double *psi, double *eps, double jdate) ;
 
 	/* Coordinates of the Sun */
@@ -432,20 +657,327 @@ extern	void	Pluto(double date, PlanetState *p) ;
 extern	void	MoonPrecise(double date, PlanetState *p) ;
 extern	void	Moon(double date, PlanetState *p) ;
 
+typedef	void	(*PlanetFunc)(double date, PlanetState *p) ;
+extern	void	PlanetAt(PlanetFunc planet, double jd, int scale,
+			PlanetState *p) ;
+
 	/* star databases */
+
+/**
+ * The Visit functions pass matching stars to a callback in blocks
+ * of up to STAR_BLOCK records, reusing one fixed-size buffer.  The
+ * block, and any names it points to, are only valid for the duration
+ * of the call.  The callback returns nonzero to stop the read early.
+ */
+#define	STAR_BLOCK	256
+
+typedef	int	(*PPMStarVisitor)(const PPMStar *stars, int n, void *arg) ;
+typedef	int	(*YaleStarVisitor)(const YaleStar *stars, int n, void *arg) ;
+
 extern	int	ReadPPMStars(int maxmag, long ra0, long ra1, long d0, long d1,
 			double jd, char *filename, PPMStar **rptr) ;
+extern	int	VisitPPMStars(int maxmag, long ra0, long ra1, long d0, long d1,
+			double jd, char *filename,
+			PPMStarVisitor visit, void *arg) ;
+extern	int	CountPPMStars(int maxmag, long ra0, long ra1, long d0, long d1,
+			double jd, char *filename) ;
 extern	int	ReadYaleStars(float maxmag, double ra0, double ra1,
 		    double d0, double d1,
 		    const char *datfilename,
 		    const char *notefilename,
 		    YaleStar **rval, size_t *recsize);
+extern	int	VisitYaleStars(float maxmag, double ra0, double ra1,
+		    double d0, double d1,
+		    const char *datfilename,
+		    const char *notefilename,
+		    YaleStarVisitor visit, void *arg);
+extern	int	CountYaleStars(float maxmag, double ra0, double ra1,
+		    double d0, double d1,
+		    const char *datfilename);
+extern	void	FreeYaleStars(YaleStar *stars, int count);
+extern	int	LoadYaleCatalog(float maxmag, double ra0, double ra1,
+		    double d0, double d1,
+		    const char *datfilename,
+		    const char *notefilename,
+		    YaleCatalog *cat);
+extern	void	FreeYaleCatalog(YaleCatalog *cat);
+extern	int	LoadYaleCatalogThreads(float maxmag, double ra0, double ra1,
+		    double d0, double d1,
+		    const char *datfilename,
+		    const char *notefilename,
+		    int nthreads, YaleCatalog *cat);
+
+	/* compact catalogs */
+extern	const char *starTypes[] ;
+extern	const char *constellations[] ;
+extern	void	compactStar(const Star *s, CompactStar *c) ;
+extern	void	expandStar(const CompactStar *c, Star *s) ;
+extern	int	StarCatalogFromYale(const YaleCatalog *yc, StarCatalog *cat) ;
+extern	int	StarCatalogFromPPM(const PPMStar *stars, int n,
+			StarCatalog *cat) ;
+extern	int	StarCatalogAdd(StarCatalog *cat, const CompactStar *c,
+			uint32_t sao, const char *name) ;
+extern	int	StarCatalogAddDSO(StarCatalog *cat, const CompactStar *c,
+			const DsoShape *shape, const char *name) ;
+extern	int	StarCatalogIndex(StarCatalog *cat) ;
+extern	int	StarCatalogWrite(const StarCatalog *cat, const char *filename) ;
+extern	int	StarCatalogOpen(const char *filename, StarCatalog *cat) ;
+extern	void	StarCatalogGet(const StarCatalog *cat, int i, YaleStar *ys) ;
+extern	const char *StarCatalogName(const StarCatalog *cat, int i) ;
+extern	int	StarCatalogSelect(const StarCatalog *cat, float maxmag,
+			double ra0, double ra1, double d0, double d1,
+			int *idx) ;
+extern	int	StarCatalogRanges(const StarCatalog *cat,
+			double ra0, double ra1, double d0, double d1,
+			int *ranges) ;
+extern	int	StarCatalogFind(const StarCatalog *cat, uint32_t num) ;
+extern	int	StarCatalogFindSAO(const StarCatalog *cat, uint32_t sao) ;
+extern	int	StarCatalogFindMessier(const StarCatalog *cat, int m) ;
+extern	int	StarCatalogFindName(const StarCatalog *cat, const char *prefix,
+			int *idx, int max) ;
+extern	void	propagateStars(int n, const double *ra, const double *dec,
+			const double *pmr, const double *pmd,
+			const double *plx, const double *rv,
+			double dt, double *rra, double *rdec) ;
+extern	int	StarCatalogSelectEpoch(const StarCatalog *cat, double jd,
+			float maxmag, double ra0, double ra1,
+			double d0, double d1,
+			int *idx, double *ra, double *dec) ;
+extern	void	FreeStarCatalog(StarCatalog *cat) ;
+extern	int	ReadTycho2Catalog(const char *filename, float maxmag,
+			StarCatalog *cat) ;
+extern	int	ReadHipparcosCatalog(const char *filename, float maxmag,
+			StarCatalog *cat) ;
+extern	int	ReadOpenNGC(const char *filename, float maxmag,
+			StarCatalog *cat) ;
+
+/**
+ * One pair of stars found by StarCatalogMatchAll()
+ */
+typedef	struct {
+	  int	a, b ;		/* record # in each catalog */
+	  float	sep ;		/* separation, arcseconds */
+	} StarMatch ;
+
+/**
+ * An observing site.
+ */
+typedef	struct {
+	  double lat, lon ;	/* degrees, longitude positive west */
+	  double height ;	/* metres above sea level */
+	} Site ;
+
+/* riseTransitSet() flags */
+#define	RTS_CIRCUMPOLAR	1	/* never sets */
+#define	RTS_NEVER_RISES	2
+
+extern	int	LoadConstellationBounds(const char *filename) ;
+extern	int	constellation(double decl, double RA, double jdate) ;
+extern	void	constellationsOf(int n, const double *ra, const double *dec,
+			double jdate, uint8_t *cons) ;
+extern	void	StarCatalogConstellations(StarCatalog *cat) ;
+extern	int	StarCatalogVisible(const StarCatalog *cat, double jd,
+			double lat, double lon, float maxmag, double minalt,
+			int *idx, double *az, double *alt) ;
+extern	double	riseAltitude(double height) ;
+extern	void	riseTransitSet(int n, const double *ra, const double *dec,
+			const Site *site, double jd, float *rise,
+			float *transit, float *set, uint8_t *flags) ;
+extern	int	StarCatalogRiseSet(const StarCatalog *cat, const Site *sites,
+			int nsites, double jd, int nthreads, float *rise,
+			float *transit, float *set, uint8_t *flags) ;
+extern	int	StarCatalogMatch(const StarCatalog *a, const StarCatalog *b,
+			double radius, int nthreads, int *best, double *sep) ;
+extern	int	StarCatalogMatchAll(const StarCatalog *a, const StarCatalog *b,
+			double radius, int nthreads, StarMatch **rval) ;
+
+	/* lunar occultations */
+
+/**
+ * One occultation found by StarCatalogOccultations(); times are UT.
+ */
+typedef	struct {
+	  int	site ;		/* index into the sites */
+	  int	star ;		/* record # in the catalog */
+	  double jd ;		/* least separation */
+	  double in, out ;	/* disappearance and reappearance */
+	  float	limb ;		/* least distance from the limb, arcsec,
+				 * negative (inside) */
+	  float	alt ;		/* Moon's altitude at jd, degrees */
+	  float	sunalt ;	/* Sun's altitude at jd, degrees */
+	} Occultation ;
+
+extern	void	MoonTopocentric(double jd, const Site *site, double *decl,
+			double *RA, double *dist) ;
+extern	int	StarCatalogOccultations(const StarCatalog *cat,
+			const Site *sites, int nsites, double jd0, double jd1,
+			float maxmag, int nthreads, Occultation **rval) ;
+
+	/* plate solving */
+
+/**
+ * Four index stars and their shape code, see plate.c
+ */
+typedef	struct {
+	  float	code[4] ;	/* C and D relative to A=0, B=1 */
+	  uint32_t star[4] ;	/* A, B, C, D: PlateIndex.stars[] */
+	} PlateQuad ;
+
+typedef	struct {
+	  CompactStar *stars ;	/* sorted by declination */
+	  int	nstars ;
+	  PlateQuad *quads ;	/* implicit k-d tree on code */
+	  int	nquads ;
+	  double *vec ;		/* unit vectors of stars[], 3 per star */
+	  double smin, smax ;	/* quad sizes, degrees */
+	  void	*map ;		/* if mapped from a file */
+	  size_t mapsize ;
+	} PlateIndex ;
+
+typedef	struct {
+	  double ra, dec ;	/* image centre, degrees */
+	  double scale ;	/* arcseconds per pixel */
+	  double rotation ;	/* position angle of image up, degrees */
+	  int	parity ;	/* 1 if the image is mirrored */
+	  int	matched ;	/* stars matched by the solution */
+	  int	tried ;		/* candidate quads verified */
+	} PlateSolution ;
+
+extern	int	PlateIndexBuild(const StarCatalog *cat, float maxmag,
+			double smin, double smax, PlateIndex *idx) ;
+extern	int	PlateIndexWrite(const PlateIndex *idx, const char *filename) ;
+extern	int	PlateIndexOpen(const char *filename, PlateIndex *idx) ;
+extern	void	FreePlateIndex(PlateIndex *idx) ;
+extern	int	PlateSolve(const PlateIndex *idx, const double *x,
+			const double *y, int n, double width, double height,
+			PlateSolution *sol) ;
+
+	/* parallel text loading */
+
+/**
+ * One piece of a mapped text file, always whole lines.  The worker
+ * that parses it leaves its results in data/count and aux/auxsize;
+ * their meaning is up to the loader.
+ */
+typedef	struct {
+	  const char *start, *end ;	/* text of this chunk */
+	  int	index ;			/* chunk #, in file order */
+	  void	*data ;			/* parsed records */
+	  int	count ;
+	  void	*aux ;			/* e.g. a string pool */
+	  size_t auxsize ;
+	} TextChunk ;
+
+typedef	int	(*TextChunkWorker)(TextChunk *chunk, void *arg) ;
+
+extern	const char *mapTextFile(const char *filename, size_t *size) ;
+extern	void	unmapTextFile(const char *text, size_t size) ;
+extern	int	splitTextChunks(const char *text, size_t size, int nchunks,
+			TextChunk *chunks) ;
+extern	int	runTextChunks(TextChunk *chunks, int n, int nthreads,
+			TextChunkWorker fn, void *arg) ;
+extern	const char *textLine(const char **ptr, const char *end,
+			char *buf, size_t bufsize) ;
+extern	int	numThreads() ;
 
 	/* navigation */
 
 extern	double	ra2sha(double RA) ;
 extern	double	sha2gha(double SHA, double jdate) ;
+extern	void	sha2gha_n(int n, const double *sha, double jdate,
+			double *gha) ;
 extern	double	gha2lha(double SHA, double jdate) ;
+extern	double	interpolate(double a, double b, double hours) ;
+extern	void	altaz(double lha, double decl, double lat, double *alt,
+			double *az) ;
+extern	double	sext2obs(double Hs, double ie, double h, double T, double P,
+			double HP) ;
+
+	/* nautical almanac */
+
+#define	ALM_ARIES	0
+#define	ALM_SUN		1
+#define	ALM_MOON	2
+#define	ALM_VENUS	3
+#define	ALM_MARS	4
+#define	ALM_JUPITER	5
+#define	ALM_SATURN	6
+#define	ALM_NBODIES	7
+
+typedef	struct {
+	  float	gha, dec ;	/* degrees */
+	  float	v, d ;		/* change in the next hour, arcminutes */
+	  float	hp ;		/* horizontal parallax, arcminutes */
+	} AlmanacEntry ;
+
+typedef	struct {
+	  double jd0 ;		/* 0h UT of the first day */
+	  int	nhours ;
+	  AlmanacEntry *rows ;	/* [hour*ALM_NBODIES + body], nhours+1 rows */
+	  void	*map ;		/* if mapped from a file */
+	  size_t mapsize ;
+	} Almanac ;
+
+extern	const char *almanacBodies[ALM_NBODIES] ;
+extern	void	almanacPositions(double jd, double gha[], double dec[],
+			double hp[]) ;
+extern	int	AlmanacCompute(double jd0, int ndays, int nthreads,
+			Almanac *alm) ;
+extern	int	AlmanacWrite(const Almanac *alm, const char *filename) ;
+extern	int	AlmanacPrint(const Almanac *alm, FILE *ofile) ;
+extern	int	AlmanacOpen(const char *filename, Almanac *alm) ;
+extern	int	AlmanacGhaDec(const Almanac *alm, int body, double jd,
+			double *gha, double *dec) ;
+extern	int	AlmanacGhaDec_n(const Almanac *alm, int n, const int *body,
+			const double *jd, double *gha, double *dec) ;
+extern	void	FreeAlmanac(Almanac *alm) ;
+
+	/* sight reduction and position fixing */
+
+#define	SIGHT_STAR	ALM_ARIES	/* a star: GHA of Aries + SHA */
+#define	SIGHT_LOWER	1		/* limb observed, Sun and Moon */
+#define	SIGHT_UPPER	(-1)
+
+/**
+ * One sextant observation.
+ */
+typedef	struct {
+	  double jd ;		/* UT */
+	  int	body ;		/* ALM_SUN .. ALM_SATURN, or SIGHT_STAR */
+	  int	limb ;		/* SIGHT_LOWER, SIGHT_UPPER, 0 for the centre */
+	  double sha, dec ;	/* SIGHT_STAR only: apparent SHA, dec, degrees */
+	  double Hs ;		/* sextant altitude, degrees */
+	} Sight ;
+
+/**
+ * A set of sights for one fix, and the vessel's dead reckoning.
+ * Longitudes here are positive east, as for gha2lha().
+ */
+typedef	struct {
+	  double jd ;		/* time of the fix, UT */
+	  double lat, lon ;	/* DR position at jd, degrees */
+	  double course, speed ; /* degrees true, knots, between sights */
+	  double ie, height ;	/* index error, degrees; eye height, m */
+	  double T, P ;		/* temperature C, pressure mb, 0 for standard */
+	  double sigma ;	/* a priori error of a sight, ', 0 for 1' */
+	  int	nsights ;
+	  const Sight *sights ;
+	} SightSet ;
+
+typedef	struct {
+	  double lat, lon ;	/* position at jd, degrees, east positive */
+	  double cov[3] ;	/* covariance N-N, N-E, E-E, square miles */
+	  double rms ;		/* rms intercept at the fix, minutes of arc */
+	  int	iterations ;
+	  int	status ;	/* 0, or -1 if no fix */
+	} Fix ;
+
+extern	void	sightReduce_n(int n, const double *gha, const double *dec,
+			const double *lat, const double *lon, const double *Ho,
+			double *Hc, double *Zn, double *intercept) ;
+extern	int	sightFix(const Almanac *alm, const SightSet *set, Fix *fix) ;
+extern	int	sightFix_n(const Almanac *alm, int n, const SightSet *sets,
+			int nthreads, Fix *fixes) ;
 
 
 	/* utilities */
@@ -464,8 +996,23 @@ extern	void	deltaPolar(double lat1, double lon1, double r1,
 			double lat2, double lon2, double r2,
 			double *lat3, double *lon3, double *r3) ;
 extern	double	keplerE(double M, double e) ;
+
+	/* limitAngles_n() ranges */
+#define	ANGLE_DEG		0	/* [0, 360) */
+#define	ANGLE_DEG_SIGNED	1	/* [-180, 180) */
+#define	ANGLE_HOUR		2	/* [0, 24) */
+#define	ANGLE_HOUR_SIGNED	3	/* [-12, 12) */
+#define	ANGLE_RAD		4	/* [0, 2 pi) */
+#define	ANGLE_RAD_SIGNED	5	/* [-pi, pi) */
+
 extern	double	limitAngle(double angle) ;
+extern	double	limitAngleSigned(double angle) ;
 extern	double	limitHour(double angle) ;
+extern	double	limitHourSigned(double angle) ;
+extern	double	limitRadians(double angle) ;
+extern	double	limitRadiansSigned(double angle) ;
+extern	void	limitAngles_n(int n, const double *in, double *out,
+			int range) ;
 extern	const char *convertHms(double hours);
 extern	const char *convertDms(double hours);
 extern	void	printHms(double hours);
@@ -476,6 +1023,18 @@ extern	char *	recString(const char *buffer, int start, int end, char *tmp);
 
 	/* I/O */
 
+#define	FMT_BUFSIZE	40	/* room for any one formatted value */
+
+	/* formatValues() formats */
+#define	FMT_YMD		0	/* julian2ymdStr() */
+#define	FMT_TIME	1	/* julian2hmsStr() */
+#define	FMT_DATETIME	2	/* julian2str() */
+#define	FMT_DMS		3	/* deg2dmsStr() */
+#define	FMT_DM		4	/* deg2dmStr() */
+#define	FMT_HMS		5	/* hours2hmsStr() */
+#define	FMT_HM		6	/* hours2hmStr() */
+#define	FMT_HMS6	7	/* convertHms() */
+
 extern	char	*julian2ymdStr(double jdate) ;
 extern	char	*julian2hmsStr(double jdate) ;
 extern	char	*julian2str(double jdate) ;
@@ -483,6 +1042,16 @@ extern	char	*deg2dmsStr(double jdate) ;
 extern	char	*deg2dmStr(double jdate) ;
 extern	char	*hours2hmsStr(double jdate) ;
 extern	char	*hours2hmStr(double jdate) ;
+extern	char	*julian2ymdStr_r(double jdate, char *buf) ;
+extern	char	*julian2hmsStr_r(double jdate, char *buf) ;
+extern	char	*julian2str_r(double jdate, char *buf) ;
+extern	char	*deg2dmsStr_r(double degrees, char *buf) ;
+extern	char	*deg2dmStr_r(double degrees, char *buf) ;
+extern	char	*hours2hmsStr_r(double hours, char *buf) ;
+extern	char	*hours2hmStr_r(double hours, char *buf) ;
+extern	char	*convertHms_r(double hours, char *buf) ;
+extern	size_t	formatValues(int n, const double *v, int format, int sep,
+			char *out) ;
 
 
 static inline double sind(double a) { return sin(a*RAD); }
@@ -491,4 +1060,19 @@ static inline double asind(double x) { return asin(x) * DEG; }
 static inline double acosd(double x) { return acos(x) * DEG; }
 static inline double atan2d(double y, double x) { return atan2(y,x) * DEG; }
 
+/**
+ * arccos, branch-free, to 2e-8 radians.  Abramowitz & Stegun 4.4.46.
+ */
+static inline double
+acosPoly(double x)
+{
+	double	a = fabs(x) ;
+	double	p = ((((((-0.0012624911 * a + 0.0066700901) * a
+		- 0.0170881256) * a + 0.0308918810) * a
+		- 0.0501743046) * a + 0.0889789874) * a
+		- 0.2145988016) * a + 1.5707963050 ;
+	p *= sqrt(1. - a) ;
+	return x < 0. ? M_PI - p : p ;
+}
+
 #endif	/* ASTRO_H */
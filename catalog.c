@@ -0,0 +1,1610 @@
+	/* Compact in-memory star catalogs */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * A YaleStar is 80 bytes, most of it doubles, padding and a name
+ * pointer.  For large catalogs, the filtering done by a query only
+ * ever looks at position and magnitude, so scanning an array of
+ * YaleStars spends most of its memory bandwidth on bytes it never
+ * uses.  The CompactStar record packs the same information into 24
+ * bytes:
+ *
+ *	ra, dec		fixed point, 2^32 units per circle.  One unit
+ *			is 0.0003", far finer than any catalog we read.
+ *	mag		magnitude * 1000
+ *	pmr, pmd	proper motion, mas/year (+/- 32"/year)
+ *	name		index into the catalog's name table
+ *	type		index into starTypes[]
+ *	cons		index into constellations[]
+ *
+ * Fields that are rarely needed (SAO number, name text) are kept in
+ * separate arrays in the StarCatalog so they don't dilute the records.
+ *
+ * void
+ * compactStar(const Star *s, CompactStar *c)
+ *	Convert a Star to a CompactStar.  Catalog #, name and constellation
+ *	are left zero.
+ *
+ * void
+ * expandStar(const CompactStar *c, Star *s)
+ *	Convert a CompactStar back to a Star.  sao and name are left empty.
+ *
+ * int
+ * StarCatalogFromYale(const YaleCatalog *yc, StarCatalog *cat)
+ *	Build a compact catalog from a loaded Yale catalog.
+ *
+ * int
+ * StarCatalogFromPPM(const PPMStar *stars, int n, StarCatalog *cat)
+ *	Build a compact catalog from PPM records.
+ *
+ * int
+ * StarCatalogAdd(StarCatalog *cat, const CompactStar *c,
+ *		uint32_t sao, const char *name)
+ *	Append one star to a catalog being built by a reader.
+ *
+ * int
+ * StarCatalogAddDSO(StarCatalog *cat, const CompactStar *c,
+ *		const DsoShape *shape, const char *name)
+ *	Append a deep-sky object, with its size and orientation.
+ *
+ * int
+ * StarCatalogIndex(StarCatalog *cat)
+ *	Sort the catalog into sky cells for fast region queries.
+ *
+ * int
+ * StarCatalogWrite(const StarCatalog *cat, const char *filename)
+ * int
+ * StarCatalogOpen(const char *filename, StarCatalog *cat)
+ *	Save a catalog to a binary file and map it back in.
+ *
+ * void
+ * StarCatalogGet(const StarCatalog *cat, int i, YaleStar *ys)
+ *	Expand one record, including name, SAO # and constellation.
+ *
+ * int
+ * StarCatalogSelect(const StarCatalog *cat, float maxmag,
+ *		double ra0, double ra1, double d0, double d1, int *idx)
+ *	Find all stars in a box, with integer compares only.
+ *
+ * int
+ * StarCatalogRanges(const StarCatalog *cat,
+ *		double ra0, double ra1, double d0, double d1, int *ranges)
+ *	Find the records in the cells overlapping a box.
+ *
+ * int
+ * StarCatalogFind(const StarCatalog *cat, uint32_t num)
+ * int
+ * StarCatalogFindSAO(const StarCatalog *cat, uint32_t sao)
+ *	Find a star by catalog # (Yale/HR, HIP, TYC, NGC/IC) or SAO #.
+ *
+ * int
+ * StarCatalogFindMessier(const StarCatalog *cat, int m)
+ *	Find a deep-sky object by Messier number.
+ *
+ * int
+ * StarCatalogFindName(const StarCatalog *cat, const char *prefix,
+ *		int *idx, int max)
+ *	Find stars whose names begin with prefix, for type-ahead.
+ *
+ * void
+ * propagateStars(int n, const double *ra, *dec, *pmr, *pmd, *plx, *rv,
+ *		double dt, double *rra, *rdec)
+ *	Apply dt years of proper motion to a batch of stars.
+ *
+ * int
+ * StarCatalogSelectEpoch(const StarCatalog *cat, double jd, float maxmag,
+ *		double ra0, ra1, d0, d1, int *idx, double *ra, *dec)
+ *	Find all stars in a box at a given epoch.
+ */
+
+
+/* Object type codes, see astro.h.  Index 0 is the default. */
+const char *starTypes[] = {
+	"SS", "SB", "SD", "SV",
+	"CG", "CO", "GC", "GP", "GS", "ND", "NP",
+	NULL
+} ;
+
+/* IAU constellation abbreviations.  Index 0 is "unknown". */
+const char *constellations[] = {
+	"",
+	"And", "Ant", "Aps", "Aqr", "Aql", "Ara", "Ari", "Aur",
+	"Boo", "Cae", "Cam", "Cnc", "CVn", "CMa", "CMi", "Cap",
+	"Car", "Cas", "Cen", "Cep", "Cet", "Cha", "Cir", "Col",
+	"Com", "CrA", "CrB", "Crv", "Crt", "Cru", "Cyg", "Del",
+	"Dor", "Dra", "Equ", "Eri", "For", "Gem", "Gru", "Her",
+	"Hor", "Hya", "Hyi", "Ind", "Lac", "Leo", "LMi", "Lep",
+	"Lib", "Lup", "Lyn", "Lyr", "Men", "Mic", "Mon", "Mus",
+	"Nor", "Oct", "Oph", "Ori", "Pav", "Peg", "Per", "Phe",
+	"Pic", "Psc", "PsA", "Pup", "Pyx", "Ret", "Sge", "Sgr",
+	"Sco", "Scl", "Sct", "Ser", "Sex", "Tau", "Tel", "Tri",
+	"TrA", "Tuc", "UMa", "UMi", "Vel", "Vir", "Vol", "Vul",
+	NULL
+} ;
+
+
+static int
+typeIndex(const char *type)
+{
+	int	i ;
+	for(i=0; starTypes[i] != NULL; ++i)
+	  if( type[0] == starTypes[i][0] && type[1] == starTypes[i][1] )
+	    return i ;
+	return 0 ;
+}
+
+/**
+ * Return the index of a constellation abbreviation, which need not
+ * be nul-terminated (YaleStar.cons is exactly 3 characters).
+ */
+static int
+consIndex(const char *cons)
+{
+	int	i ;
+	if( cons[0] == '\0' )
+	  return 0 ;
+	for(i=1; constellations[i] != NULL; ++i)
+	  if( strncmp(cons, constellations[i], 3) == 0 )
+	    return i ;
+	return 0 ;
+}
+
+static int16_t
+clamp16(double x)
+{
+	if( x > 32767. ) return 32767 ;
+	if( x < -32767. ) return -32767 ;
+	return (int16_t)lround(x) ;
+}
+
+
+void
+compactStar(const Star *s, CompactStar *c)
+{
+	c->ra = (uint32_t)llround(limitAngle(s->ra) * CU_PER_DEG) ;
+	c->dec = (int32_t)lround(s->dec * CU_PER_DEG) ;
+	c->cat = 0 ;
+	c->mag = clamp16(s->mag * 1000.) ;
+	c->pmr = clamp16(s->pmr * 1000.) ;
+	c->pmd = clamp16(s->pmd * 1000.) ;
+	c->name = 0 ;
+	c->type = typeIndex(s->type) ;
+	c->spec = s->spec[0] ;
+	c->cons = 0 ;
+	c->epoch = s->epoch - 1900 ;
+}
+
+
+void
+expandStar(const CompactStar *c, Star *s)
+{
+	s->ra = c->ra / CU_PER_DEG ;
+	s->dec = c->dec / CU_PER_DEG ;
+	s->mag = c->mag * .001 ;
+	s->epoch = c->epoch + 1900 ;
+	s->pmr = c->pmr * .001 ;
+	s->pmd = c->pmd * .001 ;
+	strcpy(s->type, starTypes[c->type]) ;
+	s->spec[0] = c->spec ;
+	s->spec[1] = '\0' ;
+	s->sao = 0 ;
+	s->name = NULL ;
+}
+
+
+/**
+ * Build a compact catalog from a Yale catalog.  The Yale catalog
+ * may be freed afterwards; the name pool is copied.
+ *
+ * @return number of stars, or -1 if out of memory.
+ */
+int
+StarCatalogFromYale(const YaleCatalog *yc, StarCatalog *cat)
+{
+	const YaleStar *ys ;
+	CompactStar *c ;
+	int	n = yc->count ;
+	int	nnamed = 0 ;
+	int	i ;
+
+	memset(cat, 0, sizeof(*cat)) ;
+
+	for(i=0; i < n; ++i)
+	  if( yc->stars[i].s.name != NULL )
+	    ++nnamed ;
+	if( nnamed > UINT16_MAX )
+	  nnamed = UINT16_MAX ;
+
+	cat->stars = malloc((n > 0 ? n : 1) * sizeof(*cat->stars)) ;
+	cat->sao = malloc((n > 0 ? n : 1) * sizeof(*cat->sao)) ;
+	cat->nameoff = malloc((nnamed+1) * sizeof(*cat->nameoff)) ;
+	cat->names = malloc(yc->namesize > 0 ? yc->namesize : 1) ;
+	if( cat->stars == NULL || cat->sao == NULL ||
+	    cat->nameoff == NULL || cat->names == NULL )
+	{
+	  FreeStarCatalog(cat) ;
+	  return -1 ;
+	}
+	memcpy(cat->names, yc->names, yc->namesize) ;
+	cat->namesize = cat->namealloc = yc->namesize ;
+	cat->nnamealloc = nnamed+1 ;
+	cat->nameoff[0] = 0 ;
+	cat->nnames = 1 ;
+
+	for(i=0, ys=yc->stars, c=cat->stars; i < n; ++i, ++ys, ++c)
+	{
+	  compactStar(&ys->s, c) ;
+	  c->cat = ys->yale_cat ;
+	  c->cons = consIndex(ys->cons) ;
+	  cat->sao[i] = ys->s.sao ;
+	  if( ys->s.name != NULL && cat->nnames <= nnamed ) {
+	    cat->nameoff[cat->nnames] = ys->s.name - yc->names ;
+	    c->name = cat->nnames++ ;
+	  }
+	}
+	cat->count = cat->nalloc = n ;
+	return n ;
+}
+
+
+/**
+ * Build a StarCatalog from PPM records, as returned by ReadPPMStars().
+ * PPMStar has no catalog number, so each record's cat field is its
+ * index in the input array; that survives StarCatalogIndex(), which
+ * reorders the records.  Positions are taken as they are, at
+ * whatever date they were read for, with no proper motion.
+ *
+ * @return number of stars, or -1 if out of memory.
+ */
+int
+StarCatalogFromPPM(const PPMStar *stars, int n, StarCatalog *cat)
+{
+	Star	s ;
+	CompactStar c ;
+	int	i ;
+
+	memset(cat, 0, sizeof(*cat)) ;
+	memset(&s, 0, sizeof(s)) ;
+	s.epoch = 2000 ;
+	for(i=0; i < n; ++i, ++stars)
+	{
+	  s.ra = stars->ra / 3600. ;
+	  s.dec = stars->dec / 3600. ;
+	  s.mag = stars->mag * .01 ;
+	  memcpy(s.type, stars->type, 2) ;
+	  s.spec[0] = stars->spec[0] ;
+	  compactStar(&s, &c) ;
+	  c.cat = i ;
+	  if( StarCatalogAdd(cat, &c, 0, NULL) < 0 ) {
+	    FreeStarCatalog(cat) ;
+	    return -1 ;
+	  }
+	}
+	return cat->count ;
+}
+
+
+/**
+ * Append a star to a catalog.  Used by catalog readers to build a
+ * catalog one record at a time; arrays grow as needed.  Must not be
+ * used on a catalog that has been indexed or mapped from a file.
+ *
+ * @param c     the star; its name field is filled in here
+ * @param sao   SAO catalog #, or 0
+ * @param name  star name, copied into the catalog's pool, or NULL
+ * @return index of the new star, or -1 if out of memory
+ */
+int
+StarCatalogAdd(StarCatalog *cat, const CompactStar *c,
+	uint32_t sao, const char *name)
+{
+	int	i = cat->count ;
+
+	if( cat->map != NULL || cat->cells != NULL )
+	  return -1 ;
+
+	if( i >= cat->nalloc )
+	{
+	  int	nalloc = cat->nalloc > 0 ? cat->nalloc*2 : 1024 ;
+	  void	*p ;
+	  if( (p = realloc(cat->stars, nalloc*sizeof(*cat->stars))) == NULL )
+	    return -1 ;
+	  cat->stars = p ;
+	  if( (p = realloc(cat->sao, nalloc*sizeof(*cat->sao))) == NULL )
+	    return -1 ;
+	  cat->sao = p ;
+	  if( cat->shape != NULL ) {
+	    if( (p = realloc(cat->shape, nalloc*sizeof(*cat->shape))) == NULL )
+	      return -1 ;
+	    cat->shape = p ;
+	  }
+	  cat->nalloc = nalloc ;
+	}
+
+	cat->stars[i] = *c ;
+	cat->stars[i].name = 0 ;
+	cat->sao[i] = sao ;
+	if( cat->shape != NULL )
+	  memset(&cat->shape[i], 0, sizeof(*cat->shape)) ;
+
+	if( name != NULL && *name != '\0' && cat->nnames < UINT16_MAX )
+	{
+	  size_t len = strlen(name) + 1 ;
+	  void	*p ;
+	  if( cat->nnames == 0 )
+	    cat->nnames = 1 ;		/* [0] is "no name" */
+	  if( cat->nnames >= cat->nnamealloc ) {
+	    int n = cat->nnamealloc > 0 ? cat->nnamealloc*2 : 256 ;
+	    if( (p = realloc(cat->nameoff, n*sizeof(*cat->nameoff))) == NULL )
+	      return -1 ;
+	    cat->nameoff = p ;
+	    cat->nnamealloc = n ;
+	  }
+	  if( cat->namesize + len > cat->namealloc ) {
+	    size_t n = cat->namealloc*2 + len + 4096 ;
+	    if( (p = realloc(cat->names, n)) == NULL )
+	      return -1 ;
+	    cat->names = p ;
+	    cat->namealloc = n ;
+	  }
+	  memcpy(cat->names + cat->namesize, name, len) ;
+	  cat->nameoff[0] = 0 ;
+	  cat->nameoff[cat->nnames] = cat->namesize ;
+	  cat->namesize += len ;
+	  cat->stars[i].name = cat->nnames++ ;
+	}
+
+	return cat->count++ ;
+}
+
+
+/**
+ * Append a deep-sky object to a catalog.  Like StarCatalogAdd(), but
+ * with a size and orientation.  The catalog's shape array is created
+ * on the first call; stars in the catalog have zero shapes.
+ *
+ * @return index of the new object, or -1 if out of memory
+ */
+int
+StarCatalogAddDSO(StarCatalog *cat, const CompactStar *c,
+	const DsoShape *shape, const char *name)
+{
+	int	i ;
+
+	if( cat->shape == NULL && cat->map == NULL && cat->cells == NULL ) {
+	  int n = cat->nalloc > 0 ? cat->nalloc : 1024 ;
+	  if( (cat->shape = calloc(n, sizeof(*cat->shape))) == NULL )
+	    return -1 ;
+	}
+	if( (i = StarCatalogAdd(cat, c, 0, name)) >= 0 )
+	  cat->shape[i] = *shape ;
+	return i ;
+}
+
+
+/*
+ * The sky index divides the sky into one-degree declination zones,
+ * each divided into roughly one-degree cells in RA; there are fewer
+ * cells per zone near the poles.  There are about 41,000 cells in
+ * all.  The records are sorted by cell and, within each cell, by
+ * magnitude, so a query can stop reading a cell at the first star
+ * that is too faint.
+ */
+
+static int	buildLookup(StarCatalog *cat) ;
+
+static int32_t *
+makeZones(int *ncells)
+{
+	int32_t *zones = malloc((CAT_ZONES+1) * sizeof(*zones)) ;
+	int	z, n = 0 ;
+
+	if( zones == NULL )
+	  return NULL ;
+	for(z=0; z < CAT_ZONES; ++z) {
+	  double lo = -90. + z*180./CAT_ZONES, hi = lo + 180./CAT_ZONES ;
+	  double edge = lo >= 0. ? lo : hi <= 0. ? -hi : 0. ;
+	  zones[z] = n ;
+	  n += (int)ceil(360. * cos(edge*RAD) - 1e-9) ;
+	}
+	zones[CAT_ZONES] = n ;
+	*ncells = n ;
+	return zones ;
+}
+
+static int
+decZone(double dec)
+{
+	int	z = (int)floor((dec + 90.) * CAT_ZONES / 180.) ;
+	return z < 0 ? 0 : z >= CAT_ZONES ? CAT_ZONES-1 : z ;
+}
+
+/**
+ * Return the sky cell containing a position, in compact units.
+ */
+static int
+starCell(const StarCatalog *cat, uint32_t ra, int32_t dec)
+{
+	int	z = decZone(dec / CU_PER_DEG) ;
+	int	n = cat->zones[z+1] - cat->zones[z] ;
+	return cat->zones[z] + (int)(((uint64_t)ra * n) >> 32) ;
+}
+
+static void
+starMotion(const CompactStar *c, CellMotion *m)
+{
+	uint32_t pm = abs(c->pmr) + abs(c->pmd) ;
+	uint32_t drift = pm * abs(c->epoch - 100) ;
+	if( pm > m->pm ) m->pm = pm ;
+	if( drift > m->drift ) m->drift = drift ;
+}
+
+/**
+ * Find the fastest motion in each cell of an indexed catalog, and
+ * over the whole catalog in motion[ncells].
+ * @return the table, or NULL if out of memory
+ */
+static CellMotion *
+makeMotion(const StarCatalog *cat)
+{
+	CellMotion *motion = calloc(cat->ncells+1, sizeof(*motion)) ;
+	int	i, cell ;
+
+	if( motion == NULL )
+	  return NULL ;
+	for(cell=0; cell < cat->ncells; ++cell) {
+	  for(i = cat->cells[cell]; i < cat->cells[cell+1]; ++i)
+	    starMotion(&cat->stars[i], &motion[cell]) ;
+	  if( motion[cell].pm > motion[cat->ncells].pm )
+	    motion[cat->ncells].pm = motion[cell].pm ;
+	  if( motion[cell].drift > motion[cat->ncells].drift )
+	    motion[cat->ncells].drift = motion[cell].drift ;
+	}
+	return motion ;
+}
+
+static int
+cmpKey(const void *a, const void *b)
+{
+	uint64_t ka = *(const uint64_t *)a, kb = *(const uint64_t *)b ;
+	return ka < kb ? -1 : ka > kb ;
+}
+
+
+/**
+ * Build the sky index: sort the records by cell and magnitude and
+ * fill in cells[] and motion[].  Once indexed, StarCatalogSelect()
+ * only reads the cells that overlap the query box.  Records without a
+ * constellation get one.
+ *
+ * @return 0 on success, -1 if out of memory or the catalog is mapped
+ */
+int
+StarCatalogIndex(StarCatalog *cat)
+{
+	uint64_t *keys ;
+	CompactStar *stars ;
+	uint32_t *sao ;
+	DsoShape *shape = NULL ;
+	int	n = cat->count ;
+	int	i ;
+
+	if( cat->map != NULL )
+	  return -1 ;
+
+	StarCatalogConstellations(cat) ;
+	free(cat->zones) ;
+	free(cat->cells) ;
+	free(cat->motion) ;
+	cat->cells = NULL ;
+	cat->motion = NULL ;
+	if( (cat->zones = makeZones(&cat->ncells)) == NULL )
+	  return -1 ;
+
+	keys = malloc((n > 0 ? n : 1) * sizeof(*keys)) ;
+	stars = malloc((n > 0 ? n : 1) * sizeof(*stars)) ;
+	sao = malloc((n > 0 ? n : 1) * sizeof(*sao)) ;
+	cat->cells = malloc((cat->ncells+1) * sizeof(*cat->cells)) ;
+	if( cat->shape != NULL )
+	  shape = malloc((n > 0 ? n : 1) * sizeof(*shape)) ;
+	if( keys == NULL || stars == NULL || sao == NULL || cat->cells == NULL ||
+	    (cat->shape != NULL && shape == NULL) )
+	{
+	  free(keys) ; free(stars) ; free(sao) ; free(shape) ;
+	  free(cat->cells) ;
+	  cat->cells = NULL ;
+	  return -1 ;
+	}
+
+	/* key = cell:16, magnitude:16, index:32 */
+	for(i=0; i < n; ++i)
+	  keys[i] = (uint64_t)starCell(cat, cat->stars[i].ra, cat->stars[i].dec)<<48 |
+		(uint64_t)(uint16_t)(cat->stars[i].mag + 32768)<<32 | i ;
+	qsort(keys, n, sizeof(*keys), cmpKey) ;
+
+	for(i=0; i <= cat->ncells; ++i)
+	  cat->cells[i] = 0 ;
+	for(i=0; i < n; ++i) {
+	  int j = keys[i] & 0xffffffff ;
+	  stars[i] = cat->stars[j] ;
+	  sao[i] = cat->sao != NULL ? cat->sao[j] : 0 ;
+	  if( shape != NULL )
+	    shape[i] = cat->shape[j] ;
+	  ++cat->cells[(keys[i]>>48) + 1] ;
+	}
+	for(i=0; i < cat->ncells; ++i)
+	  cat->cells[i+1] += cat->cells[i] ;
+
+	free(keys) ;
+	free(cat->stars) ;
+	free(cat->sao) ;
+	free(cat->shape) ;
+	cat->stars = stars ;
+	cat->sao = sao ;
+	cat->shape = shape ;
+	cat->nalloc = n ;
+	if( (cat->motion = makeMotion(cat)) == NULL )
+	  return -1 ;
+	return buildLookup(cat) ;
+}
+
+
+/*
+ * Lookup tables.  Catalog and SAO numbers are found through open
+ * addressing hash tables of record indices, -1 for an empty slot.
+ * The key is not stored; it is read back from the record, so each
+ * slot costs 4 bytes and the tables stay at most 2/3 full.  Names
+ * are found by binary search in a list of the named stars sorted by
+ * name, ignoring case, which also serves prefix searches.
+ */
+
+/*
+ * The key is mixed with the MurmurHash3 finalizer before masking:
+ * packed Tycho numbers differ mostly in their high bits, and keeping
+ * the low bits of a plain multiplicative hash clusters them badly.
+ */
+static uint32_t
+hashNum(uint32_t num, uint32_t size)
+{
+	num ^= num >> 16 ;
+	num *= 0x85ebca6bu ;
+	num ^= num >> 13 ;
+	num *= 0xc2b2ae35u ;
+	num ^= num >> 16 ;
+	return num & (size - 1) ;
+}
+
+/**
+ * Build the hash of catalog numbers, or of SAO numbers if useSao.
+ * Zero means "no number"; those stars are left out, and if no star
+ * has a number there is no table.
+ * @return 0 on success, -1 if out of memory
+ */
+static int
+makeHash(const StarCatalog *cat, int useSao, int32_t **rhash, uint32_t *rsize)
+{
+	int32_t	*hash ;
+	uint32_t size = 16, n = 0, h ;
+	int	i ;
+
+	*rhash = NULL ;
+	*rsize = 0 ;
+	for(i=0; i < cat->count; ++i)
+	  n += (useSao ? cat->sao[i] : cat->stars[i].cat) != 0 ;
+	if( n == 0 )
+	  return 0 ;
+	while( size < n + n/2 )
+	  size *= 2 ;
+	if( (hash = malloc(size * sizeof(*hash))) == NULL )
+	  return -1 ;
+	memset(hash, 0xff, size * sizeof(*hash)) ;
+
+	for(i=0; i < cat->count; ++i) {
+	  uint32_t num = useSao ? cat->sao[i] : cat->stars[i].cat ;
+	  if( num == 0 )
+	    continue ;
+	  for(h = hashNum(num, size); hash[h] >= 0; h = (h+1) & (size-1)) ;
+	  hash[h] = i ;
+	}
+	*rhash = hash ;
+	*rsize = size ;
+	return 0 ;
+}
+
+typedef struct {
+	  const char *name ;
+	  int32_t idx ;
+	} NameKey ;
+
+static int
+cmpName(const void *a, const void *b)
+{
+	const NameKey *na = a, *nb = b ;
+	int	r = strcasecmp(na->name, nb->name) ;
+	return r != 0 ? r : na->idx - nb->idx ;
+}
+
+static int
+buildLookup(StarCatalog *cat)
+{
+	NameKey	*keys ;
+	int	i, n ;
+
+	free(cat->cathash) ;
+	free(cat->saohash) ;
+	free(cat->byname) ;
+	cat->byname = NULL ;
+	cat->nbyname = 0 ;
+
+	if( makeHash(cat, 0, &cat->cathash, &cat->ncathash) < 0 ||
+	    makeHash(cat, 1, &cat->saohash, &cat->nsaohash) < 0 )
+	  return -1 ;
+
+	for(i=0, n=0; i < cat->count; ++i)
+	  n += cat->stars[i].name != 0 ;
+	if( n == 0 )
+	  return 0 ;
+	keys = malloc(n * sizeof(*keys)) ;
+	cat->byname = malloc(n * sizeof(*cat->byname)) ;
+	if( keys == NULL || cat->byname == NULL ) {
+	  free(keys) ;
+	  return -1 ;
+	}
+	for(i=0, n=0; i < cat->count; ++i)
+	  if( cat->stars[i].name != 0 ) {
+	    keys[n].name = StarCatalogName(cat, i) ;
+	    keys[n++].idx = i ;
+	  }
+	qsort(keys, n, sizeof(*keys), cmpName) ;
+	for(i=0; i < n; ++i)
+	  cat->byname[i] = keys[i].idx ;
+	cat->nbyname = n ;
+	free(keys) ;
+	return 0 ;
+}
+
+
+/**
+ * Find a star by catalog number: Yale/HR # for catalogs built from
+ * the Yale catalog, HIP # for Hipparcos, TYC_NUMBER() for Tycho-2.
+ * If several stars share the number, any one of them is returned.
+ * Stars with catalog # 0 are not indexed.
+ * Unindexed catalogs are searched linearly.
+ *
+ * @return index of the star, or -1 if not found
+ */
+int
+StarCatalogFind(const StarCatalog *cat, uint32_t num)
+{
+	uint32_t h ;
+	int	i ;
+
+	if( num == 0 )
+	  return -1 ;
+	if( cat->cells == NULL ) {
+	  for(i=0; i < cat->count; ++i)
+	    if( cat->stars[i].cat == num )
+	      return i ;
+	  return -1 ;
+	}
+	if( cat->cathash == NULL )
+	  return -1 ;
+	for(h = hashNum(num, cat->ncathash); (i = cat->cathash[h]) >= 0;
+	    h = (h+1) & (cat->ncathash-1))
+	  if( cat->stars[i].cat == num )
+	    return i ;
+	return -1 ;
+}
+
+
+/**
+ * Find a star by SAO number.
+ * @return index of the star, or -1 if not found
+ */
+int
+StarCatalogFindSAO(const StarCatalog *cat, uint32_t sao)
+{
+	uint32_t h ;
+	int	i ;
+
+	if( sao == 0 || cat->sao == NULL )
+	  return -1 ;
+	if( cat->cells == NULL ) {
+	  for(i=0; i < cat->count; ++i)
+	    if( cat->sao[i] == sao )
+	      return i ;
+	  return -1 ;
+	}
+	if( cat->saohash == NULL )
+	  return -1 ;		/* no star has an SAO # */
+	for(h = hashNum(sao, cat->nsaohash); (i = cat->saohash[h]) >= 0;
+	    h = (h+1) & (cat->nsaohash-1))
+	  if( cat->sao[i] == sao )
+	    return i ;
+	return -1 ;
+}
+
+
+/**
+ * Find a deep-sky object by Messier number.  There are only 110, so
+ * this is a scan of the shapes; no index is kept.
+ * @return index of the object, or -1 if not found
+ */
+int
+StarCatalogFindMessier(const StarCatalog *cat, int m)
+{
+	int	i ;
+
+	if( m <= 0 || cat->shape == NULL )
+	  return -1 ;
+	for(i=0; i < cat->count; ++i)
+	  if( cat->shape[i].messier == m )
+	    return i ;
+	return -1 ;
+}
+
+
+/**
+ * Find stars whose names begin with prefix, ignoring case; an empty
+ * prefix matches every named star.  Up to max indices are written
+ * to idx[], in name order if the catalog is indexed, otherwise in
+ * catalog order.
+ *
+ * @return total number of matching stars, which may exceed max
+ */
+int
+StarCatalogFindName(const StarCatalog *cat, const char *prefix,
+	int *idx, int max)
+{
+	size_t	len = strlen(prefix) ;
+	int	lo, hi, first, i, count = 0 ;
+
+	if( cat->cells == NULL ) {
+	  for(i=0; i < cat->count; ++i) {
+	    const char *name = StarCatalogName(cat, i) ;
+	    if( name != NULL && strncasecmp(name, prefix, len) == 0 ) {
+	      if( count < max )
+		idx[count] = i ;
+	      ++count ;
+	    }
+	  }
+	  return count ;
+	}
+
+	/* first name >= prefix */
+	for(lo = 0, hi = cat->nbyname; lo < hi; ) {
+	  int mid = (lo+hi)/2 ;
+	  if( strncasecmp(StarCatalogName(cat, cat->byname[mid]), prefix, len) < 0 )
+	    lo = mid+1 ;
+	  else
+	    hi = mid ;
+	}
+	first = lo ;
+	/* first name > prefix */
+	for(hi = cat->nbyname; lo < hi; ) {
+	  int mid = (lo+hi)/2 ;
+	  if( strncasecmp(StarCatalogName(cat, cat->byname[mid]), prefix, len) <= 0 )
+	    lo = mid+1 ;
+	  else
+	    hi = mid ;
+	}
+
+	count = lo - first ;
+	for(i=0; i < count && i < max; ++i)
+	  idx[i] = cat->byname[first+i] ;
+	return count ;
+}
+
+
+/*
+ * Bring the right ascensions of a query box into 0..360, keeping its
+ * width: ra1 < ra0 afterwards if and only if the box wraps through 0.
+ * A box 360 degrees or wider becomes 0..360.
+ */
+static void
+normalizeBox(double *ra0, double *ra1)
+{
+	double	span = *ra1 - *ra0 ;
+
+	if( span >= 360. ) {
+	  *ra0 = 0. ;
+	  *ra1 = 360. ;
+	  return ;
+	}
+	if( span < 0. )
+	  span = limitAngle(span) ;
+	*ra0 = limitAngle(*ra0) ;
+	*ra1 = *ra0 + span ;
+	if( *ra1 > 360. )
+	  *ra1 -= 360. ;
+}
+
+/**
+ * Call fn() for each range of cells that overlap a box.  ra0, ra1
+ * in degrees, ra1 < ra0 wraps through 0.
+ */
+static void
+boxCells(const StarCatalog *cat, double ra0, double ra1, double d0, double d1,
+	void (*fn)(const StarCatalog *, int c0, int c1, void *), void *arg)
+{
+	int	wrap, z ;
+
+	if( d1 < d0 )
+	  return ;
+	normalizeBox(&ra0, &ra1) ;
+	wrap = ra1 < ra0 ;
+	for(z = decZone(d0); z <= decZone(d1); ++z)
+	{
+	  int	first = cat->zones[z] ;
+	  int	n = cat->zones[z+1] - first ;
+	  int	c0 = (int)floor(ra0 / 360. * n) ;
+	  int	c1 = ra1 >= 360. ? n-1 : (int)floor(ra1 / 360. * n) ;
+	  if( c1 >= n ) c1 = n-1 ;
+	  if( wrap ) {
+	    (*fn)(cat, first+c0, first+n-1, arg) ;
+	    (*fn)(cat, first, first+c1, arg) ;
+	  }
+	  else
+	    (*fn)(cat, first+c0, first+c1, arg) ;
+	}
+}
+
+typedef struct {
+	  int	*ranges ;
+	  int	n ;
+	} RangeQuery ;
+
+static void
+rangeCells(const StarCatalog *cat, int c0, int c1, void *arg)
+{
+	RangeQuery *q = arg ;
+	int	first = cat->cells[c0], end = cat->cells[c1+1] ;
+
+	if( first == end )
+	  return ;
+	if( q->n > 0 && q->ranges[2*q->n-1] == first )
+	  q->ranges[2*q->n-1] = end ;	/* continues the last range */
+	else {
+	  q->ranges[2*q->n] = first ;
+	  q->ranges[2*q->n+1] = end ;
+	  ++q->n ;
+	}
+}
+
+/**
+ * Find the records of an indexed catalog in the cells overlapping a
+ * box, for callers that do their own filtering.  Each range is a
+ * pair first,end of record indices.  ranges must have room for
+ * 4*CAT_ZONES ints.
+ *
+ * @return number of ranges, or -1 if the catalog is not indexed
+ */
+int
+StarCatalogRanges(const StarCatalog *cat,
+	double ra0, double ra1, double d0, double d1, int *ranges)
+{
+	RangeQuery q ;
+
+	if( cat->cells == NULL )
+	  return -1 ;
+	q.ranges = ranges ;
+	q.n = 0 ;
+	boxCells(cat, ra0, ra1, d0, d1, rangeCells, &q) ;
+	return q.n ;
+}
+
+typedef struct {
+	  int16_t mag ;
+	  int64_t r0, r1 ;
+	  int32_t dec0, dec1 ;
+	  int	wrap ;
+	  int	*idx ;
+	  int	count ;
+	} BoxQuery ;
+
+static void
+selectCells(const StarCatalog *cat, int c0, int c1, void *arg)
+{
+	BoxQuery *q = arg ;
+	int	i, end = cat->cells[c1+1] ;
+
+	for(i = cat->cells[c0]; i < end; ++i)
+	{
+	  const CompactStar *c = &cat->stars[i] ;
+	  int64_t ra = c->ra ;
+	  if( c->mag > q->mag ) {
+	    /* rest of this cell is fainter; skip to the next one */
+	    int cell = starCell(cat, c->ra, c->dec) ;
+	    i = cat->cells[cell+1] - 1 ;
+	    continue ;
+	  }
+	  if( c->dec < q->dec0 || c->dec > q->dec1 )
+	    continue ;
+	  if( q->wrap ? (ra < q->r0 && ra > q->r1) : (ra < q->r0 || ra > q->r1) )
+	    continue ;
+	  if( q->idx != NULL )
+	    q->idx[q->count] = i ;
+	  ++q->count ;
+	}
+}
+
+
+/**
+ * Return the name of star i, or NULL.
+ */
+const char *
+StarCatalogName(const StarCatalog *cat, int i)
+{
+	int	name = cat->stars[i].name ;
+	return name != 0 ? cat->names + cat->nameoff[name] : NULL ;
+}
+
+
+/**
+ * Expand star i of the catalog into a YaleStar.  The name points
+ * into the catalog's pool.
+ */
+void
+StarCatalogGet(const StarCatalog *cat, int i, YaleStar *ys)
+{
+	const CompactStar *c = &cat->stars[i] ;
+
+	expandStar(c, &ys->s) ;
+	ys->s.sao = cat->sao != NULL ? cat->sao[i] : 0 ;
+	ys->s.name = (char *)StarCatalogName(cat, i) ;
+	if( c->cons == 0 )
+	  ys->cons[0] = '\0' ;
+	else
+	  memcpy(ys->cons, constellations[c->cons], 3) ;
+	ys->yale_cat = c->cat ;
+}
+
+
+/**
+ * Find all stars of magnitude maxmag or brighter in the box ra0..ra1,
+ * d0..d1 (degrees; ra1 < ra0, or ra0 < 0, wraps through 0).  Indices of the stars
+ * found are written to idx[], which must have room for cat->count
+ * entries, or may be NULL to just count.
+ *
+ * If the catalog has been indexed, only the cells overlapping the
+ * box are read, and the stars are returned in cell order.
+ *
+ * @return number of stars found
+ */
+int
+StarCatalogSelect(const StarCatalog *cat, float maxmag,
+	double ra0, double ra1, double d0, double d1, int *idx)
+{
+	const CompactStar *c = cat->stars ;
+	int64_t	r0, r1 ;
+	int32_t	dec0 = lround(d0 * CU_PER_DEG) ;
+	int32_t	dec1 = lround(d1 * CU_PER_DEG) ;
+	int16_t	mag = clamp16(maxmag * 1000.) ;
+	int	wrap ;
+	int	count = 0 ;
+	int	i ;
+
+	normalizeBox(&ra0, &ra1) ;
+	r0 = llround(ra0 * CU_PER_DEG) ;
+	r1 = llround(ra1 * CU_PER_DEG) ;
+	wrap = ra1 < ra0 ;
+	if( cat->cells != NULL ) {
+	  BoxQuery q ;
+	  q.mag = mag ;
+	  q.r0 = r0 ; q.r1 = r1 ;
+	  q.dec0 = dec0 ; q.dec1 = dec1 ;
+	  q.wrap = wrap ;
+	  q.idx = idx ;
+	  q.count = 0 ;
+	  boxCells(cat, ra0, ra1, d0, d1, selectCells, &q) ;
+	  return q.count ;
+	}
+
+	for(i=0; i < cat->count; ++i, ++c)
+	{
+	  int64_t ra = c->ra ;
+	  if( c->mag > mag || c->dec < dec0 || c->dec > dec1 )
+	    continue ;
+	  if( wrap ? (ra < r0 && ra > r1) : (ra < r0 || ra > r1) )
+	    continue ;
+	  if( idx != NULL )
+	    idx[count] = i ;
+	  ++count ;
+	}
+	return count ;
+}
+
+
+/**
+ * Move a batch of stars from their catalog epoch by dt years of
+ * proper motion.  All arrays are parallel, one entry per star, and
+ * the loop has no branches so the compiler can vectorize it.
+ *
+ * The motion is done with space vectors, so it is correct near
+ * the poles and over long intervals: the star is taken to move in
+ * a straight line at constant speed.  If parallax and radial velocity
+ * are given, this includes perspective acceleration.
+ *
+ * @param n        number of stars
+ * @param ra,dec   catalog position, degrees
+ * @param pmr,pmd  proper motion, arcsec/year; pmr is along the great
+ *		circle (i.e. already multiplied by cos(dec))
+ * @param plx      parallax, arcsec, or NULL
+ * @param rv       radial velocity, km/s, or NULL
+ * @param dt       years from catalog epoch to desired epoch
+ * @param rra,rdec returned position, degrees.  May be the same
+ *		arrays as ra,dec.
+ */
+void
+propagateStars(int n, const double *ra, const double *dec,
+	const double *pmr, const double *pmd,
+	const double *plx, const double *rv,
+	double dt, double *rra, double *rdec)
+{
+	const double k = dt * RAD / 3600. ;	/* arcsec -> radians * dt */
+	int	i ;
+
+	for(i=0; i < n; ++i)
+	{
+	  double sa = sin(ra[i]*RAD), ca = cos(ra[i]*RAD) ;
+	  double sd = sin(dec[i]*RAD), cd = cos(dec[i]*RAD) ;
+	  double mr = 0. ;		/* radial proper motion * dt */
+	  double x,y,z ;
+
+	  if( plx != NULL && rv != NULL )
+	    mr = rv[i] * plx[i] / AU_KMS_YR * k ;
+
+	  /* r = (ca*cd, sa*cd, sd)
+	   * p = (-sa, ca, 0)		direction of increasing RA
+	   * q = (-ca*sd, -sa*sd, cd)	direction of increasing dec
+	   * position = r*(1+mr) + p*pmr*k + q*pmd*k
+	   */
+	  x = ca*cd*(1.+mr) - sa*pmr[i]*k - ca*sd*pmd[i]*k ;
+	  y = sa*cd*(1.+mr) + ca*pmr[i]*k - sa*sd*pmd[i]*k ;
+	  z = sd*(1.+mr) + cd*pmd[i]*k ;
+
+	  rra[i] = limitAngle(atan2(y,x) * DEG) ;
+	  rdec[i] = atan2(z, sqrt(x*x + y*y)) * DEG ;
+	}
+}
+
+
+/*
+ * Box for the coarse pass of StarCatalogSelectEpoch(): the query box,
+ * in compact units, widened by margin degrees of motion.
+ */
+static void
+widenBox(double ra0, double ra1, double d0, double d1, double margin,
+	BoxQuery *b)
+{
+	double	dmax = fmax(fabs(d0), fabs(d1)) + margin ;
+	double	rmargin = dmax >= 89. ? 180. : margin / cos(RAD*dmax) ;
+	double	span = (ra1 < ra0 ? ra1 + 360. : ra1) - ra0 + 2.*rmargin ;
+
+	b->dec0 = lround(fmax(d0 - margin, -90.) * CU_PER_DEG) ;
+	b->dec1 = lround(fmin(d1 + margin, 90.) * CU_PER_DEG) ;
+	b->wrap = ra1 < ra0 ;
+	if( span >= 360. ) {
+	  b->r0 = 0 ;
+	  b->r1 = 0xffffffff ;
+	  b->wrap = 0 ;
+	  return ;
+	}
+	b->r0 = llround((ra0 - rmargin) * CU_PER_DEG) ;
+	b->r1 = llround((ra1 + rmargin) * CU_PER_DEG) ;
+	if( b->r0 < 0 ) { b->r0 += 1LL<<32 ; b->wrap = 1 ; }
+	if( b->r1 >= 1LL<<32 ) { b->r1 -= 1LL<<32 ; b->wrap = 1 ; }
+}
+
+/* largest motion, in degrees, given the years from J2000 */
+static double
+motionMargin(const CellMotion *m, double years)
+{
+	return (m->pm * years + m->drift) * .001 / 3600. + 1./3600. ;
+}
+
+typedef struct {
+	  double ra0, ra1, d0, d1 ;	/* the box */
+	  double jd ;
+	  double years ;		/* |jd - J2000|, years */
+	  int16_t mag ;
+	  int	*idx ;
+	  double *ra, *dec ;
+	  int	count ;
+	  double margin ;		/* margin of box, degrees */
+	  BoxQuery box ;		/* coarse box */
+	  /* block of stars of a single epoch */
+	  double bra[STAR_BLOCK], bdec[STAR_BLOCK] ;
+	  double bpmr[STAR_BLOCK], bpmd[STAR_BLOCK] ;
+	  int	bidx[STAR_BLOCK] ;
+	  int	nb ;
+	  int	epoch ;
+	} EpochQuery ;
+
+/* move the block to the query epoch and keep the stars in the box */
+static void
+epochFlush(EpochQuery *q)
+{
+	int	j, k ;
+
+	if( q->nb == 0 )
+	  return ;
+	propagateStars(q->nb, q->bra, q->bdec, q->bpmr, q->bpmd, NULL, NULL,
+		(q->jd - (JD2000 + (q->epoch-100)*365.25)) / 365.25,
+		q->bra, q->bdec) ;
+	for(j=0; j < q->nb; ++j) {
+	  if( q->bdec[j] < q->d0 || q->bdec[j] > q->d1 )
+	    continue ;
+	  if( q->ra1 < q->ra0 ? (q->bra[j] < q->ra0 && q->bra[j] > q->ra1)
+			      : (q->bra[j] < q->ra0 || q->bra[j] > q->ra1) )
+	    continue ;
+	  k = q->count++ ;
+	  q->idx[k] = q->bidx[j] ;
+	  q->ra[k] = q->bra[j] ;
+	  q->dec[k] = q->bdec[j] ;
+	}
+	q->nb = 0 ;
+}
+
+/* add record i to the block, if it is in the coarse box */
+static void
+epochStar(const StarCatalog *cat, int i, EpochQuery *q)
+{
+	const CompactStar *c = &cat->stars[i] ;
+	const BoxQuery *b = &q->box ;
+	int64_t	r = c->ra ;
+
+	if( c->dec < b->dec0 || c->dec > b->dec1 )
+	  return ;
+	if( b->wrap ? (r < b->r0 && r > b->r1) : (r < b->r0 || r > b->r1) )
+	  return ;
+	if( q->nb > 0 && c->epoch != q->epoch )
+	  epochFlush(q) ;
+	q->epoch = c->epoch ;
+	q->bidx[q->nb] = i ;
+	q->bra[q->nb] = c->ra / CU_PER_DEG ;
+	q->bdec[q->nb] = c->dec / CU_PER_DEG ;
+	q->bpmr[q->nb] = c->pmr * .001 ;
+	q->bpmd[q->nb] = c->pmd * .001 ;
+	if( ++q->nb == STAR_BLOCK )
+	  epochFlush(q) ;
+}
+
+/*
+ * Each cell is widened by its own fastest motion, so cells that
+ * hold only slow stars are skipped without reading them.
+ */
+static void
+epochCells(const StarCatalog *cat, int c0, int c1, void *arg)
+{
+	EpochQuery *q = arg ;
+	int	z, n, cell, i ;
+	int32_t	lo, hi ;
+
+	for(z=0; cat->zones[z+1] <= c0; ++z) ;
+	n = cat->zones[z+1] - cat->zones[z] ;
+	lo = lround((-90. + z*180./CAT_ZONES) * CU_PER_DEG) ;
+	hi = lround((-90. + (z+1)*180./CAT_ZONES) * CU_PER_DEG) ;
+
+	for(cell = c0; cell <= c1; ++cell)
+	{
+	  const BoxQuery *b = &q->box ;
+	  int	k = cell - cat->zones[z] ;
+	  int64_t a0 = ((int64_t)k << 32) / n ;
+	  int64_t a1 = ((int64_t)(k+1) << 32) / n - 1 ;
+	  double margin ;
+
+	  if( cat->cells[cell] == cat->cells[cell+1] )
+	    continue ;
+	  margin = motionMargin(&cat->motion[cell], q->years) ;
+	  if( margin != q->margin ) {
+	    widenBox(q->ra0, q->ra1, q->d0, q->d1, margin, &q->box) ;
+	    q->margin = margin ;
+	  }
+	  if( hi < b->dec0 || lo > b->dec1 )
+	    continue ;
+	  if( b->wrap ? (a1 < b->r0 && a0 > b->r1) : (a1 < b->r0 || a0 > b->r1) )
+	    continue ;
+	  for(i = cat->cells[cell]; i < cat->cells[cell+1]; ++i) {
+	    if( cat->stars[i].mag > q->mag )
+	      break ;			/* rest of the cell is fainter */
+	    epochStar(cat, i, q) ;
+	  }
+	}
+}
+
+
+/**
+ * Like StarCatalogSelect(), but the box is applied to positions
+ * moved to the given date by proper motion.  The positions found
+ * are returned in ra[] and dec[], parallel to idx[].
+ *
+ * The index records the fastest motion in each cell.  Only cells
+ * close enough to the box for their own fastest star to reach it are
+ * read, and their stars are rejected with integer compares against
+ * the box widened by that motion, so only stars near the box are
+ * actually moved.  Those are gathered into blocks and handed to
+ * propagateStars().
+ *
+ * @param jd      Julian date of the desired epoch
+ * @param idx     returned indices, room for cat->count entries
+ * @param ra,dec  returned positions, degrees, same size as idx
+ * @return number of stars found
+ */
+int
+StarCatalogSelectEpoch(const StarCatalog *cat, double jd, float maxmag,
+	double ra0, double ra1, double d0, double d1,
+	int *idx, double *ra, double *dec)
+{
+	EpochQuery q ;
+	CellMotion all ;
+	int	i ;
+
+	normalizeBox(&ra0, &ra1) ;
+	q.ra0 = ra0 ; q.ra1 = ra1 ;
+	q.d0 = d0 ; q.d1 = d1 ;
+	q.jd = jd ;
+	q.years = fabs(jd - JD2000) / 365.25 ;
+	q.mag = clamp16(maxmag * 1000.) ;
+	q.idx = idx ; q.ra = ra ; q.dec = dec ;
+	q.count = 0 ;
+	q.nb = 0 ;
+
+	if( cat->motion != NULL ) {
+	  /* cells that the fastest star in the catalog could reach */
+	  const BoxQuery *b = &q.box ;
+	  q.margin = motionMargin(&cat->motion[cat->ncells], q.years) ;
+	  widenBox(ra0, ra1, d0, d1, q.margin, &q.box) ;
+	  if( b->r1 - b->r0 == 0xffffffff )
+	    boxCells(cat, 0., 360., b->dec0 / CU_PER_DEG, b->dec1 / CU_PER_DEG,
+		epochCells, &q) ;
+	  else
+	    boxCells(cat, b->r0 / CU_PER_DEG, b->r1 / CU_PER_DEG,
+		b->dec0 / CU_PER_DEG, b->dec1 / CU_PER_DEG, epochCells, &q) ;
+	}
+	else {
+	  memset(&all, 0, sizeof(all)) ;
+	  for(i=0; i < cat->count; ++i)
+	    starMotion(&cat->stars[i], &all) ;
+	  widenBox(ra0, ra1, d0, d1, motionMargin(&all, q.years), &q.box) ;
+	  for(i=0; i < cat->count; ++i)
+	    if( cat->stars[i].mag <= q.mag )
+	      epochStar(cat, i, &q) ;
+	}
+	epochFlush(&q) ;
+	return q.count ;
+}
+
+
+/*
+ * Binary catalog file.  Written by StarCatalogWrite() from an indexed
+ * catalog, and memory-mapped by StarCatalogOpen(), so opening even
+ * a multi-million star catalog costs almost nothing.  The data is
+ * in native byte order.  Files of any other version are rejected.
+ *
+ *	header
+ *	CompactStar stars[count]
+ *	uint32_t sao[count]
+ *	DsoShape shape[nshape]		count, or 0 if no deep-sky objects
+ *	uint32_t nameoff[nnames]
+ *	int32_t zones[CAT_ZONES+1]
+ *	int32_t cells[ncells+1]
+ *	CellMotion motion[ncells+1]
+ *	int32_t cathash[ncathash]
+ *	int32_t saohash[nsaohash]
+ *	int32_t byname[nbyname]
+ *	char names[namesize]
+ */
+
+#define	CAT_MAGIC	"ASTROCAT"
+#define	CAT_VERSION	1
+
+typedef struct {
+	  char	magic[8] ;
+	  uint32_t version ;
+	  uint32_t count ;
+	  uint32_t nnames ;
+	  uint32_t ncells ;
+	  uint32_t ncathash ;
+	  uint32_t nsaohash ;
+	  uint32_t nbyname ;
+	  uint32_t nshape ;
+	  uint64_t namesize ;
+	} CatalogHeader ;
+
+
+/*
+ * fwrite() n items, if there are any; an empty table may have a NULL
+ * pointer, which fwrite() must not be given.
+ */
+static int
+writeItems(const void *ptr, size_t size, size_t n, FILE *ofile)
+{
+	return n == 0 || fwrite(ptr, size, n, ofile) == n ;
+}
+
+/**
+ * Write an indexed catalog to a binary file.
+ * @return 0 on success, -1 on error.
+ */
+int
+StarCatalogWrite(const StarCatalog *cat, const char *filename)
+{
+	CatalogHeader h ;
+	uint32_t zero = 0 ;
+	FILE	*ofile ;
+	int	ok ;
+
+	if( cat->cells == NULL )
+	  return -1 ;
+
+	if( (ofile = fopen(filename, "w")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	memset(&h, 0, sizeof(h)) ;
+	memcpy(h.magic, CAT_MAGIC, sizeof(h.magic)) ;
+	h.version = CAT_VERSION ;
+	h.count = cat->count ;
+	h.nnames = cat->nnames > 0 ? cat->nnames : 1 ;
+	h.ncells = cat->ncells ;
+	h.ncathash = cat->ncathash ;
+	h.nsaohash = cat->nsaohash ;
+	h.nbyname = cat->nbyname ;
+	h.nshape = cat->shape != NULL ? cat->count : 0 ;
+	h.namesize = cat->namesize ;
+
+	ok = writeItems(&h, sizeof(h), 1, ofile) &&
+	  writeItems(cat->stars, sizeof(*cat->stars), cat->count, ofile) &&
+	  writeItems(cat->sao, sizeof(*cat->sao), cat->count, ofile) &&
+	  writeItems(cat->shape, sizeof(DsoShape), h.nshape, ofile) &&
+	  (cat->nnames > 0 ?
+	    writeItems(cat->nameoff, sizeof(*cat->nameoff), cat->nnames, ofile) :
+	    writeItems(&zero, sizeof(zero), 1, ofile)) &&
+	  writeItems(cat->zones, sizeof(*cat->zones), CAT_ZONES+1, ofile) &&
+	  writeItems(cat->cells, sizeof(*cat->cells), cat->ncells+1, ofile) &&
+	  writeItems(cat->motion, sizeof(*cat->motion), cat->ncells+1, ofile) &&
+	  writeItems(cat->cathash, sizeof(int32_t), h.ncathash, ofile) &&
+	  writeItems(cat->saohash, sizeof(int32_t), h.nsaohash, ofile) &&
+	  writeItems(cat->byname, sizeof(int32_t), h.nbyname, ofile) &&
+	  writeItems(cat->names, 1, cat->namesize, ofile) ;
+
+	if( fclose(ofile) != 0 )
+	  ok = 0 ;
+	if( !ok )
+	  perror(filename) ;
+	return ok ? 0 : -1 ;
+}
+
+
+/**
+ * Map a catalog file written by StarCatalogWrite().  The catalog is
+ * read-only; pages are read from disk as queries touch them.
+ * @return number of stars, or -1 on error.
+ */
+int
+StarCatalogOpen(const char *filename, StarCatalog *cat)
+{
+	const CatalogHeader *h ;
+	struct stat st ;
+	char	*ptr ;
+	size_t	need ;
+	int	fd ;
+
+	memset(cat, 0, sizeof(*cat)) ;
+
+	if( (fd = open(filename, O_RDONLY)) < 0 ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+	if( fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*h) ) {
+	  fprintf(stderr, "%s: not a star catalog\n", filename) ;
+	  close(fd) ;
+	  return -1 ;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) ;
+	close(fd) ;
+	if( ptr == MAP_FAILED ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	h = (const CatalogHeader *)ptr ;
+	need = sizeof(*h) + h->count*(sizeof(CompactStar) + sizeof(uint32_t)) +
+		h->nshape*sizeof(DsoShape) + h->nnames*sizeof(uint32_t) +
+		(CAT_ZONES+1 + h->ncells+1)*sizeof(int32_t) +
+		(h->ncells+1)*sizeof(CellMotion) +
+		((size_t)h->ncathash + h->nsaohash + h->nbyname)*sizeof(int32_t) +
+		h->namesize ;
+	if( memcmp(h->magic, CAT_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->version != CAT_VERSION ||
+	    (h->nshape != 0 && h->nshape != h->count) || need > (size_t)st.st_size )
+	{
+	  fprintf(stderr, "%s: not a star catalog\n", filename) ;
+	  munmap(ptr, st.st_size) ;
+	  return -1 ;
+	}
+
+	cat->map = ptr ;
+	cat->mapsize = st.st_size ;
+	cat->count = h->count ;
+	cat->nnames = h->nnames ;
+	cat->ncells = h->ncells ;
+	cat->ncathash = h->ncathash ;
+	cat->nsaohash = h->nsaohash ;
+	cat->nbyname = h->nbyname ;
+	cat->namesize = h->namesize ;
+	ptr += sizeof(*h) ;
+	cat->stars = (CompactStar *)ptr ;  ptr += h->count*sizeof(CompactStar) ;
+	cat->sao = (uint32_t *)ptr ;	   ptr += h->count*sizeof(uint32_t) ;
+	cat->shape = h->nshape > 0 ? (DsoShape *)ptr : NULL ;
+					   ptr += h->nshape*sizeof(DsoShape) ;
+	cat->nameoff = (uint32_t *)ptr ;   ptr += h->nnames*sizeof(uint32_t) ;
+	cat->zones = (int32_t *)ptr ;	   ptr += (CAT_ZONES+1)*sizeof(int32_t) ;
+	cat->cells = (int32_t *)ptr ;	   ptr += (h->ncells+1)*sizeof(int32_t) ;
+	cat->motion = (CellMotion *)ptr ;  ptr += (h->ncells+1)*sizeof(CellMotion) ;
+	cat->cathash = h->ncathash > 0 ? (int32_t *)ptr : NULL ;
+					   ptr += h->ncathash*sizeof(int32_t) ;
+	cat->saohash = h->nsaohash > 0 ? (int32_t *)ptr : NULL ;
+					   ptr += h->nsaohash*sizeof(int32_t) ;
+	cat->byname = (int32_t *)ptr ;	   ptr += h->nbyname*sizeof(int32_t) ;
+	cat->names = ptr ;
+	return cat->count ;
+}
+
+
+/**
+ * Release everything owned by a StarCatalog.
+ */
+void
+FreeStarCatalog(StarCatalog *cat)
+{
+	if( cat->map != NULL )
+	  munmap(cat->map, cat->mapsize) ;
+	else {
+	  free(cat->stars) ;
+	  free(cat->sao) ;
+	  free(cat->shape) ;
+	  free(cat->names) ;
+	  free(cat->nameoff) ;
+	  free(cat->zones) ;
+	  free(cat->cells) ;
+	  free(cat->motion) ;
+	  free(cat->cathash) ;
+	  free(cat->saohash) ;
+	  free(cat->byname) ;
+	}
+	memset(cat, 0, sizeof(*cat)) ;
+}
+
+
+#ifdef STANDALONE
+
+/*
+ * Benchmark.  With a catalog file argument, maps that file; otherwise
+ * builds a synthetic catalog of 2.5 million stars, about the size of
+ * Tycho-2, with a realistic magnitude distribution and Tycho numbers.
+ * Reports load time, memory and the latency of typical field queries.
+ */
+
+#include <time.h>
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+int
+main(int argc, char **argv)
+{
+	StarCatalog cat ;
+	int	*idx ;
+	int	nq = 10000 ;
+	long	total = 0 ;
+	double	t0, t ;
+	size_t	mem ;
+	int	i ;
+
+	srand48(1) ;
+	t0 = now() ;
+	if( argc > 1 ) {
+	  if( StarCatalogOpen(argv[1], &cat) < 0 )
+	    exit(1) ;
+	  printf("mapped %d stars in %.3f ms\n", cat.count, (now()-t0)*1e3) ;
+	}
+	else {
+	  memset(&cat, 0, sizeof(cat)) ;
+	  for(i=0; i < 2500000; ++i) {
+	    Star s ;
+	    CompactStar c ;
+	    memset(&s, 0, sizeof(s)) ;
+	    s.ra = 360. * drand48() ;
+	    s.dec = asind(2.*drand48() - 1.) ;
+	    s.mag = 12.5 + log10(drand48() + 1e-9) * 2.5 ;
+	    s.epoch = 2000 ;
+	    strcpy(s.type, "SS") ;
+	    compactStar(&s, &c) ;
+	    c.cat = TYC_NUMBER(1 + i % 9537, 1 + i / 9537, 1 + (i % 7 == 0)) ;
+	    if( i % 100 == 0 ) {		/* some names for lookups */
+	      char name[20] ;
+	      snprintf(name, sizeof(name), "Star %d", i) ;
+	      StarCatalogAdd(&cat, &c, i+1, name) ;
+	    }
+	    else
+	      StarCatalogAdd(&cat, &c, 0, NULL) ;
+	  }
+	  printf("built %d stars in %.3f s\n", cat.count, now()-t0) ;
+	  t0 = now() ;
+	  StarCatalogIndex(&cat) ;
+	  printf("indexed in %.3f s\n", now()-t0) ;
+	}
+
+	mem = cat.count * (sizeof(CompactStar) + sizeof(uint32_t)) +
+		(cat.ncells + 1 + cat.ncathash + cat.nsaohash + cat.nbyname) *
+		sizeof(int32_t) + cat.nnames * sizeof(uint32_t) + cat.namesize ;
+	printf("catalog memory: %.1f MB, %d cells\n", mem / 1048576., cat.ncells) ;
+
+	idx = malloc(cat.count * sizeof(*idx)) ;
+
+	for(i=0; i < 2; ++i)
+	{
+	  int indexed = i == 0 ;
+	  int32_t *cells = cat.cells ;
+	  int j, n = indexed ? nq : 20 ;
+	  if( !indexed )
+	    cat.cells = NULL ;
+	  total = 0 ;
+	  t0 = now() ;
+	  for(j=0; j < n; ++j) {
+	    double ra = 360. * drand48() ;
+	    double dec = asind(2.*drand48() - 1.) ;
+	    double w = 1. / cosd(dec) ;		/* 2x2 degree field */
+	    if( dec < -88. || dec > 88. ) w = 360. ;
+	    total += StarCatalogSelect(&cat, 11.,
+		limitAngle(ra - w), limitAngle(ra + w),
+		dec - 1., dec + 1., idx) ;
+	  }
+	  t = now() - t0 ;
+	  printf("%s: %d 2x2 degree fields, mag <= 11, "
+		"%.1f stars/field, %.1f us/query\n",
+		indexed ? "indexed" : "linear scan",
+		n, (double)total / n, t / n * 1e6) ;
+	  cat.cells = cells ;
+	}
+
+	t0 = now() ;
+	for(i=0, total=0; i < nq; ++i)
+	  total += StarCatalogFind(&cat, cat.stars[lrand48() % cat.count].cat) >= 0 ;
+	printf("catalog # lookup: %ld/%d found, %.3f us/lookup\n",
+		total, nq, (now()-t0) / nq * 1e6) ;
+
+	t0 = now() ;
+	for(i=0, total=0; i < nq; ++i) {
+	  char prefix[20] ;
+	  snprintf(prefix, sizeof(prefix), "star %ld", lrand48() % 1000) ;
+	  total += StarCatalogFindName(&cat, prefix, idx, 10) ;
+	}
+	printf("name prefix search: %d names, %.1f matches/search, "
+		"%.3f us/search\n", cat.nbyname, (double)total / nq,
+		(now()-t0) / nq * 1e6) ;
+
+	free(idx) ;
+	FreeStarCatalog(&cat) ;
+	exit(0) ;
+}
+#endif	/* STANDALONE */
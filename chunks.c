@@ -0,0 +1,265 @@
+	/* Parallel parsing of large text files */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * The big catalogs are distributed as text, one record per line.
+ * Rather than read them with fgets(), a loader can map the file,
+ * cut it into chunks at line boundaries, and parse the chunks on
+ * several threads at once.  Each chunk's worker leaves its results
+ * in the TextChunk; since chunks are numbered in file order, the
+ * loader then merges them in catalog order.
+ *
+ * const char *
+ * mapTextFile(const char *filename, size_t *size)
+ *	Map a file read-only.
+ *
+ * void
+ * unmapTextFile(const char *text, size_t size)
+ *	Release a mapped file.
+ *
+ * int
+ * splitTextChunks(const char *text, size_t size, int nchunks,
+ *		TextChunk *chunks)
+ *	Divide text into up to nchunks pieces of whole lines.
+ *
+ * int
+ * runTextChunks(TextChunk *chunks, int n, int nthreads,
+ *		TextChunkWorker fn, void *arg)
+ *	Call fn on every chunk, using a pool of nthreads threads.
+ *
+ * const char *
+ * textLine(const char **ptr, const char *end, char *buf, size_t bufsize)
+ *	Copy the next line of a chunk into buf.
+ *
+ * int
+ * numThreads()
+ *	Number of worker threads to use by default.
+ */
+
+#define	MIN_CHUNK	65536	/* don't bother splitting finer than this */
+
+
+/**
+ * Map a text file read-only.  Empty files are not an error; they
+ * return a non-NULL pointer with *size zero.
+ * @return pointer to the text, or NULL on error.
+ */
+const char *
+mapTextFile(const char *filename, size_t *size)
+{
+	struct stat st ;
+	void	*ptr ;
+	int	fd ;
+
+	if( (fd = open(filename, O_RDONLY)) < 0 ) {
+	  perror(filename) ;
+	  return NULL ;
+	}
+	if( fstat(fd, &st) < 0 ) {
+	  perror(filename) ;
+	  close(fd) ;
+	  return NULL ;
+	}
+	*size = st.st_size ;
+	if( st.st_size == 0 ) {
+	  close(fd) ;
+	  return "" ;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) ;
+	close(fd) ;
+	if( ptr == MAP_FAILED ) {
+	  perror(filename) ;
+	  return NULL ;
+	}
+	madvise(ptr, st.st_size, MADV_SEQUENTIAL) ;
+	return ptr ;
+}
+
+
+void
+unmapTextFile(const char *text, size_t size)
+{
+	if( size > 0 )
+	  munmap((void *)text, size) ;
+}
+
+
+/**
+ * Divide text into up to nchunks pieces of roughly equal size, each
+ * starting at the beginning of a line and ending just after a
+ * newline (or at the end of the text).  Chunks are never smaller
+ * than MIN_CHUNK bytes except for the last one.
+ * @return number of chunks, which may be fewer than requested.
+ */
+int
+splitTextChunks(const char *text, size_t size, int nchunks, TextChunk *chunks)
+{
+	const char *ptr = text ;
+	const char *end = text + size ;
+	size_t	step ;
+	int	n ;
+
+	if( nchunks < 1 )
+	  nchunks = 1 ;
+	step = size / nchunks ;
+	if( step < MIN_CHUNK )
+	  step = MIN_CHUNK ;
+
+	for(n = 0; ptr < end && n < nchunks; ++n)
+	{
+	  const char *next ;
+	  if( n == nchunks-1 || (size_t)(end - ptr) <= step )
+	    next = end ;
+	  else if( (next = memchr(ptr + step, '\n', end - ptr - step)) == NULL )
+	    next = end ;
+	  else
+	    ++next ;
+
+	  memset(&chunks[n], 0, sizeof(chunks[n])) ;
+	  chunks[n].start = ptr ;
+	  chunks[n].end = next ;
+	  chunks[n].index = n ;
+	  ptr = next ;
+	}
+	return n ;
+}
+
+
+/**
+ * Copy the next line from *ptr into buf, without the newline,
+ * padded with blanks to bufsize-1 characters and nul-terminated.
+ * Padding means fixed-column fields past the end of a short line
+ * read as blank, just as they would in the printed catalog.  Lines
+ * longer than the buffer are truncated.  *ptr is advanced past the
+ * line.
+ * @return buf, or NULL at the end of the chunk.
+ */
+const char *
+textLine(const char **ptr, const char *end, char *buf, size_t bufsize)
+{
+	const char *p = *ptr ;
+	const char *nl ;
+	size_t	len ;
+
+	if( p >= end )
+	  return NULL ;
+	if( (nl = memchr(p, '\n', end - p)) == NULL )
+	  nl = end ;
+	*ptr = nl < end ? nl+1 : end ;
+
+	len = nl - p ;
+	if( len > bufsize-1 )
+	  len = bufsize-1 ;
+	memcpy(buf, p, len) ;
+	memset(buf+len, ' ', bufsize-1-len) ;
+	buf[bufsize-1] = '\0' ;
+	return buf ;
+}
+
+
+typedef struct {
+	TextChunk	*chunks ;
+	int		n ;
+	int		next ;		/* next chunk to hand out */
+	int		error ;
+	TextChunkWorker	fn ;
+	void		*arg ;
+	pthread_mutex_t	lock ;
+} ChunkPool ;
+
+static void *
+chunkThread(void *arg)
+{
+	ChunkPool *pool = arg ;
+	int	i ;
+
+	for(;;)
+	{
+	  pthread_mutex_lock(&pool->lock) ;
+	  i = pool->error ? pool->n : pool->next++ ;
+	  pthread_mutex_unlock(&pool->lock) ;
+	  if( i >= pool->n )
+	    break ;
+	  if( (*pool->fn)(&pool->chunks[i], pool->arg) != 0 ) {
+	    pthread_mutex_lock(&pool->lock) ;
+	    pool->error = 1 ;
+	    pthread_mutex_unlock(&pool->lock) ;
+	  }
+	}
+	return NULL ;
+}
+
+
+/**
+ * Call fn(chunk, arg) for every chunk, on a pool of up to nthreads
+ * threads (numThreads() if nthreads <= 0).  Threads take the next
+ * unclaimed chunk as they become free, so uneven chunks balance
+ * out.  fn may be called concurrently and must only write to its
+ * own chunk.  If fn returns nonzero, no further chunks are started.
+ * @return 0 on success, -1 if any call failed or threads could not
+ * be started.
+ */
+int
+runTextChunks(TextChunk *chunks, int n, int nthreads,
+	TextChunkWorker fn, void *arg)
+{
+	ChunkPool pool ;
+	pthread_t *threads ;
+	int	i, started ;
+
+	if( nthreads <= 0 )
+	  nthreads = numThreads() ;
+	if( nthreads > n )
+	  nthreads = n ;
+
+	pool.chunks = chunks ;
+	pool.n = n ;
+	pool.next = 0 ;
+	pool.error = 0 ;
+	pool.fn = fn ;
+	pool.arg = arg ;
+
+	if( nthreads <= 1 ) {
+	  for(i = 0; i < n; ++i)
+	    if( (*fn)(&chunks[i], arg) != 0 )
+	      return -1 ;
+	  return 0 ;
+	}
+
+	if( (threads = malloc(nthreads * sizeof(*threads))) == NULL )
+	  return -1 ;
+	pthread_mutex_init(&pool.lock, NULL) ;
+	for(started = 0; started < nthreads; ++started)
+	  if( pthread_create(&threads[started], NULL, chunkThread, &pool) != 0 )
+	    break ;
+	if( started == 0 )
+	  chunkThread(&pool) ;		/* do it ourselves, then */
+	for(i = 0; i < started; ++i)
+	  pthread_join(threads[i], NULL) ;
+	pthread_mutex_destroy(&pool.lock) ;
+	free(threads) ;
+
+	return pool.error ? -1 : 0 ;
+}
+
+
+/**
+ * Default number of worker threads: the number of online processors.
+ */
+int
+numThreads()
+{
+	long	n = sysconf(_SC_NPROCESSORS_ONLN) ;
+	return n > 0 ? n : 1 ;
+}
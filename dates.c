@@ -1,5 +1,6 @@
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 #include <math.h>
@@ -28,6 +29,16 @@
  * julian2time(double jdate, int *y, int *m, int *d, int *h, int *m, double *s)
  *	Convert a julian date to y/m/d h:m:s GMT
  *
+ * void
+ * date2julian_n(int n, const int *y, const int *m, const double *d,
+ *		double *jd)
+ * void
+ * julian2date_n(int n, const double *jd, int *y, int *m, int *d)
+ * void
+ * julian2time_n(int n, const double *jd, int *y, int *m, int *d,
+ *		int *h, int *m, double *s)
+ *	The same for arrays of dates
+ *
  * double
  * unix2julian(time_t)
  *	Convert unix time to julian
@@ -36,6 +47,43 @@
  * jnow()
  *	Return the current julian date.
  *
+ * void
+ * splitJD(double jdate, SplitJD *jd)
+ * double
+ * joinJD(const SplitJD *jd)
+ *	Convert between a julian date and a split one, day and fraction
+ *
+ * void
+ * jnowSplit(SplitJD *jd)
+ *	The current date, split
+ *
+ * void
+ * unix2splitJD_n(int n, const int64_t *t, SplitJD *jd)
+ * void
+ * unixNs2splitJD_n(int n, const int64_t *ns, SplitJD *jd)
+ * int64_t
+ * splitJD2unixNs(const SplitJD *jd)
+ *	Convert between Unix seconds or nanoseconds and split dates
+ *
+ * int
+ * parseJulian(const char *s, size_t len, SplitJD *jd)
+ * int
+ * parseJulian_n(int n, const char *const *str, double *jd, uint8_t *err)
+ *	Parse ISO-8601 or compact date/times, fast
+ *
+ * int
+ * iso2splitJD(const char *str, SplitJD *jd)
+ * int
+ * iso2splitJD_n(int n, const char *const *str, SplitJD *jd)
+ *	The same for NUL-terminated strings
+ *
+ * void
+ * splitJD2time(const SplitJD *jd, int *y, int *m, int *d, int *h,
+ *		int *m, double *s)
+ * double
+ * splitJD2sidereal(const SplitJD *jd)
+ *	julian2time() and time2sidereal() for split dates
+ *
  * double
  * julian2sidereal(double jdate)
  *	Return sidereal time in hours for a specific julian date
@@ -66,6 +114,16 @@
  *	hours to apparent sidereal time (correcting for nutation).
  *	meanTime + siderealMean2Apparent() = apparentTime
  *
+ * void
+ * siderealSeriesInit(SiderealSeries *s, double jdate, double step,
+ *		int apparent)
+ * double
+ * siderealSeriesNext(SiderealSeries *s)
+ * void
+ * siderealSeries_n(SiderealSeries *s, int n, int nlon, const double *lon,
+ *		double *lst)
+ *	Sidereal time at evenly spaced times, for one or many longitudes
+ *
  * int
  * date2yday(int y, int m, int d)
  *	Obtain the year of the day from y/m/d
@@ -141,33 +199,93 @@
  *
  * BUG?  This code does not seem to allow for the September 1752 adjustment,
  * unless it's built into the Gregorian conversion.
+ *
+ *  (It doesn't: that was the change in Britain and its colonies.  These
+ *  routines use the Gregorian calendar from 15 Oct 1582, as in [2].)
  */
 
 
+/*
+ * Integer cores shared by the scalar and array conversions, after
+ * Neri & Schneider, "Euclidean affine functions and their application
+ * to calendar algorithms" (2022).  The year is rotated to start in
+ * March, as in [2], and shifted forward by CAL_SHIFT years, a whole
+ * number of 400-year cycles, so that all the arithmetic is on
+ * non-negative 32-bit integers.  Divisions are then by constants,
+ * which compilers turn into multiplications, and there are no
+ * branches, so loops over these vectorize.
+ *
+ * Dates before 1582-10-15 (JD 2299160.5) are in the Julian calendar,
+ * later ones in the Gregorian.  Good for years -1,000,000 to
+ * +1,000,000.
+ */
+#define	CAL_SHIFT	1000000		/* years, a multiple of 400 */
+#define	JDN_GREGORIAN	2299161		/* Julian day number of 1582-10-15 */
+
 /**
- * Return Julian day for given date.  Algorithm from [2], ch 7
+ * Julian day number (the JD at noon) of a date; m from 0 to 14 wraps
+ * into the neighbouring years, d may be out of range.
  */
-double
-date2julian(int yy, int mm, double d)
+static inline int
+civil2jdn(int y, int m, int d)
 {
-	int	y = yy ;
-	int	m = mm ;
-	int	a,b ;
+	int	jf = m < 3 ;		/* Jan, Feb: months 13, 14 of y-1 */
+	uint32_t yy = y + CAL_SHIFT - jf ;
+	uint32_t mm = jf ? m + 12 : m ;
+	uint32_t c = yy / 100 ;
+	int	greg = y*512 + m*32 + d >= 1582*512 + 10*32 + 15 ;
+	uint32_t jdn = 365*yy + yy/4 + (979*mm - 2919)/32 + d ;
 
-	if( m <= 2 ) {
-	  --y ;
-	  m += 12 ;
-	}
+	return greg ? (int)(jdn + c/4 - c) + 1721119 - 146097*(CAL_SHIFT/400)
+		    : (int)jdn + 1721117 - 146100*(CAL_SHIFT/400) ;
+}
 
-	/* Gregorian calendar started 15 Oct 1582 */
-	if( yy*10000 + mm*100 + d > 15821015 ) {
-	  a = y/100 ;
-	  b = 2 - a + a/4;
-	}
-	else
-	  b = 0 ;
+/**
+ * Date of a Julian day number.
+ */
+static inline void
+jdn2civil(int z, int *y, int *m, int *d)
+{
+	int	greg = z >= JDN_GREGORIAN ;
+	/* days since 0000-03-01, shifted, in each calendar */
+	uint32_t ng = z + 146097*(CAL_SHIFT/400) - 1721120 ;
+	uint32_t nj = z + 146100*(CAL_SHIFT/400) - 1721118 ;
+	uint32_t n1 = 4*ng + 3 ;
+	uint32_t c = n1 / 146097 ;		/* Gregorian century */
+	uint32_t n2 = greg ? (n1 % 146097) | 3 : 4*nj + 3 ;
+	uint32_t yy = (greg ? 100*c : 0) + n2 / 1461 ;
+	uint32_t ny = n2 % 1461 / 4 ;		/* day of the year, from Mar 1 */
+	uint32_t n3 = 2141*ny + 197913 ;
+	uint32_t mm = n3 >> 16 ;		/* 3..14 */
+	int	jan = ny >= 306 ;
+
+	*y = (int)(yy + jan) - CAL_SHIFT ;
+	*m = jan ? mm - 12 : mm ;
+	*d = (n3 & 0xffff) / 2141 + 1 ;
+}
 
-	return (int)(365.25*(y+4716)) + (int)(30.6001*(m+1)) + d + b - 1524.5;
+/**
+ * Hours, minutes and seconds of a JD whose day number is z.
+ */
+static inline void
+jdnTime(double jdate, int z, int *hr, int *mn, double *s)
+{
+	double	j = (jdate + .5 - z) * 24. ;
+	*hr = j ; j -= *hr ; j *= 60. ;
+	*mn = j ; j -= *mn ; j *= 60. ;
+	*s = j ;
+}
+
+
+/**
+ * Return Julian day for given date.  Algorithm from [2], ch 7, in
+ * integer arithmetic.  A fractional day is carried through.
+ */
+double
+date2julian(int yy, int mm, double d)
+{
+	double	di = floor(d) ;
+	return civil2jdn(yy, mm, (int)di) - .5 + (d - di) ;
 }
 
 
@@ -181,37 +299,58 @@ time2julian(int yy, int mm, int dd,  int hr, int mn, double s)
 void
 julian2date(double jdate, int *yy, int *mm, int *dd)
 {
-	int	z = jdate+.5 ;
-	int	a,b,c,d,e ;
+	jdn2civil((int)floor(jdate + .5), yy, mm, dd) ;
+}
+
 
-	if( z <= 2299161 )
-	  a = z ;
-	else {
-	  a = ((float)z-1867216.25)/36524.25 ;
-	  a = z + 1 + a - a/4 ;
+void
+julian2time(double jdate,
+	int *yy, int *mm, int *dd, int *hr, int *mn, double *s)
+{
+	int	z = floor(jdate + .5) ;
+	jdn2civil(z, yy, mm, dd) ;
+	jdnTime(jdate, z, hr, mn, s) ;
+}
+
+
+/**
+ * date2julian() for n dates at once.  The results are identical to
+ * the scalar function's.
+ */
+void
+date2julian_n(int n, const int *y, const int *m, const double *d, double *jd)
+{
+	int	i ;
+	for(i=0; i < n; ++i) {
+	  double di = floor(d[i]) ;
+	  jd[i] = civil2jdn(y[i], m[i], (int)di) - .5 + (d[i] - di) ;
 	}
+}
 
-	b = a + 1524 ;
-	c = (b-122.1)/365.25 ;
-	d = 365.25*c ;
-	e = (float)(b-d)/30.6001 ;
-	*dd = b - d - (int)(30.6001*e) ;
-	*mm = e<=13 ? e-1 : e-13 ;
-	*yy = *mm > 2 ? c-4716 : c-4715 ;
+
+/**
+ * julian2date() for n dates at once.
+ */
+void
+julian2date_n(int n, const double *jd, int *y, int *m, int *d)
+{
+	int	i ;
+	for(i=0; i < n; ++i)
+	  jdn2civil((int)floor(jd[i] + .5), y+i, m+i, d+i) ;
 }
 
 
+/**
+ * julian2time() for n dates at once.
+ */
 void
-julian2time(double jdate,
-	int *yy, int *mm, int *dd, int *hr, int *mn, double *s)
+julian2time_n(int n, const double *jd, int *y, int *m, int *d,
+	int *hr, int *mn, double *s)
 {
-	double	j ;
-	julian2date(jdate, yy,mm,dd) ;
-	j = jdate - date2julian(*yy,*mm,*dd) ;
-	j *= 24. ;
-	*hr = j ; j -= *hr ; j *= 60. ;
-	*mn = j ; j -= *mn ; j *= 60. ;
-	*s = j ;
+	int	i ;
+	julian2date_n(n, jd, y, m, d) ;
+	for(i=0; i < n; ++i)		/* separately, to keep both loops simple */
+	  jdnTime(jd[i], (int)floor(jd[i] + .5), hr+i, mn+i, s+i) ;
 }
 
 /**
@@ -242,7 +381,7 @@ printDate(double jdate)
 double
 unix2julian(time_t t)
 {
-	return JDUnix + (float)t/(24.*60.*60.) ;
+	return JDUnix + (double)t/(24.*60.*60.) ;
 }
 
 
@@ -254,6 +393,480 @@ jnow()
 }
 
 
+	/* Split Julian dates */
+
+#define	NS_PER_DAY	86400000000000LL
+#define	JDN_UNIX	2440587		/* noon 31 Dec 1969, 12h before the epoch */
+
+/**
+ * a/b rounded down, b > 0.
+ */
+static inline int64_t
+floorDiv(int64_t a, int64_t b)
+{
+	return a/b - (a%b < 0) ;
+}
+
+/**
+ * Set jd to a time given as ns nanoseconds after noon on day number
+ * day; ns may be any size.
+ */
+static inline void
+splitFromNs(SplitJD *jd, int64_t day, int64_t ns)
+{
+	int64_t	days = floorDiv(ns, NS_PER_DAY) ;
+	jd->day = day + days ;
+	jd->frac = (double)(ns - days * NS_PER_DAY) / NS_PER_DAY ;
+}
+
+/**
+ * Nanoseconds since noon of jd->day, rounded; never a whole day.
+ */
+static inline int64_t
+splitNs(const SplitJD *jd)
+{
+	int64_t	ns = llround(jd->frac * NS_PER_DAY) ;
+	return ns < NS_PER_DAY ? ns : NS_PER_DAY - 1 ;
+}
+
+
+/**
+ * Split a JD into day and fraction.
+ */
+void
+splitJD(double jdate, SplitJD *jd)
+{
+	double	day = floor(jdate) ;
+	jd->day = day ;
+	jd->frac = jdate - day ;
+}
+
+
+/**
+ * Join the two parts back into one JD, rounding to the resolution
+ * of a double.  For the functions that take a single JD; none of
+ * the ephemerides is affected by the rounding.
+ */
+double
+joinJD(const SplitJD *jd)
+{
+	return jd->day + jd->frac ;
+}
+
+
+/**
+ * The current time as a split JD, to the resolution of the system
+ * clock.
+ */
+void
+jnowSplit(SplitJD *jd)
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_REALTIME, &ts) ;
+	splitFromNs(jd, JDN_UNIX,
+		((int64_t)ts.tv_sec + 43200) * 1000000000 + ts.tv_nsec) ;
+}
+
+
+/**
+ * Convert n Unix times, in seconds, to split JDs.  Exact.
+ */
+void
+unix2splitJD_n(int n, const int64_t *t, SplitJD *jd)
+{
+	int	i ;
+	for(i=0; i < n; ++i) {
+	  int64_t s = t[i] + 43200 ;		/* since noon before the epoch */
+	  int64_t days = floorDiv(s, 86400) ;
+	  jd[i].day = JDN_UNIX + days ;
+	  jd[i].frac = (double)(s - days * 86400) / 86400. ;
+	}
+}
+
+
+/**
+ * Convert n Unix times in nanoseconds to split JDs.  splitJD2unixNs()
+ * recovers the nanoseconds exactly.
+ */
+void
+unixNs2splitJD_n(int n, const int64_t *ns, SplitJD *jd)
+{
+	int	i ;
+	for(i=0; i < n; ++i)
+	  splitFromNs(&jd[i], JDN_UNIX, ns[i] + 43200 * 1000000000LL) ;
+}
+
+
+/**
+ * Convert a split JD to Unix time in nanoseconds, rounded.  64 bits of
+ * nanoseconds reach from 1677 to 2262.
+ */
+int64_t
+splitJD2unixNs(const SplitJD *jd)
+{
+	return (int64_t)(jd->day - JDN_UNIX) * NS_PER_DAY + splitNs(jd)
+		- 43200 * 1000000000LL ;
+}
+
+
+	/* Parsing */
+
+/*
+ * Timestamps are parsed in two ways.  Most in bulk data have the
+ * fixed shape YYYY-MM-DDThh:mm:ss, which is checked and decoded a
+ * word at a time: three overlapping 8-byte loads, one test of all
+ * the digits, and a multiply-and-shift reduction (as in Lemire's
+ * "parse eight digits") that turns YYYYMMDD and 00hhmmss into
+ * integers.  Anything else goes through a byte-at-a-time parser.
+ * Both share the parsing of fractions and zones, the range checks,
+ * and the conversion.
+ */
+
+/**
+ * 8 bytes of s as an integer, first byte lowest.
+ */
+static inline uint64_t
+load8(const char *s)
+{
+	uint64_t v ;
+	memcpy(&v, s, 8) ;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v) ;
+#endif
+	return v ;
+}
+
+#define	ONES8		0x0101010101010101ULL
+#define	HIGHS8		0x8080808080808080ULL
+
+/**
+ * True if the bytes of x selected by the byte mask are all digits.
+ * The others are replaced by '0' first, so that no borrow or carry
+ * crosses into a digit.
+ */
+static inline int
+swarDigits(uint64_t x, uint64_t mask)
+{
+	x = (x & mask) | (0x30 * ONES8 & ~mask) ;
+	return (((x - 0x30 * ONES8) | (x + 0x46 * ONES8)) & HIGHS8) == 0 ;
+}
+
+/**
+ * Value of 8 ASCII digits, first byte lowest.
+ */
+static inline uint32_t
+swarEight(uint64_t x)
+{
+	x -= 0x30 * ONES8 ;
+	x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL ;
+	x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL ;
+	return (uint32_t)(x * 10000 + (x >> 32)) ;
+}
+
+/**
+ * Value of n decimal digits at s, or -1 if they aren't all digits.
+ */
+static int
+digits(const char *s, int n)
+{
+	int	v = 0 ;
+	for(; n > 0; --n, ++s) {
+	  if( *s < '0' || *s > '9' )
+	    return -1 ;
+	  v = v*10 + *s - '0' ;
+	}
+	return v ;
+}
+
+/**
+ * Number of digits starting at s, at most to e.
+ */
+static int
+countDigits(const char *s, const char *e)
+{
+	const char *p = s ;
+	while( p < e && *p >= '0' && *p <= '9' )
+	  ++p ;
+	return p - s ;
+}
+
+/**
+ * Days in a month, in the calendar date2julian() uses for that year.
+ */
+static int
+monthDays(int y, int m)
+{
+	static const char days[13] =
+		{ 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 } ;
+	int	leap ;
+
+	if( m != 2 )
+	  return days[m] ;
+	leap = y % 4 == 0 ;
+	if( y > 1582 && y % 100 == 0 && y % 400 != 0 )
+	  leap = 0 ;
+	return 28 + leap ;
+}
+
+/**
+ * Finish a parse: the optional fraction of a second and zone at p,
+ * which must then reach e; range checks; conversion.
+ */
+static int
+parseTail(int y, int m, int d, int hr, int mn, int sec,
+	const char *p, const char *e, SplitJD *jd)
+{
+	int64_t	ns = 0 ;
+	int	tz = 0, k ;
+
+	if( p < e && (*p == '.' || *p == ',') ) {
+	  for(++p, k=0; p < e && *p >= '0' && *p <= '9'; ++p, ++k)
+	    if( k < 9 )
+	      ns = ns*10 + *p - '0' ;
+	  if( k == 0 )
+	    return TIME_SYNTAX ;
+	  for(; k < 9; ++k)
+	    ns *= 10 ;
+	}
+	if( p < e && *p == 'Z' )
+	  ++p ;
+	else if( p < e && (*p == '+' || *p == '-') ) {
+	  int	west = *p++ == '-', th, tm = 0 ;
+	  if( e - p < 2 || (th = digits(p, 2)) < 0 )
+	    return TIME_SYNTAX ;
+	  p += 2 ;
+	  if( p < e && *p == ':' )
+	    ++p ;
+	  if( p < e ) {
+	    if( e - p < 2 || (tm = digits(p, 2)) < 0 )
+	      return TIME_SYNTAX ;
+	    p += 2 ;
+	  }
+	  if( th > 23 || tm > 59 )
+	    return TIME_RANGE ;
+	  tz = west ? -(th*60 + tm) : th*60 + tm ;
+	}
+	if( p != e )
+	  return TIME_SYNTAX ;
+
+	/* civil2jdn()'s range; its shifted year starts in March */
+	if( y < -CAL_SHIFT || y > CAL_SHIFT || (y == -CAL_SHIFT && m < 3) )
+	  return TIME_RANGE ;
+	if( m < 1 || m > 12 || d < 1 || d > monthDays(y, m) ||
+	    mn > 59 || sec > 60 ||
+	    (hr > 23 && (hr > 24 || mn + sec + ns > 0)) )
+	  return TIME_RANGE ;
+
+	splitFromNs(jd, civil2jdn(y, m, d),
+		((int64_t)hr*3600 + mn*60 + sec - tz*60 - 43200) * 1000000000 + ns) ;
+	return 0 ;
+}
+
+/**
+ * Everything that isn't YYYY-MM-DDThh:mm:ss...
+ */
+static int
+parseSlow(const char *s, const char *e, SplitJD *jd)
+{
+	const char *p = s ;
+	int	neg = 0, y, m, d, hr = 0, mn = 0, sec = 0, k ;
+
+	if( p < e && (*p == '+' || *p == '-') )
+	  neg = *p++ == '-' ;
+	k = countDigits(p, e) ;
+
+	if( k >= 4 && k <= 7 && p + k < e && p[k] == '-' )
+	{
+	  /* extended: [+-]YYYY-MM-DD[Thh:mm[:ss]] */
+	  y = digits(p, k) ;
+	  p += k ;
+	  if( e - p < 6 || (m = digits(p+1, 2)) < 0 || p[3] != '-' ||
+	      (d = digits(p+4, 2)) < 0 )
+	    return TIME_SYNTAX ;
+	  p += 6 ;
+	  if( e - p >= 6 && (*p == 'T' || *p == ' ') ) {
+	    if( (hr = digits(p+1, 2)) < 0 || p[3] != ':' ||
+		(mn = digits(p+4, 2)) < 0 )
+	      return TIME_SYNTAX ;
+	    p += 6 ;
+	    if( p < e && *p == ':' ) {
+	      if( e - p < 3 || (sec = digits(p+1, 2)) < 0 )
+		return TIME_SYNTAX ;
+	      p += 3 ;
+	    }
+	  }
+	}
+	else if( !neg && p == s && (k == 6 || k == 8) )
+	{
+	  /* compact: YYMMDD or YYYYMMDD [(T| )hhmm[ss]], as ephem takes */
+	  y = digits(p, k-4) ;
+	  m = digits(p+k-4, 2) ;
+	  d = digits(p+k-2, 2) ;
+	  if( k == 6 )
+	    y += y < 50 ? 2000 : 1900 ;
+	  p += k ;
+	  if( p < e && (*p == 'T' || *p == ' ') ) {
+	    k = countDigits(p+1, e) ;
+	    if( k != 4 && k != 6 )
+	      return TIME_SYNTAX ;
+	    hr = digits(p+1, 2) ;
+	    mn = digits(p+3, 2) ;
+	    if( k == 6 )
+	      sec = digits(p+5, 2) ;
+	    p += 1 + k ;
+	  }
+	}
+	else
+	  return TIME_SYNTAX ;
+
+	return parseTail(neg ? -y : y, m, d, hr, mn, sec, p, e, jd) ;
+}
+
+
+/**
+ * Parse a date and time of len characters, UTC unless a zone offset
+ * is given.  Accepted are ISO-8601 extended and the compact form of
+ * ephem's arguments:
+ *
+ *	[+-]YYYY-MM-DD[(T| )hh:mm[:ss[.fffffffff]][Z|(+|-)hh[[:]mm]]]
+ *	[YY]YYMMDD[(T| )hhmm[ss[.fffffffff]][Z|(+|-)hh[[:]mm]]]
+ *
+ * Two-digit years are 1950 to 2049.  Fractions of a second are kept
+ * to the nanosecond.  Leap seconds are not counted: 23:59:60 is
+ * midnight.
+ * @return 0, TIME_SYNTAX if the string isn't in one of these forms,
+ *	or TIME_RANGE if a field is out of range (e.g. 2023-02-29, or
+ *	a year beyond +-1,000,000).
+ */
+int
+parseJulian(const char *s, size_t len, SplitJD *jd)
+{
+	const char *e = s + len ;
+
+	if( len >= 19 )
+	{
+	  uint64_t w1 = load8(s) ;		/* YYYY-MM- */
+	  uint64_t w2 = load8(s+8) ;		/* DDThh:mm */
+	  uint64_t w3 = load8(s+11) ;		/* hh:mm:ss */
+
+	  if( (w1 & 0xFF0000FF00000000ULL) == 0x2D00002D00000000ULL &&
+	      (s[10] == 'T' || s[10] == ' ') &&
+	      (w3 & 0x0000FF0000FF0000ULL) == 0x00003A00003A0000ULL &&
+	      swarDigits(w1, 0x00FFFF00FFFFFFFFULL) &&
+	      swarDigits(w2, 0x000000000000FFFFULL) &&
+	      swarDigits(w3, 0xFFFF00FFFF00FFFFULL) )
+	  {
+	    uint32_t date = swarEight((w1 & 0xFFFFFFFFULL) |
+			((w1 >> 8) & 0xFFFF00000000ULL) | (w2 << 48)) ;
+	    uint32_t time = swarEight(0x3030 | ((w3 & 0xFFFF) << 16) |
+			((w3 << 8) & 0xFFFF00000000ULL) |
+			(w3 & 0xFFFF000000000000ULL)) ;
+	    return parseTail(date / 10000, date / 100 % 100, date % 100,
+		time / 10000, time / 100 % 100, time % 100, s + 19, e, jd) ;
+	  }
+	}
+	return parseSlow(s, e, jd) ;
+}
+
+
+/**
+ * Parse n date/times with parseJulian() into JDs.  Each string ends
+ * at a NUL, comma, semicolon, tab or line end, so they may point
+ * straight into the fields of CSV lines.  Strings that don't parse
+ * get a NaN JD and, if err isn't NULL, their error in err[i]; err[i]
+ * is 0 for the others.
+ * @return the number that didn't parse.
+ */
+int
+parseJulian_n(int n, const char *const *str, double *jd, uint8_t *err)
+{
+	static const uint8_t delim[256] = {
+		[0] = 1, [','] = 1, [';'] = 1, ['\t'] = 1, ['\r'] = 1, ['\n'] = 1,
+	} ;
+	int	i, rc, bad = 0 ;
+
+	for(i=0; i < n; ++i)
+	{
+	  const char *e = str[i] ;
+	  SplitJD sj ;
+	  while( !delim[(uint8_t)*e] )
+	    ++e ;
+	  rc = parseJulian(str[i], e - str[i], &sj) ;
+	  jd[i] = rc == 0 ? joinJD(&sj) : NAN ;
+	  if( err != NULL )
+	    err[i] = rc ;
+	  bad += rc != 0 ;
+	}
+	return bad ;
+}
+
+
+/**
+ * Parse a NUL-terminated date/time with parseJulian().
+ * @return 0, or -1 if it doesn't parse.
+ */
+int
+iso2splitJD(const char *str, SplitJD *jd)
+{
+	return parseJulian(str, strlen(str), jd) == 0 ? 0 : -1 ;
+}
+
+
+/**
+ * Parse n NUL-terminated date/times with parseJulian().  Strings that
+ * don't parse get a NaN fraction.
+ * @return the number that didn't parse.
+ */
+int
+iso2splitJD_n(int n, const char *const *str, SplitJD *jd)
+{
+	int	i, bad = 0 ;
+	for(i=0; i < n; ++i)
+	  if( iso2splitJD(str[i], &jd[i]) < 0 ) {
+	    jd[i].day = 0 ;
+	    jd[i].frac = NAN ;
+	    ++bad ;
+	  }
+	return bad ;
+}
+
+
+/**
+ * julian2time() for a split JD.  Seconds are rounded to the
+ * nanosecond.
+ */
+void
+splitJD2time(const SplitJD *jd, int *yy, int *mm, int *dd,
+	int *hr, int *mn, double *s)
+{
+	int64_t	ns = splitNs(jd) + 43200 * 1000000000LL ;	/* since midnight */
+	int	pm = ns >= NS_PER_DAY ;
+
+	ns -= pm ? NS_PER_DAY : 0 ;
+	jdn2civil(jd->day + pm, yy, mm, dd) ;
+	*hr = ns / 3600000000000LL ;
+	*mn = ns / 60000000000LL % 60 ;
+	*s = (ns % 60000000000LL) * 1e-9 ;
+}
+
+
+/**
+ * time2sidereal() for a split JD: Greenwich mean sidereal time, hours.
+ * The fraction of the day is used at full resolution.
+ */
+double
+splitJD2sidereal(const SplitJD *jd)
+{
+	double	T = ((jd->day - JD2000) + jd->frac) / 36525 ;
+	double	st ;
+
+	/* Degrees; [2] 12.4 with 360 * whole days dropped */
+	st = 280.46061837 + 36000.770053608 * T +
+		0.000387933 * T*T - T*T*T / 38710000 + 360. * jd->frac ;
+	return limitAngle(st) * 24/360 ;
+}
+
+
 /**
  * Given a Julian date (not including time),
  * compute the Sidereal time at midnight UT.  Jdate should end in .5.
@@ -301,10 +914,140 @@ siderealMean2Apparent(double jdate)
 	double	dpsi, deps ;
 #define	cos_eps	0.9175		/* cos(23d26'30") */
 
-	nutation(&dpsi, &deps, jdate) ;
+	nutation(&dpsi, &deps, convertTime(jdate, TS_UT1, TS_TT)) ;
 	return dpsi*cos_eps/15./3600. ;
 }
 
+
+/*
+ * Over a stretch of time the sidereal time is nearly a straight line;
+ * the quadratic term of [2] 12.4 bends it by 10^-10 degrees over a
+ * month.  A SiderealSeries evaluates 12.4 exactly at the start of a
+ * stretch of up to SID_STRETCH steps and SID_SPAN days, then gives
+ * step k as start + k * rate, multiplying rather than adding so no
+ * rounding builds up, and starts a new stretch from the exact value
+ * when this one is used up.  The equation of the equinoxes for
+ * apparent time has a term of 13.7 days, so it is evaluated at the
+ * ends of stretches no more than a day long and interpolated.
+ */
+#define	SID_STRETCH	1024		/* most steps between exact values */
+#define	SID_SPAN	30.		/* most days between exact values */
+#define	SID_RATE	360.98564736629	/* degrees per day, at J2000 */
+
+/**
+ * Start a stretch at s->jd; s->e0 already holds the equation of the
+ * equinoxes there.
+ */
+static void
+siderealSync(SiderealSeries *s)
+{
+	SplitJD	end ;
+	double	T, f ;
+
+	s->k = 0 ;
+	f = s->jd.frac + s->n * s->step / 2. ;
+	T = ((s->jd.day - JD2000) + f) / 36525 ;
+	s->g0 = splitJD2sidereal(&s->jd) * 15. ;
+	s->rate = fmod((SID_RATE + (2*0.000387933*T - 3*T*T/38710000) / 36525) *
+		s->step, 360.) ;
+	if( s->apparent ) {
+	  f = s->jd.frac + s->n * s->step ;
+	  end.day = s->jd.day + (int32_t)floor(f) ;
+	  end.frac = f - floor(f) ;
+	  s->de = (siderealMean2Apparent(joinJD(&end)) * 15. - s->e0) / s->n ;
+	}
+}
+
+
+/**
+ * Start a series of sidereal times at UT Julian date jdate, one every
+ * step days (which may be negative).  If apparent is set the series
+ * is of apparent sidereal time, otherwise mean.
+ */
+void
+siderealSeriesInit(SiderealSeries *s, double jdate, double step, int apparent)
+{
+	double	span = apparent ? 1. : SID_SPAN ;
+	double	a = fabs(step) ;
+
+	splitJD(jdate, &s->jd) ;
+	s->step = step ;
+	s->apparent = apparent ;
+	s->n = SID_STRETCH ;
+	if( a * s->n > span )
+	  s->n = a >= span ? 1 : (int)(span / a) ;
+	s->e0 = apparent ? siderealMean2Apparent(jdate) * 15. : 0. ;
+	s->de = 0. ;
+	siderealSync(s) ;
+}
+
+
+/**
+ * Sidereal time of the current step, degrees, not reduced; then
+ * move on to the next step.
+ */
+static inline double
+siderealStep(SiderealSeries *s)
+{
+	double	g = s->g0 + s->k * s->rate ;
+	double	f ;
+
+	if( s->apparent )
+	  g += s->e0 + s->k * s->de ;
+	if( ++s->k == s->n ) {
+	  f = s->jd.frac + s->n * s->step ;
+	  s->jd.day += (int32_t)floor(f) ;
+	  s->jd.frac = f - floor(f) ;
+	  s->e0 += s->n * s->de ;
+	  siderealSync(s) ;
+	}
+	return g ;
+}
+
+
+/**
+ * Greenwich sidereal time, hours, at the current step; then move on
+ * to the next.  Agrees with splitJD2sidereal() to about 10^-9 hours,
+ * and with it plus siderealMean2Apparent() to about 10^-7.
+ */
+double
+siderealSeriesNext(SiderealSeries *s)
+{
+	double	g = siderealStep(s) * (1./15.) ;
+	return g - 24. * floor(g * (1./24.)) ;
+}
+
+
+/**
+ * The next n steps of a series as local sidereal times, hours, for
+ * nlon longitudes (degrees, positive west): lst[i*nlon + j] is step
+ * i at lon[j].  If lon is NULL, fills lst[i] with Greenwich sidereal
+ * time.
+ */
+void
+siderealSeries_n(SiderealSeries *s, int n, int nlon, const double *lon,
+	double *lst)
+{
+	double	g, v, *row ;
+	int	i, j ;
+
+	if( lon == NULL ) {
+	  for(i = 0; i < n; ++i) {
+	    g = siderealStep(s) * (1./15.) ;
+	    lst[i] = g - 24. * floor(g * (1./24.)) ;
+	  }
+	  return ;
+	}
+	for(i = 0; i < n; ++i) {
+	  g = siderealStep(s) * (1./15.) ;
+	  row = lst + (size_t)i * nlon ;
+	  for(j = 0; j < nlon; ++j) {
+	    v = g - lon[j] * (1./15.) ;
+	    row[j] = v - 24. * floor(v * (1./24.)) ;
+	  }
+	}
+}
+
 /**
  * @brief convert Greenwich Mean Sidereal Time to Greenwich Apparent
  * Sidereal Time.
@@ -1,9 +1,9 @@
 static	char	usage[] =
 "ephem - show positions of all planets\n"
 "\n"
-"  usage:  ephem [options] [yymmdd [hhmmss]]\n"
+"  usage:  ephem [options] [yymmdd [hhmmss] | yyyy-mm-ddThh:mm:ss]\n"
 "	-a	include hour angles\n"
-"	-l	local time\n"
+"	-l	date and time are local ($TZ or /etc/localtime)\n"
 ;
 
 #include <stdio.h>
@@ -32,11 +32,11 @@ main(argc, argv)
 	double	rad ;
 	double	decl, RA ;
 	PlanetState p ;
-	int	y,m,d ;
-	int	hh, mm ;
-	long	s ;
+	char	when[64] ;
+	SplitJD	sj ;
 	int	haveDay = 0 ;
 	int	local = 0 ;
+	TimeZone tz ;
 	double	stime ;
 
 	jdate = jnow() ;
@@ -50,26 +50,12 @@ main(argc, argv)
 	  else if( isdigit(**argv) )
 	  {
 	    if( !haveDay )
-	    {
-	      y = atoi(*argv) ;
-	      d = y%100 ;
-	      m = y/100 % 100 ;
-	      y /= 10000 ;
-	      if( y < 50 )
-		y += 2000 ;
-	      else if( y < 100 )
-		y += 1900 ;
-	      jdate = date2julian(y,m,d) ;
-	      haveDay = 1 ;
-	    }
-	    else
-	    {
-	      s = atoi(*argv) ;
-	      hh = s/10000 ;
-	      mm = (s/100) % 100 ;
-	      s %= 100 ;
-	      jdate += hms2h(hh,mm,(double)s) / 24. ;
+	      snprintf(when, sizeof(when), "%s", *argv) ;
+	    else if( strlen(when) + strlen(*argv) + 2 <= sizeof(when) ) {
+	      strcat(when, " ") ;
+	      strcat(when, *argv) ;
 	    }
+	    ++haveDay ;
 	  }
 	  else {
 	    fputs(usage, stderr);
@@ -77,9 +63,27 @@ main(argc, argv)
 	  }
 	}
 
-	/* TODO: local to GMT conversion */
+	if( haveDay > 2 ||
+	    (haveDay && parseJulian(when, strlen(when), &sj) != 0) ) {
+	  fprintf(stderr, "ephem: bad date/time \"%s\"\n", when) ;
+	  exit(2) ;
+	}
+	if( haveDay )
+	  jdate = joinJD(&sj) ;
+
+	if( local ) {
+	  if( LoadTimeZone(NULL, &tz) < 0 )
+	    exit(2) ;
+	  if( haveDay )
+	    jdate = local2utc(&tz, jdate) ;
+	}
 
 	printf("julian date: %f = %s\n", jdate, julian2str(jdate)) ;
+	if( local ) {
+	  printf("local time: %s %s\n",
+		julian2str(utc2local(&tz, jdate)), tzAbbrev(&tz, jdate)) ;
+	  FreeTimeZone(&tz) ;
+	}
 
 	printf("%.4f = %s; sidereal = %s\n",
 	  floor(jdate), julian2str(floor(jdate)),
@@ -1,5 +1,6 @@
 
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 #include <math.h>
@@ -37,6 +38,24 @@
  * hours2hmStr(double hours)
  *	Convert hours to hh:mm.mm
  *
+ * char *
+ * julian2ymdStr_r(double jdate, char *buf)
+ * ... hours2hmStr_r(double hours, char *buf)
+ *	The same into a buffer of FMT_BUFSIZE bytes supplied by the caller
+ *
+ * char *
+ * convertHms_r(double hours, char *buf)
+ *	convertHms() into a caller's buffer
+ *
+ * size_t
+ * formatValues(int n, const double *v, int format, int sep, char *out)
+ *	Format an array of values
+ *
+ * Values are rounded to the last digit shown, carrying into the
+ * higher fields, and negative values get a single leading sign.  The
+ * digits are written by hand, without printf, so the _r functions
+ * and formatValues() are safe in any thread and several times faster
+ * than snprintf().
  */
 
 
@@ -44,128 +63,389 @@
  * buffers.  Each function that returns a string value uses the next
  * buffer in turn.  Thus, you can call these functions four times
  * before any buffer becomes invalid.  This is very useful when you
- * use these functions inside a printf().
+ * use these functions inside a printf().  Each thread has its own
+ * round-robin.
  */
 
 #define	RVALN	4
-static	char	rvals[RVALN][40] ;
-static	int	rvalidx = 0 ;
+static	__thread char	rvals[RVALN][FMT_BUFSIZE] ;
+static	__thread int	rvalidx = 0 ;
 #define	rval	(rvals[rvalidx])
 #define	rvalNext()	(rvalidx = (rvalidx+1) % RVALN)
 
-char *
-julian2ymdStr(jdate)
-	double	jdate ;
+static	const char	mnames[13][4] = { "", "Jan", "Feb", "Mar", "Apr", "May",
+		  "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"} ;
+static	const char	degsign[] = "°" ;
+
+static	const char	digits2[200] =
+	"00010203040506070809101112131415161718192021222324"
+	"25262728293031323334353637383940414243444546474849"
+	"50515253545556575859606162636465666768697071727374"
+	"75767778798081828384858687888990919293949596979899" ;
+
+
+/**
+ * x * scale rounded to an integer, for x >= 0.  0 for NaN and
+ * values too big to format.
+ */
+static inline int64_t
+roundTo(double x, double scale)
+{
+	x *= scale ;
+	return x < 9e18 ? (int64_t)(x + .5) : 0 ;
+}
+
+/**
+ * Two digits, 00 to 99.
+ */
+static inline char *
+put2(char *p, int v)
+{
+	memcpy(p, digits2 + 2*v, 2) ;
+	return p + 2 ;
+}
+
+/**
+ * An unsigned value with at least ndig digits.
+ */
+static char *
+putUint(char *p, uint64_t v, int ndig)
+{
+	char	tmp[20] ;
+	int	n = 0 ;
+
+	for(; v >= 100; v /= 100, n += 2)
+	  memcpy(tmp + 18 - n, digits2 + 2*(v % 100), 2) ;
+	if( v >= 10 ) {
+	  memcpy(tmp + 18 - n, digits2 + 2*v, 2) ;
+	  n += 2 ;
+	}
+	else
+	  tmp[19 - n++] = '0' + v ;
+	for(; ndig > n; --ndig)
+	  *p++ = '0' ;
+	memcpy(p, tmp + 20 - n, n) ;
+	return p + n ;
+}
+
+/**
+ * As printf("%*d"): a sign if neg, then v, right-justified in width
+ * characters.
+ */
+static char *
+putSigned(char *p, int neg, uint64_t v, int width)
+{
+	char	tmp[24] ;
+	char	*e = putUint(tmp + 1, v, 1) ;
+	char	*b = tmp + 1 ;
+	int	n ;
+
+	if( neg )
+	  *--b = '-' ;
+	for(n = e - b; n < width; ++n)
+	  *p++ = ' ' ;
+	memcpy(p, b, e - b) ;
+	return p + (e - b) ;
+}
+
+
+static char *
+fmtYmd(double jdate, char *p)
 {
 	int	y,m,d ;
-static	char	*mnames[] = { "", "Jan", "Feb", "Mar", "Apr", "May",
-		  "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"} ;
 
-	rvalNext() ;
 	julian2date(jdate, &y,&m,&d) ;
-	snprintf(rval, sizeof(rval), "%d-%s-%d", d,mnames[m],y) ;
-	return rval ;
+	p = putSigned(p, 0, d, 0) ;
+	*p++ = '-' ;
+	memcpy(p, mnames[m], 3) ;
+	p += 3 ;
+	*p++ = '-' ;
+	return putSigned(p, y < 0, y < 0 ? -(int64_t)y : y, 0) ;
+}
+
+static char *
+fmtHmsTime(double jdate, char *p)
+{
+	double	z = floor(jdate + .5) ;
+	int64_t	t = roundTo(jdate + .5 - z, 864000.) ;	/* tenths of seconds */
+
+	if( t >= 864000 )
+	  t -= 864000 ;
+	p = putSigned(p, 0, t / 36000, 0) ;
+	*p++ = ':' ;
+	p = put2(p, t / 600 % 60) ;
+	*p++ = ':' ;
+	p = put2(p, t / 10 % 60) ;
+	*p++ = '.' ;
+	*p++ = '0' + t % 10 ;
+	return p ;
+}
+
+static char *
+fmtDateTime(double jdate, char *p)
+{
+	double	z = floor(jdate + .5) ;
+	int64_t	t = roundTo(jdate + .5 - z, 86400.) ;	/* seconds */
+
+	if( t >= 86400 ) {
+	  t -= 86400 ;
+	  z += 1. ;
+	}
+	p = fmtYmd(z, p) ;
+	*p++ = ' ' ;
+	p = putSigned(p, 0, t / 3600, 0) ;
+	*p++ = ':' ;
+	p = put2(p, t / 60 % 60) ;
+	*p++ = ':' ;
+	return put2(p, t % 60) ;
+}
+
+static char *
+fmtDms(double degrees, char *p)
+{
+	int64_t	t = roundTo(fabs(degrees), 36000.) ;	/* tenths of arcsec */
+
+	if( degrees < 0. && t > 0 )
+	  *p++ = '-' ;
+	p = putUint(p, t / 36000, 3) ;
+	memcpy(p, degsign, sizeof(degsign)-1) ;
+	p += sizeof(degsign)-1 ;
+	p = put2(p, t / 600 % 60) ;
+	*p++ = '\'' ;
+	p = put2(p, t / 10 % 60) ;
+	*p++ = '.' ;
+	*p++ = '0' + t % 10 ;
+	return p ;
+}
+
+static char *
+fmtDm(double degrees, char *p)
+{
+	int64_t	t = roundTo(fabs(degrees), 6000.) ;	/* 1/100 arcmin */
+
+	if( degrees < 0. && t > 0 )
+	  *p++ = '-' ;
+	p = putUint(p, t / 6000, 1) ;
+	memcpy(p, degsign, sizeof(degsign)-1) ;
+	p += sizeof(degsign)-1 ;
+	p = put2(p, t / 100 % 60) ;
+	*p++ = '.' ;
+	return put2(p, t % 100) ;
+}
+
+static char *
+fmtHms(double hours, char *p)
+{
+	int64_t	t = roundTo(fabs(hours), 36000.) ;	/* tenths of seconds */
+
+	p = putSigned(p, hours < 0. && t > 0, t / 36000, 2) ;
+	*p++ = ':' ;
+	p = put2(p, t / 600 % 60) ;
+	*p++ = ':' ;
+	p = put2(p, t / 10 % 60) ;
+	*p++ = '.' ;
+	*p++ = '0' + t % 10 ;
+	return p ;
+}
+
+static char *
+fmtHm(double hours, char *p)
+{
+	int64_t	t = roundTo(fabs(hours), 6000.) ;	/* 1/100 minute */
+
+	p = putSigned(p, hours < 0. && t > 0, t / 6000, 2) ;
+	*p++ = ':' ;
+	p = put2(p, t / 100 % 60) ;
+	*p++ = '.' ;
+	return put2(p, t % 100) ;
+}
+
+static char *
+fmtConvertHms(double hours, char *p)
+{
+	int64_t	t = roundTo(fabs(hours), 3600e6) ;	/* microseconds */
+
+	p = putSigned(p, hours < 0. && t > 0, t / 3600000000LL, 0) ;
+	*p++ = ':' ;
+	p = put2(p, t / 60000000 % 60) ;
+	*p++ = ':' ;
+	p = putUint(p, t / 1000000 % 60, 1) ;
+	*p++ = '.' ;
+	return putUint(p, t % 1000000, 6) ;
 }
 
+/* indexed by FMT_* */
+static	char	*(*const formatters[])(double, char *) = {
+	fmtYmd, fmtHmsTime, fmtDateTime, fmtDms, fmtDm, fmtHms, fmtHm,
+	fmtConvertHms,
+} ;
 
+
+/**
+ * Convert Julian date to e.g. "11-Jul-2022" in buf, which must hold
+ * FMT_BUFSIZE bytes.  Returns buf.
+ */
 char *
-julian2hmsStr(jdate)
-	double	jdate ;
+julian2ymdStr_r(double jdate, char *buf)
 {
-	int	y,m,d, hh,mm ;
-	double	ss ;
-#if 0
-static	char	*mnames[] = { "", "Jan", "Feb", "Mar", "Apr", "May",
-		  "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"} ;
-#endif
+	*fmtYmd(jdate, buf) = '\0' ;
+	return buf ;
+}
 
-	rvalNext() ;
-	julian2time(jdate, &y,&m,&d, &hh,&mm,&ss) ;
-	snprintf(rval, sizeof(rval),
-	  "%d:%2.2d:%2.2d.%d", hh,mm,(int)ss, (int)(ss*10+.5)%10) ;
-	return rval ;
+/**
+ * "16:04:16.3", rounded to the tenth of a second.
+ */
+char *
+julian2hmsStr_r(double jdate, char *buf)
+{
+	*fmtHmsTime(jdate, buf) = '\0' ;
+	return buf ;
 }
 
+/**
+ * "11-Jul-2022 16:04:16", rounded to the second.
+ */
+char *
+julian2str_r(double jdate, char *buf)
+{
+	*fmtDateTime(jdate, buf) = '\0' ;
+	return buf ;
+}
 
+/**
+ * "ddd°mm'ss.s"
+ */
 char *
-julian2str(jdate)
-	double	jdate ;
+deg2dmsStr_r(double degrees, char *buf)
 {
-	int	y,m,d, hh,mm ;
-	double	ss ;
-static	char	*mnames[] = { "", "Jan", "Feb", "Mar", "Apr", "May",
-		  "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"} ;
+	*fmtDms(degrees, buf) = '\0' ;
+	return buf ;
+}
 
-	rvalNext() ;
-	julian2time(jdate, &y,&m,&d, &hh,&mm,&ss) ;
-	snprintf(rval, sizeof(rval),
-	  "%d-%s-%d %d:%2.2d:%2.2d", d,mnames[m],y, hh,mm,(int)ss) ;
-	return rval ;
+/**
+ * "d°mm.mm"
+ */
+char *
+deg2dmStr_r(double degrees, char *buf)
+{
+	*fmtDm(degrees, buf) = '\0' ;
+	return buf ;
 }
 
+/**
+ * "hh:mm:ss.s", hours right-justified in two places.
+ */
+char *
+hours2hmsStr_r(double hours, char *buf)
+{
+	*fmtHms(hours, buf) = '\0' ;
+	return buf ;
+}
 
+/**
+ * "hh:mm.mm"
+ */
 char *
-deg2dmsStr(degrees)
-	double degrees ;
+hours2hmStr_r(double hours, char *buf)
 {
-	int	d,m,s,ss ;
+	*fmtHm(hours, buf) = '\0' ;
+	return buf ;
+}
 
+/**
+ * "h:mm:ss.ssssss", as convertHms().
+ */
+char *
+convertHms_r(double hours, char *buf)
+{
+	*fmtConvertHms(hours, buf) = '\0' ;
+	return buf ;
+}
+
+
+/**
+ * Format n values one after another into out, separated by the
+ * character sep (none if 0), and terminate with a NUL.  out must
+ * hold n * FMT_BUFSIZE bytes.
+ * @param format  FMT_YMD, FMT_TIME, FMT_DATETIME, FMT_DMS, FMT_DM,
+ *		  FMT_HMS, FMT_HM or FMT_HMS6, for julian2ymdStr(),
+ *		  julian2hmsStr(), julian2str(), deg2dmsStr(), deg2dmStr(),
+ *		  hours2hmsStr(), hours2hmStr() and convertHms()
+ * @return the length written, or 0 for an unknown format.
+ */
+size_t
+formatValues(int n, const double *v, int format, int sep, char *out)
+{
+	char	*(*fmt)(double, char *) ;
+	char	*p = out ;
+	int	i ;
+
+	if( format < 0 || format >= (int)(sizeof(formatters)/sizeof(*formatters)) ) {
+	  *out = '\0' ;
+	  return 0 ;
+	}
+	fmt = formatters[format] ;
+	for(i=0; i < n; ++i) {
+	  if( i > 0 && sep != 0 )
+	    *p++ = sep ;
+	  p = fmt(v[i], p) ;
+	}
+	*p = '\0' ;
+	return p - out ;
+}
+
+
+char *
+julian2ymdStr(double jdate)
+{
 	rvalNext() ;
-	d = degrees ;
-	m = (int)(degrees * 60) % 60 ;
-	s = (int)(degrees * 3600) % 60 ;
-	ss = (int)(degrees * 36000 + .5) % 10 ;
-	snprintf(rval, sizeof(rval), "%3.3d°%2.2d'%2.2d.%1.1d", d,m,s,ss) ;
-	return rval ;
+	return julian2ymdStr_r(jdate, rval) ;
 }
 
 
 char *
-deg2dmStr(degrees)
-	double	degrees ;
+julian2hmsStr(double jdate)
 {
-	int	d,m,mm ;
-	int	sign = 0 ;
+	rvalNext() ;
+	return julian2hmsStr_r(jdate, rval) ;
+}
 
+
+char *
+julian2str(double jdate)
+{
 	rvalNext() ;
-	if( degrees < 0. ) {
-	  sign = 1 ;
-	  degrees = -degrees ;
-	}
-	d = degrees ;
-	m = (int)(degrees * 60) % 60 ;
-	mm = (int)(degrees * 6000 + .5) % 100 ;
-	snprintf(rval, sizeof(rval), "%s%d°%2.2d.%2.2d", sign?"-":"", d,m,mm) ;
-	return rval ;
+	return julian2str_r(jdate, rval) ;
 }
 
 
 char *
-hours2hmsStr(hours)
-	double hours ;
+deg2dmsStr(double degrees)
 {
-	int	h,m,s,ss ;
+	rvalNext() ;
+	return deg2dmsStr_r(degrees, rval) ;
+}
+
 
+char *
+deg2dmStr(double degrees)
+{
 	rvalNext() ;
-	h = hours ;
-	m = (int)(hours * 60) % 60 ;
-	s = (int)(hours * 3600) % 60 ;
-	ss = (int)(hours * 36000 + .5) % 10 ;
-	snprintf(rval, sizeof(rval), "%2d:%2.2d:%2.2d.%1.1d", h,m,s,ss) ;
-	return rval ;
+	return deg2dmStr_r(degrees, rval) ;
 }
 
 
 char *
-hours2hmStr(hours)
-	double	hours ;
+hours2hmsStr(double hours)
 {
-	int	h,m,mm ;
+	rvalNext() ;
+	return hours2hmsStr_r(hours, rval) ;
+}
 
+
+char *
+hours2hmStr(double hours)
+{
 	rvalNext() ;
-	h = hours ;
-	m = (int)(hours * 60) % 60 ;
-	mm = (int)(hours * 6000 + .5) % 100 ;
-	snprintf(rval, sizeof(rval), "%2d:%2.2d.%2.2d", h,m,mm) ;
-	return rval ;
+	return hours2hmStr_r(hours, rval) ;
 }
@@ -11,13 +11,6 @@
 
 #define	degrees	* RAD
 
-static inline void
-range(double *x)
-{
-	while( *x < 0. ) *x += 360. ;
-	if( *x >= 360. ) *x -= (int)*x/360*360 ;
-}
-
 
 	/* Return info about the moon.  Not all fields in planet state
 	 * are filled in
@@ -51,7 +44,7 @@ MoonPrecise(date, m)
 	Ohm= 259.183275 -   1934.1420*T + .002078*T2 + .0000022*T3 ;
 	M  = 358.475833 +  35999.0498*T - .000150*T2 - .0000033*T3 ;
 
-	range(&Ohm) ;
+	Ohm = limitAngle(Ohm) ;
 
 	/* additive terms */
 
@@ -81,11 +74,11 @@ MoonPrecise(date, m)
 	e = 1 - .002495*T - .00000752*T2 ; e2 = e*e ;
 
 
-	range(&Lm) ;
-	range(&Mm) ;
-	range(&D) ;
-	range(&F) ;
-	range(&M) ;
+	Lm = limitAngle(Lm) ;
+	Mm = limitAngle(Mm) ;
+	D = limitAngle(D) ;
+	F = limitAngle(F) ;
+	M = limitAngle(M) ;
 
 	/* convert M,Mm,D,F to radians to make things quicker */
 	M *= RAD ;
@@ -240,14 +233,14 @@ MoonPrecise(date, m)
 	m->mag = 0. ;	/* TODO */
 	m->v = 0. ;	/* TODO */
 	m->R = 6378.14 / dsin(par) ;	/* kilometers, TODO: AU */
-	range( &m->L ) ;
-	range( &m->i ) ;
-	range( &m->w ) ;
-	range( &m->om ) ;
-	range( &m->pi ) ;
-	range( &m->M ) ;
-	range( &m->lat ) ; if( m->lat > 180. ) m->lat -= 360. ;
-	range( &m->lon ) ;
+	m->L = limitAngle(m->L) ;
+	m->i = limitAngle(m->i) ;
+	m->w = limitAngle(m->w) ;
+	m->om = limitAngle(m->om) ;
+	m->pi = limitAngle(m->pi) ;
+	m->M = limitAngle(m->M) ;
+	m->lat = limitAngleSigned(m->lat) ;
+	m->lon = limitAngle(m->lon) ;
 	m->year = 0. ;	/* TODO */
 }
 
@@ -284,11 +277,11 @@ Moon(date, m)
 	e = 1 - .002495*T - .00000752*T2 ; e2 = e*e ;
 
 
-	range(&Lm) ;
-	range(&Mm) ;
-	range(&D) ;
-	range(&F) ;
-	range(&M) ;
+	Lm = limitAngle(Lm) ;
+	Mm = limitAngle(Mm) ;
+	D = limitAngle(D) ;
+	F = limitAngle(F) ;
+	M = limitAngle(M) ;
 
 	/* convert M,Mm,D,F to radians to make things quicker */
 	M *= RAD ;
@@ -327,13 +320,13 @@ Moon(date, m)
 	m->mag = 0. ;	/* TODO */
 	m->v = 0. ;	/* TODO */
 	m->R = 6378.14 / dsin(par) ;	/* kilometers, TODO: AU */
-	range( &m->L ) ;
-	range( &m->i ) ;
-	range( &m->w ) ;
-	range( &m->om ) ;
-	range( &m->pi ) ;
-	range( &m->M ) ;
-	range( &m->lat ) ; if( m->lat > 180. ) m->lat -= 360. ;
-	range( &m->lon ) ;
+	m->L = limitAngle(m->L) ;
+	m->i = limitAngle(m->i) ;
+	m->w = limitAngle(m->w) ;
+	m->om = limitAngle(m->om) ;
+	m->pi = limitAngle(m->pi) ;
+	m->M = limitAngle(m->M) ;
+	m->lat = limitAngleSigned(m->lat) ;
+	m->lon = limitAngle(m->lon) ;
 	m->year = 0. ;	/* TODO */
 }
@@ -1,5 +1,7 @@
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 #include <math.h>
@@ -17,6 +19,10 @@
  * sha2gha(double sha, double jdate)
  *	convert Sidereal Hour Angle to Grenwich Hour Angle
  *
+ * void
+ * sha2gha_n(int n, const double *sha, double jdate, double *gha)
+ *	the same for many objects at one time
+ *
  * double
  * gha2lha(double sha, double longitude)
  *	convert Grenwich Hour Angle to Local Hour Angle
@@ -31,6 +37,19 @@
  * double
  * sext2obs(Hs, ie, h, T, P, HP)
  *	Compute sextant altitude.
+ *
+ * void
+ * sightReduce_n(n, gha, dec, lat, lon, Ho, Hc, Zn, intercept)
+ *	Hc, Zn and intercept for n sights at once.
+ *
+ * int
+ * sightFix(const Almanac *alm, const SightSet *set, Fix *fix)
+ *	Position from a set of sights by least squares, as a running
+ *	fix if the vessel is under way.
+ *
+ * int
+ * sightFix_n(alm, n, sets, nthreads, fixes)
+ *	n fixes, in parallel.
  */
 
 
@@ -52,6 +71,19 @@ sha2gha(double sha, double jdate)
 }
 
 
+  /* the same for n objects, finding the sidereal time once */
+
+void
+sha2gha_n(int n, const double *sha, double jdate, double *gha)
+{
+  double aries = 15.*time2sidereal(jdate) ;
+  int i ;
+
+  for(i = 0; i < n; ++i)
+    gha[i] = limitAngle( sha[i] + aries ) ;
+}
+
+
   /* convert grenwhich hour angle and longitude to local hour angle */
 
 double
@@ -137,6 +169,293 @@ sext2obs(double Hs, double ie, double h, double T, double P, double HP)
   return H - Ro + PA ;
 }
 
+/* Sights in bulk.
+ *
+ * sightReduce_n() is altaz() for many sights.  The sines and cosines
+ * are taken first; the rest has no branches or calls, with the
+ * polynomial arc cosine for altitude and azimuth, and vectorizes
+ * given -O3 -fno-math-errno -fno-trapping-math.  It agrees with
+ * altaz() to 0.0001'.
+ *
+ * sightFix() finds the position by least squares.  Every sight is
+ * reduced from the current estimate, each intercept a = Ho - Hc gives
+ * one equation  a = dN cos Zn + dE sin Zn  in the shift of position
+ * north and east (in miles), and the shift that minimizes the squared
+ * intercepts is applied, until it is under 0.001 mile.  For a running
+ * fix each sight is reduced from the estimate moved along the DR
+ * track, course and speed, by the time between the sight and the fix.
+ * The covariance is (N'N)^-1 scaled by the variance of the intercepts
+ * at the fix, residual sum of squares / (n-2), or by sigma^2 when
+ * there are only two sights.
+ *
+ * GHA and declination come from the almanac tables if alm is not
+ * NULL (see AlmanacGhaDec()), otherwise from almanacPositions().
+ * Hs is corrected as sext2obs(), with the semidiameter of the Sun or
+ * Moon for the limb.
+ */
+
+#define	SIGHT_BLOCK	64
+#define	FIX_BLOCK	16		/* fixes per thread chunk */
+#define	FIX_ITERATIONS	10
+#define	SUN_SD		(959.63/8.794)	/* Sun's semidiameter / HP */
+#define	MOON_SD		0.2725		/* Moon's semidiameter / HP */
+
+
+  /* Hc (degrees), cos Zn and sin Zn for up to SIGHT_BLOCK sights */
+
+static void
+reduceBlock(int n, const double *gha, const double *dec,
+	const double *lat, const double *lon,
+	double *Hc, double *cz, double *sz)
+{
+  double sh[SIGHT_BLOCK], ch[SIGHT_BLOCK] ;
+  double sd[SIGHT_BLOCK], cd[SIGHT_BLOCK] ;
+  double sl[SIGHT_BLOCK], cl[SIGHT_BLOCK] ;
+  int i ;
+
+  for(i = 0; i < n; ++i) {
+    double lha = (gha[i] + lon[i]) * RAD ;
+    sh[i] = sin(lha) ;
+    ch[i] = cos(lha) ;
+    sd[i] = sin(dec[i] * RAD) ;
+    cd[i] = cos(dec[i] * RAD) ;
+    sl[i] = sin(lat[i] * RAD) ;
+    cl[i] = cos(lat[i] * RAD) ;
+  }
+
+  for(i = 0; i < n; ++i) {
+    double s = sd[i]*sl[i] + cd[i]*cl[i]*ch[i] ;
+    double r ;
+    s = s > 1. ? 1. : s < -1. ? -1. : s ;
+    r = sqrt(1. - s*s) ;
+    r = 1. / (r > 1e-12 ? r : 1e-12) ;
+    Hc[i] = 90. - acosPoly(s) * DEG ;
+    cz[i] = (sd[i]*cl[i] - cd[i]*sl[i]*ch[i]) * r ;
+    sz[i] = -cd[i]*sh[i] * r ;
+  }
+}
+
+
+  /* Given GHA, declination, position (longitude east) and observed
+   * altitude of n sights, all degrees, compute Hc and Zn (degrees) and
+   * the intercept (minutes, toward positive).  Ho and intercept may be
+   * NULL.
+   */
+
+void
+sightReduce_n(int n, const double *gha, const double *dec,
+	const double *lat, const double *lon, const double *Ho,
+	double *Hc, double *Zn, double *intercept)
+{
+  double cz[SIGHT_BLOCK], sz[SIGHT_BLOCK] ;
+  int i, j, nb ;
+
+  for(i = 0; i < n; i += nb) {
+    nb = n - i < SIGHT_BLOCK ? n - i : SIGHT_BLOCK ;
+    reduceBlock(nb, gha+i, dec+i, lat+i, lon+i, Hc+i, cz, sz) ;
+    for(j = 0; j < nb; ++j) {
+      double c = cz[j] > 1. ? 1. : cz[j] < -1. ? -1. : cz[j] ;
+      double a = acosPoly(c) * DEG ;
+      Zn[i+j] = sz[j] < 0. ? 360. - a : a ;
+    }
+    if( Ho != NULL && intercept != NULL )
+      for(j = 0; j < nb; ++j)
+	intercept[i+j] = (Ho[i+j] - Hc[i+j]) * 60. ;
+  }
+}
+
+
+  /* horizontal parallax from the tables, minutes */
+
+static double
+almanacHP(const Almanac *alm, int body, double jd)
+{
+  double t = (jd - alm->jd0) * 24. ;
+  int k = (int)t < alm->nhours ? (int)t : alm->nhours - 1 ;
+  const AlmanacEntry *e = &alm->rows[(size_t)k * ALM_NBODIES + body] ;
+
+  return e[0].hp + (t - k) * (e[ALM_NBODIES].hp - e[0].hp) ;
+}
+
+
+  /* GHA, declination and observed altitude of one sight */
+
+static int
+sightObserved(const Almanac *alm, const SightSet *set, const Sight *s,
+	double *gha, double *dec, double *Ho)
+{
+  double g[ALM_NBODIES], d[ALM_NBODIES], hp[ALM_NBODIES] ;
+  double HP, SD = 0. ;
+  int b = s->body ;
+
+  if( b < 0 || b >= ALM_NBODIES )
+    return -1 ;
+  if( alm != NULL ) {
+    if( AlmanacGhaDec(alm, b, s->jd, gha, dec) < 0 )
+      return -1 ;
+    HP = almanacHP(alm, b, s->jd) ;
+  } else {
+    almanacPositions(s->jd, g, d, hp) ;
+    *gha = g[b] ;
+    *dec = d[b] ;
+    HP = hp[b] ;
+  }
+
+  if( b == SIGHT_STAR ) {
+    *gha = limitAngle(*gha + s->sha) ;
+    *dec = s->dec ;
+  }
+  else if( b == ALM_SUN )
+    SD = HP * SUN_SD ;
+  else if( b == ALM_MOON )
+    SD = HP * MOON_SD ;
+
+  *Ho = sext2obs(s->Hs, set->ie, set->height, set->T, set->P, HP/60.) +
+	s->limb * SD/60. ;
+  return 0 ;
+}
+
+
+  /* Find the position at set->jd from set->nsights sights, starting
+   * from the DR.  Returns 0, or -1 if there are fewer than two sights,
+   * a sight is outside the almanac, the lines of position are too
+   * nearly parallel or the solution doesn't converge.
+   */
+
+int
+sightFix(const Almanac *alm, const SightSet *set, Fix *fix)
+{
+  int n = set->nsights ;
+  double plat[SIGHT_BLOCK], plon[SIGHT_BLOCK] ;
+  double Hc[SIGHT_BLOCK], cz[SIGHT_BLOCK], sz[SIGHT_BLOCK] ;
+  double *buf, *gha, *dec, *Ho, *dn, *de ;
+  double lat = set->lat, lon = set->lon ;
+  double cc = cosd(set->course), sc = sind(set->course) ;
+  double nn, ne, ee, bn, be, ss, det, x, y, clat, s2 ;
+  int i, j, nb, iter ;
+
+  memset(fix, 0, sizeof(*fix)) ;
+  fix->lat = lat ;
+  fix->lon = lon ;
+  fix->status = -1 ;
+  if( n < 2 || (buf = malloc(n * 5 * sizeof(double))) == NULL )
+    return -1 ;
+  gha = buf ; dec = gha + n ; Ho = dec + n ; dn = Ho + n ; de = dn + n ;
+
+  for(i = 0; i < n; ++i) {
+    const Sight *s = &set->sights[i] ;
+    double run = set->speed * (s->jd - set->jd) * 24. ;	/* miles */
+    if( sightObserved(alm, set, s, &gha[i], &dec[i], &Ho[i]) < 0 ) {
+      free(buf) ;
+      return -1 ;
+    }
+    dn[i] = run * cc ;
+    de[i] = run * sc ;
+  }
+
+  for(iter = 1; iter <= FIX_ITERATIONS; ++iter)
+  {
+    nn = ne = ee = bn = be = ss = 0. ;
+    clat = cosd(lat) ;
+    for(i = 0; i < n; i += nb) {
+      nb = n - i < SIGHT_BLOCK ? n - i : SIGHT_BLOCK ;
+      for(j = 0; j < nb; ++j) {
+	plat[j] = lat + dn[i+j] / 60. ;
+	plon[j] = lon + de[i+j] / (60. * clat) ;
+      }
+      reduceBlock(nb, gha+i, dec+i, plat, plon, Hc, cz, sz) ;
+      for(j = 0; j < nb; ++j) {
+	double a = (Ho[i+j] - Hc[j]) * 60. ;
+	nn += cz[j]*cz[j] ;
+	ne += cz[j]*sz[j] ;
+	ee += sz[j]*sz[j] ;
+	bn += cz[j]*a ;
+	be += sz[j]*a ;
+	ss += a*a ;
+      }
+    }
+
+    det = nn*ee - ne*ne ;
+    if( !(det > 1e-6 * (nn+ee)*(nn+ee)) )
+      break ;				/* lines of position parallel */
+    x = (ee*bn - ne*be) / det ;		/* miles north */
+    y = (nn*be - ne*bn) / det ;		/* miles east */
+    lat += x / 60. ;
+    lon += y / (60. * clat) ;
+    if( x*x + y*y < 1e-6 ) {
+      ss -= x*bn + y*be ;		/* residuals at the fix */
+      ss = ss > 0. ? ss : 0. ;
+      s2 = n > 2 ? ss / (n-2) :
+	set->sigma > 0. ? set->sigma * set->sigma : 1. ;
+      fix->lat = lat ;
+      fix->lon = limitAngleSigned(lon) ;
+      fix->cov[0] = s2 * ee / det ;
+      fix->cov[1] = -s2 * ne / det ;
+      fix->cov[2] = s2 * nn / det ;
+      fix->rms = sqrt(ss / n) ;
+      fix->status = 0 ;
+      break ;
+    }
+  }
+  fix->iterations = iter <= FIX_ITERATIONS ? iter : FIX_ITERATIONS ;
+  free(buf) ;
+  return fix->status ;
+}
+
+
+typedef struct {
+  const Almanac *alm ;
+  const SightSet *sets ;
+  Fix *fixes ;
+  int n ;
+} FixJob ;
+
+static int
+fixChunk(TextChunk *chunk, void *arg)
+{
+  FixJob *job = arg ;
+  int i0 = chunk->index * FIX_BLOCK ;
+  int i1 = i0 + FIX_BLOCK < job->n ? i0 + FIX_BLOCK : job->n ;
+  int i ;
+
+  for(i = i0; i < i1; ++i)
+    sightFix(job->alm, &job->sets[i], &job->fixes[i]) ;
+  return 0 ;
+}
+
+
+  /* sightFix() for n sets of sights on nthreads threads (numThreads()
+   * if <= 0).  Returns the number of sets with no fix, or -1 on error.
+   */
+
+int
+sightFix_n(const Almanac *alm, int n, const SightSet *sets, int nthreads,
+	Fix *fixes)
+{
+  FixJob job ;
+  TextChunk *chunks ;
+  int nchunks = (n + FIX_BLOCK - 1) / FIX_BLOCK ;
+  int i, bad = 0 ;
+
+  if( n <= 0 )
+    return 0 ;
+  if( (chunks = calloc(nchunks, sizeof(*chunks))) == NULL )
+    return -1 ;
+  for(i = 0; i < nchunks; ++i)
+    chunks[i].index = i ;
+  job.alm = alm ;
+  job.sets = sets ;
+  job.fixes = fixes ;
+  job.n = n ;
+  if( runTextChunks(chunks, nchunks, nthreads, fixChunk, &job) != 0 )
+    bad = -1 ;
+  free(chunks) ;
+
+  for(i = 0; i < n && bad >= 0; ++i)
+    bad += fixes[i].status != 0 ;
+  return bad ;
+}
+
 
 
 /* Quick overview of spherical trig:
@@ -167,6 +486,130 @@ sext2obs(double Hs, double ie, double h, double T, double P, double HP)
 
 
 #ifdef	STANDALONE
+
+#define	NFIX	10000
+#define	NSIGHT	4
+
+static double
+now()
+{
+  struct timespec ts ;
+  clock_gettime(CLOCK_MONOTONIC, &ts) ;
+  return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+  /* sextant altitude that sext2obs() turns into Ho */
+
+static double
+obs2sext(double Ho, double ie, double h, double T, double P, double HP)
+{
+  double Hs = Ho ;
+  int i ;
+
+  for(i = 0; i < 6; ++i)
+    Hs += Ho - sext2obs(Hs, ie, h, T, P, HP) ;
+  return Hs ;
+}
+
+  /* Benchmark: NFIX running fixes of NSIGHT stars each, taken over
+   * 1.5 hours by a vessel making 12 knots, from DR positions up to
+   * 20 miles out.  The stars are placed to be seen at given altitudes
+   * and azimuths from the true track, and the sights have 0.5' of
+   * random error.
+   */
+
+static void
+fixBenchmark()
+{
+  static SightSet sets[NFIX] ;
+  static Sight sights[NFIX][NSIGHT] ;
+  static Fix fixes[NFIX] ;
+  static double gha[NFIX], dec[NFIX], lat[NFIX], lon[NFIX], Hc[NFIX], Zn[NFIX] ;
+  Almanac alm ;
+  double t0, t1, err, worst = 0., sd = 0., iters = 0. ;
+  int i, j, k, bad ;
+
+  if( AlmanacCompute(date2julian(2024, 1, 1.), 31, 0, &alm) < 0 )
+    return ;
+  srand(1) ;
+  for(i = 0; i < NFIX; ++i)
+  {
+    SightSet *set = &sets[i] ;
+    double tlat = (rand() / (RAND_MAX + 1.) - .5) * 120. ;
+    double tlon = (rand() / (RAND_MAX + 1.) - .5) * 360. ;
+    double jd = date2julian(2024, 1, 2. + rand() / (RAND_MAX + 1.) * 28.) ;
+
+    set->jd = jd ;
+    set->course = rand() / (RAND_MAX + 1.) * 360. ;
+    set->speed = 12. ;
+    set->lat = tlat + (rand() / (RAND_MAX + 1.) - .5) * 20./60. ;
+    set->lon = tlon + (rand() / (RAND_MAX + 1.) - .5) * 20./60. / cosd(tlat) ;
+    set->height = 10. ;
+    set->nsights = NSIGHT ;
+    set->sights = sights[i] ;
+    lat[i] = tlat ;
+    lon[i] = tlon ;
+
+    for(k = 0; k < NSIGHT; ++k)
+    {
+      Sight *s = &sights[i][k] ;
+      double run = set->speed * (k - (NSIGHT-1)) * .5 ;
+      double plat = tlat + run * cosd(set->course) / 60. ;
+      double plon = tlon + run * sind(set->course) / (60. * cosd(tlat)) ;
+      double h = 25. + 10.*k, z = 30. + 90.*k + 20.*(i%3), aries, x ;
+
+      s->jd = jd + (k - (NSIGHT-1)) * .5/24. ;
+      s->body = SIGHT_STAR ;
+      AlmanacGhaDec(&alm, SIGHT_STAR, s->jd, &aries, &x) ;
+      s->dec = asind(sind(plat)*sind(h) + cosd(plat)*cosd(h)*cosd(z)) ;
+      x = atan2d(-sind(z)*cosd(h), (sind(h) - sind(plat)*sind(s->dec)) /
+		cosd(plat)) ;
+      s->sha = limitAngle(x - plon - aries) ;
+      s->Hs = obs2sext(h, 0., set->height, 0., 0., 0.) ;
+      for(x = -6., j = 0; j < 12; ++j)	/* 0.5' of noise */
+	x += rand() / (RAND_MAX + 1.) ;
+      s->Hs += x * .5/60. ;
+    }
+  }
+
+  t0 = now() ;
+  bad = sightFix_n(&alm, NFIX, sets, 0, fixes) ;
+  t1 = now() ;
+  for(i = 0; i < NFIX; ++i) {
+    err = hypot(fixes[i].lat - lat[i],
+	limitAngleSigned(fixes[i].lon - lon[i]) * cosd(lat[i])) * 60. ;
+    worst = err > worst ? err : worst ;
+    sd += sqrt(fixes[i].cov[0] + fixes[i].cov[2]) ;
+    iters += fixes[i].iterations ;
+  }
+  printf("%d running fixes of %d sights: %.0f fixes/s on %d threads, %d failed\n",
+    NFIX, NSIGHT, NFIX / (t1 - t0), numThreads(), bad) ;
+  printf("  worst error %.2f mile, mean sd %.2f mile, %.1f iterations\n",
+    worst, sd / NFIX, iters / NFIX) ;
+
+  t0 = now() ;
+  sightFix_n(&alm, NFIX, sets, 1, fixes) ;
+  t1 = now() ;
+  printf("  %.0f fixes/s on 1 thread\n", NFIX / (t1 - t0)) ;
+
+  for(i = 0; i < NFIX; ++i) {
+    gha[i] = sights[i][0].sha ;
+    dec[i] = sights[i][0].dec ;
+  }
+  t0 = now() ;
+  sightReduce_n(NFIX, gha, dec, lat, lon, NULL, Hc, Zn, NULL) ;
+  t1 = now() ;
+  for(i = 0, worst = 0.; i < NFIX; ++i) {
+    double alt, az ;
+    altaz(limitAngle(gha[i] + lon[i]), dec[i], lat[i], &alt, &az) ;
+    err = fabs(alt - Hc[i]) + fabs(limitAngleSigned(az - Zn[i])) ;
+    worst = err > worst ? err : worst ;
+  }
+  printf("sightReduce_n(): %.1f ns/sight, differs from altaz() by %.5f'\n",
+    (t1 - t0) / NFIX * 1e9, worst * 60.) ;
+  FreeAlmanac(&alm) ;
+}
+
 int
 main()
 {
@@ -226,6 +669,7 @@ main()
   Ho = sext2obs(49.6083, 0., 5.4, -3., 982., 0.) ;
   printf("Ho = %.4f\n", Ho) ;
 
+  fixBenchmark() ;
   return 0;
 }
 #endif	/* STANDALONE */
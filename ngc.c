@@ -0,0 +1,238 @@
+	/* Read the OpenNGC deep-sky catalog */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * OpenNGC, https://github.com/mattiaverga/OpenNGC, lists the NGC and
+ * IC objects, with the Messier objects outside them in a separate
+ * addendum, as ';' separated text with a header line naming the
+ * columns:
+ *
+ *	Name;Type;RA;Dec;Const;MajAx;MinAx;PosAng;B-Mag;V-Mag;...;
+ *	Hubble;...;M;NGC;IC;...;Common names;...
+ *
+ *	NGC0224;G;00:42:44.35;+41:16:08.6;And;177.83;69.66;35;4.29;3.44;...
+ *
+ * Columns are found by name, since they have moved between releases.
+ * Positions are J2000.  OpenNGC's types map onto ours:
+ *
+ *	GCl			CG  globular cluster
+ *	OCl *Ass Cl+N		CO  open cluster
+ *	G GPair GTrpl GGroup	GS  galaxy, or GP if elliptical
+ *	PN			NP  planetary nebula
+ *	HII EmN RfN Neb SNR DrkN	ND  diffuse nebula
+ *
+ * Stars, duplicates, novae and nonexistent objects are skipped.
+ * Like the star readers in tycho.c, this appends to a StarCatalog;
+ * reading Tycho-2 and OpenNGC into one catalog before indexing it
+ * gives field queries that return stars and deep-sky objects
+ * together.
+ */
+
+#define	MAXFIELDS	64
+
+enum { F_NAME, F_TYPE, F_RA, F_DEC, F_CONST, F_MAJ, F_MIN, F_PA,
+	F_BMAG, F_VMAG, F_HUBBLE, F_M, F_COMMON, NCOLS } ;
+
+static const char *colNames[NCOLS] = {
+	"Name", "Type", "RA", "Dec", "Const", "MajAx", "MinAx", "PosAng",
+	"B-Mag", "V-Mag", "Hubble", "M", "Common names",
+} ;
+
+static const struct {
+	  const char *ngc ;
+	  const char *type ;
+	} typeMap[] = {
+	  {"GCl", "CG"}, {"OCl", "CO"}, {"*Ass", "CO"}, {"Cl+N", "CO"},
+	  {"G", "GS"}, {"GPair", "GS"}, {"GTrpl", "GS"}, {"GGroup", "GS"},
+	  {"PN", "NP"}, {"HII", "ND"}, {"EmN", "ND"}, {"RfN", "ND"},
+	  {"Neb", "ND"}, {"SNR", "ND"}, {"DrkN", "ND"},
+	  {NULL, NULL}
+} ;
+
+/**
+ * Split a line into ';' separated fields, in place.  Unlike
+ * strtok(), empty fields are kept.
+ * @return number of fields
+ */
+static int
+splitFields(char *line, char **fields)
+{
+	int	n = 0 ;
+
+	line[strcspn(line, "\r\n")] = '\0' ;
+	fields[n++] = line ;
+	while( (line = strchr(line, ';')) != NULL && n < MAXFIELDS ) {
+	  *line++ = '\0' ;
+	  fields[n++] = line ;
+	}
+	return n ;
+}
+
+/**
+ * Parse "dd:mm:ss.s", with optional sign.
+ */
+static double
+parseSexagesimal(const char *s)
+{
+	double	d = 0., m = 0., x = 0. ;
+	int	neg = 0 ;
+
+	s += strspn(s, " ") ;
+	if( *s == '-' || *s == '+' )
+	  neg = *s++ == '-' ;
+	sscanf(s, "%lf:%lf:%lf", &d, &m, &x) ;
+	d += m/60. + x/3600. ;
+	return neg ? -d : d ;
+}
+
+static uint16_t
+arcmin10(const char *s)
+{
+	double	a = atof(s) * 10. ;
+	return a <= 0. ? 0 : a >= 65535. ? 65535 : (uint16_t)(a + .5) ;
+}
+
+/**
+ * Catalog number from a name like "NGC0224" or "IC0434"; 0 for other
+ * names, including components such as "NGC5194A" or "IC0011 NED01".
+ */
+static uint32_t
+dsoNumber(const char *name)
+{
+	const char *p ;
+	uint32_t num ;
+
+	if( strncmp(name, "NGC", 3) == 0 )
+	  p = name + 3 ;
+	else if( strncmp(name, "IC", 2) == 0 )
+	  p = name + 2 ;
+	else
+	  return 0 ;
+	if( !isdigit(*p) || p[strspn(p, "0123456789")] != '\0' )
+	  return 0 ;
+	num = atol(p) ;
+	return name[0] == 'I' ? DSO_IC(num) : DSO_NGC(num) ;
+}
+
+
+/**
+ * Read an OpenNGC file (NGC.csv or addendum.csv), appending objects
+ * of magnitude maxmag or brighter to cat.  V magnitudes are used if
+ * known, otherwise B; objects with neither are kept with magnitude
+ * 99 (stored as 32.767), so a query for them needs maxmag >= 33.
+ *
+ * Catalog numbers are DSO_NGC() or DSO_IC() of the object's number;
+ * the name is the first common name, or "NGC 224" style.  Size,
+ * position angle and Messier number go in the shape.
+ *
+ * @return number of objects added, or -1 on error.
+ */
+int
+ReadOpenNGC(const char *filename, float maxmag, StarCatalog *cat)
+{
+	char	line[4096], name[64] ;
+	char	*f[MAXFIELDS] ;
+	int	col[NCOLS] ;
+	FILE	*ifile ;
+	int	count = 0 ;
+	int	nf, i, j ;
+
+	if( filename == NULL )
+	  filename = "NGC.csv" ;
+
+	if( (ifile = fopen(filename, "r")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	/* header: find our columns */
+	if( fgets(line, sizeof(line), ifile) == NULL ) {
+	  fclose(ifile) ;
+	  return 0 ;
+	}
+	nf = splitFields(line, f) ;
+	for(i=0; i < NCOLS; ++i) {
+	  col[i] = -1 ;
+	  for(j=0; j < nf; ++j)
+	    if( strcmp(f[j], colNames[i]) == 0 )
+	      col[i] = j ;
+	  if( col[i] < 0 && i <= F_DEC ) {
+	    fprintf(stderr, "%s: no \"%s\" column, not OpenNGC\n",
+		filename, colNames[i]) ;
+	    fclose(ifile) ;
+	    return -1 ;
+	  }
+	}
+
+	while( fgets(line, sizeof(line), ifile) != NULL )
+	{
+	  Star	s ;
+	  CompactStar c ;
+	  DsoShape shape ;
+	  const char *common = NULL ;
+	  uint32_t num ;
+
+#define	FIELD(k)	(col[k] >= 0 && col[k] < nf ? f[col[k]] : "")
+
+	  nf = splitFields(line, f) ;
+	  for(i=0; typeMap[i].ngc != NULL; ++i)
+	    if( strcmp(FIELD(F_TYPE), typeMap[i].ngc) == 0 )
+	      break ;
+	  if( typeMap[i].ngc == NULL || *FIELD(F_RA) == '\0' )
+	    continue ;
+
+	  memset(&s, 0, sizeof(s)) ;
+	  s.mag = *FIELD(F_VMAG) != '\0' ? atof(FIELD(F_VMAG)) :
+		  *FIELD(F_BMAG) != '\0' ? atof(FIELD(F_BMAG)) : 99. ;
+	  if( s.mag > maxmag )
+	    continue ;
+	  s.ra = parseSexagesimal(FIELD(F_RA)) * 15. ;
+	  s.dec = parseSexagesimal(FIELD(F_DEC)) ;
+	  s.epoch = 2000 ;
+	  strcpy(s.type, typeMap[i].type) ;
+	  if( strcmp(s.type, "GS") == 0 &&
+	      (FIELD(F_HUBBLE)[0] == 'E' || strncmp(FIELD(F_HUBBLE), "dE", 2) == 0) )
+	    strcpy(s.type, "GP") ;
+	  compactStar(&s, &c) ;
+	  num = dsoNumber(FIELD(F_NAME)) ;
+	  c.cat = num ;
+	  for(i=1; constellations[i] != NULL; ++i)
+	    if( strcmp(FIELD(F_CONST), constellations[i]) == 0 )
+	      c.cons = i ;
+
+	  shape.major = arcmin10(FIELD(F_MAJ)) ;
+	  shape.minor = arcmin10(FIELD(F_MIN)) ;
+	  shape.pa = *FIELD(F_PA) != '\0' ? atoi(FIELD(F_PA)) : -1 ;
+	  shape.messier = atoi(FIELD(F_M)) ;
+
+	  if( *FIELD(F_COMMON) != '\0' ) {
+	    snprintf(name, sizeof(name), "%.*s",
+		(int)strcspn(FIELD(F_COMMON), ","), FIELD(F_COMMON)) ;
+	    common = name ;
+	  }
+	  else if( num != 0 ) {
+	    snprintf(name, sizeof(name), "%s %u",
+		DSO_ISIC(num) ? "IC" : "NGC", DSO_NUM(num)) ;
+	    common = name ;
+	  }
+	  else
+	    common = FIELD(F_NAME) ;
+#undef	FIELD
+
+	  if( StarCatalogAddDSO(cat, &c, &shape, common) < 0 ) {
+	    fclose(ifile) ;
+	    return -1 ;
+	  }
+	  ++count ;
+	}
+
+	fclose(ifile) ;
+	return count ;
+}
@@ -0,0 +1,749 @@
+	/* Lunar occultations of catalog stars */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * The Moon covers a band of sky about a degree wide in an hour,
+ * shifted by up to a degree by parallax depending on where the
+ * observer stands.  Rather than test every star against the Moon at
+ * every time step, the search walks the Moon's geocentric track an
+ * hour at a time and asks the catalog index for the stars in a box
+ * around that hour's stretch of track, widened by the parallax and
+ * semidiameter.  Only those candidates are tested against each
+ * observing site:
+ *
+ *  1. The Moon's topocentric direction is sampled every five minutes
+ *     for each site (the geocentric Moon is interpolated from three
+ *     exact positions, the observer's position is exact) and each
+ *     candidate's closest sample is compared with the semidiameter.
+ *  2. Candidates that come within a few arcminutes of the limb are
+ *     refined with exact positions: the time of least separation by
+ *     fitting a parabola to the square of the separation, which is
+ *     exact for motion in a straight line, then disappearance and
+ *     reappearance by the secant method.
+ *
+ * Stars are brought to the date by proper motion and precession and
+ * are given annual aberration; nutation moves the Moon and the stars
+ * alike and is left out.  Times are UT, converted to TT for the
+ * Moon with deltaT().  MoonPrecise() is good to 10" or
+ * so, which is 20 seconds of time; contact times are good to about
+ * half a minute and grazes are not reliable.  No limb profile.
+ *
+ * Time is divided into windows of a day, and the sites into groups;
+ * each window and group is a work item for a pool of threads.  The
+ * sites of a group share the Moon positions and candidate search.
+ *
+ * int
+ * StarCatalogOccultations(const StarCatalog *cat, const Site *sites,
+ *		int nsites, double jd0, double jd1, float maxmag,
+ *		int nthreads, Occultation **rval)
+ *	Find all occultations of catalog stars at a list of sites.
+ *
+ * void
+ * MoonTopocentric(double jd, const Site *site, double *decl,
+ *		double *RA, double *dist)
+ *	Position of the Moon as seen from a site.
+ */
+
+#define	MOON_K		0.2725076	/* Moon's radius, Earth radii */
+#define	EARTH_A		6378140.	/* Earth's equatorial radius, m */
+#define	EARTH_BA	0.99664719	/* polar / equatorial radius */
+#define	ABERRATION	(20.49552/3600.*RAD)	/* constant of aberration */
+
+#define	WINDOW		1.		/* days per work item */
+#define	SEGMENT		(1./24.)	/* days of track per candidate search */
+#define	NSAMPLE		13		/* screening samples per segment */
+#define	STEP		(SEGMENT/(NSAMPLE-1))
+#define	SCREEN		0.05		/* screening margin, degrees */
+#define	GROUP		16		/* sites per work item */
+#define	CONTACT		(3./24.)	/* search for contacts this far out */
+
+
+/**
+ * Where a site is, in the form the vector calculations want.
+ * Meeus, Astronomical Algorithms, ch. 11.
+ */
+typedef struct {
+	  double rc, rs ;	/* rho cos(phi'), rho sin(phi'), Earth radii */
+	  double sinlat, coslat ;
+	  double lon ;		/* degrees, positive west */
+	} SiteGeo ;
+
+static void
+siteGeo(const Site *site, SiteGeo *g)
+{
+	double	u = atan(EARTH_BA * tan(site->lat * RAD)) ;
+	double	h = site->height / EARTH_A ;
+
+	g->rc = cos(u) + h * cosd(site->lat) ;
+	g->rs = EARTH_BA * sin(u) + h * sind(site->lat) ;
+	g->sinlat = sind(site->lat) ;
+	g->coslat = cosd(site->lat) ;
+	g->lon = site->lon ;
+}
+
+/**
+ * Observer's position, Earth radii, and zenith, equatorial of date.
+ */
+static void
+siteVector(const SiteGeo *g, double jd, double o[3], double zen[3])
+{
+	double	th = (time2sidereal(jd) * 15. - g->lon) * RAD ;
+	double	c = cos(th), s = sin(th) ;
+
+	o[0] = g->rc * c ;
+	o[1] = g->rc * s ;
+	o[2] = g->rs ;
+	if( zen != NULL ) {
+	  zen[0] = g->coslat * c ;
+	  zen[1] = g->coslat * s ;
+	  zen[2] = g->sinlat ;
+	}
+}
+
+/**
+ * Geocentric Moon, equatorial of date, Earth radii.  jd is UT.
+ */
+static void
+moonVector(double jd, double v[3])
+{
+	PlanetState p ;
+	double	jde = convertTime(jd, TS_UT1, TS_TT) ;
+	double	decl, RA, r ;
+
+	MoonPrecise(jde, &p) ;
+	ecliptic2equat(p.lat, p.lon, &decl, &RA, jde) ;
+	r = 1. / sind(p.ad) ;
+	v[0] = r * cosd(decl) * cosd(RA*15.) ;
+	v[1] = r * cosd(decl) * sind(RA*15.) ;
+	v[2] = r * sind(decl) ;
+}
+
+static double
+dot(const double a[3], const double b[3])
+{
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] ;
+}
+
+/**
+ * Angle between unit vector s and direction t, degrees, to full
+ * precision at small angles.
+ */
+static double
+separation(const double t[3], const double s[3])
+{
+	double	x = t[1]*s[2] - t[2]*s[1] ;
+	double	y = t[2]*s[0] - t[0]*s[2] ;
+	double	z = t[0]*s[1] - t[1]*s[0] ;
+	return atan2d(sqrt(x*x + y*y + z*z), dot(t, s)) ;
+}
+
+/**
+ * Distance of star s from the Moon's limb as seen from a site,
+ * degrees, negative when the star is behind the Moon.  Returns the
+ * separation from the centre in *sep if not NULL.
+ */
+static double
+limbDistance(const SiteGeo *g, const double s[3], double jd, double *sep)
+{
+	double	v[3], o[3], t[3] ;
+	double	d, c ;
+
+	moonVector(jd, v) ;
+	siteVector(g, jd, o, NULL) ;
+	t[0] = v[0]-o[0] ; t[1] = v[1]-o[1] ; t[2] = v[2]-o[2] ;
+	d = sqrt(dot(t, t)) ;
+	c = separation(t, s) ;
+	if( sep != NULL )
+	  *sep = c ;
+	return c - asind(MOON_K / d) ;
+}
+
+/**
+ * Altitude of the Moon and Sun from a site, degrees.
+ */
+static void
+altitudes(const SiteGeo *g, double jd, double *moonalt, double *sunalt)
+{
+	double	v[3], o[3], zen[3], t[3] ;
+	double	decl, RA, rad ;
+
+	moonVector(jd, v) ;
+	siteVector(g, jd, o, zen) ;
+	t[0] = v[0]-o[0] ; t[1] = v[1]-o[1] ; t[2] = v[2]-o[2] ;
+	*moonalt = asind(dot(t, zen) / sqrt(dot(t, t))) ;
+
+	SunEquatorial(jd, &decl, &RA, &rad) ;
+	*sunalt = asind(zen[2] * sind(decl) +
+		sqrt(zen[0]*zen[0] + zen[1]*zen[1]) * cosd(decl) *
+		cos(atan2(zen[1], zen[0]) - RA*15.*RAD)) ;
+}
+
+
+/**
+ * Position of the Moon as seen from a site: declination in degrees,
+ * right ascension in hours, equator and equinox of date, and
+ * distance in km.  jd is UT.
+ */
+void
+MoonTopocentric(double jd, const Site *site, double *decl, double *RA,
+	double *dist)
+{
+	SiteGeo	g ;
+	double	v[3], o[3], t[3] ;
+	double	d ;
+
+	siteGeo(site, &g) ;
+	moonVector(jd, v) ;
+	siteVector(&g, jd, o, NULL) ;
+	t[0] = v[0]-o[0] ; t[1] = v[1]-o[1] ; t[2] = v[2]-o[2] ;
+	d = sqrt(dot(t, t)) ;
+	*decl = asind(t[2] / d) ;
+	*RA = atan2d(t[1], t[0]) / 15. ;
+	if( *RA < 0. )
+	  *RA += 24. ;
+	if( dist != NULL )
+	  *dist = d * EARTH_A / 1000. ;
+}
+
+
+typedef struct {
+	  const StarCatalog *cat ;
+	  const Site *sites ;
+	  int	nsites ;
+	  int	ngroups ;	/* work items per window */
+	  double jd0, jd1 ;
+	  int16_t mag ;
+	  double pmmargin ;	/* largest proper motion over the range, degrees */
+	} OccultJob ;
+
+/* One candidate star, brought to the date */
+typedef struct {
+	  int	idx ;
+	  double s[3] ;
+	} Candidate ;
+
+
+/**
+ * Time when the limb distance of star s crosses zero between lo and
+ * hi, starting from a guess.  The limb distance is nearly linear in
+ * time near a contact, so the secant method takes a few steps; for
+ * grazes, where it isn't, fall back on bisection.
+ */
+static double
+contact(const SiteGeo *g, const double s[3], double lo, double hi,
+	double guess)
+{
+	double	x0 = guess, x1, f0, f1, x2 ;
+	double	flo ;
+	int	i ;
+
+	x1 = x0 + (hi - lo > 0. ? 1e-4 : -1e-4) ;
+	f0 = limbDistance(g, s, x0, NULL) ;
+	f1 = limbDistance(g, s, x1, NULL) ;
+	for(i=0; i < 8 && f1 != f0; ++i) {
+	  x2 = x1 - f1 * (x1 - x0) / (f1 - f0) ;
+	  if( x2 < lo || x2 > hi )
+	    break ;
+	  if( fabs(x2 - x1) < 1e-6 )
+	    return x2 ;
+	  x0 = x1 ; f0 = f1 ;
+	  x1 = x2 ; f1 = limbDistance(g, s, x1, NULL) ;
+	}
+
+	if( (flo = limbDistance(g, s, lo, NULL)) * limbDistance(g, s, hi, NULL) > 0. )
+	  return lo ;				/* not bracketed */
+	for(i=0; i < 24; ++i) {
+	  x2 = (lo + hi) / 2. ;
+	  if( (limbDistance(g, s, x2, NULL) > 0.) == (flo > 0.) )
+	    lo = x2 ;
+	  else
+	    hi = x2 ;
+	}
+	return (lo + hi) / 2. ;
+}
+
+/**
+ * Time of least separation near tm, given the separation at tm-h, tm,
+ * tm+h.  For straight-line motion the square of the separation is a
+ * parabola in time, so two fits are enough.  Returns the curvature of
+ * the last fit in *acc, degrees^2/day^2.
+ */
+static double
+leastSeparation(const SiteGeo *g, const double s[3], double tm, double h,
+	double y0, double y1, double y2, double *acc)
+{
+	double	den ;
+	int	pass ;
+
+	for(pass = 0; ; ++pass)
+	{
+	  y0 *= y0 ; y1 *= y1 ; y2 *= y2 ;
+	  den = y0 - 2.*y1 + y2 ;
+	  *acc = den / (h*h) ;
+	  if( den > 0. )
+	    tm += h * fmax(-1., fmin(1., (y0 - y2) / (2.*den))) ;
+	  if( pass == 1 )
+	    return tm ;
+	  h = STEP / 10. ;
+	  limbDistance(g, s, tm - h, &y0) ;
+	  limbDistance(g, s, tm, &y1) ;
+	  limbDistance(g, s, tm + h, &y2) ;
+	}
+}
+
+
+/**
+ * Refine one close approach of star c to the Moon for a site, near
+ * time tm, given its separations sep[] at tm-STEP, tm, tm+STEP.  Adds
+ * it to the chunk's results if it's an occultation with the Moon
+ * above the horizon at either contact.
+ */
+static int
+refine(const OccultJob *job, TextChunk *chunk, int *nalloc, int site,
+	const SiteGeo *g, const Candidate *c, double tm, const double sep[3])
+{
+	double	tmin, lmin, smin, acc, half ;
+	double	in, out, alt, sunalt ;
+	Occultation *occ ;
+
+	tmin = leastSeparation(g, c->s, tm, STEP, sep[0], sep[1], sep[2], &acc) ;
+	if( tmin < job->jd0 || tmin >= job->jd1 )
+	  return 0 ;
+	if( (lmin = limbDistance(g, c->s, tmin, &smin)) >= 0. )
+	  return 0 ;
+
+	/* contacts, starting from the straight-line estimate */
+	half = acc > 0. ? sqrt((2.*smin - lmin) * -lmin * 2. / acc) : STEP ;
+	half = fmin(half, CONTACT) ;
+	in = contact(g, c->s, tmin - CONTACT, tmin, tmin - half) ;
+	out = contact(g, c->s, tmin, tmin + CONTACT, tmin + half) ;
+
+	/* keep it if either contact can be seen */
+	altitudes(g, tmin, &alt, &sunalt) ;
+	if( alt <= 0. ) {
+	  double a1, a2, sa ;
+	  altitudes(g, in, &a1, &sa) ;
+	  altitudes(g, out, &a2, &sa) ;
+	  if( a1 <= 0. && a2 <= 0. )
+	    return 0 ;
+	}
+
+	if( chunk->count >= *nalloc ) {
+	  *nalloc = *nalloc > 0 ? *nalloc*2 : 64 ;
+	  if( (occ = realloc(chunk->data, *nalloc * sizeof(*occ))) == NULL )
+	    return -1 ;
+	  chunk->data = occ ;
+	}
+	occ = (Occultation *)chunk->data + chunk->count++ ;
+	occ->site = site ;
+	occ->star = c->idx ;
+	occ->jd = tmin ;
+	occ->in = in ;
+	occ->out = out ;
+	occ->limb = lmin * 3600. ;
+	occ->alt = alt ;
+	occ->sunalt = sunalt ;
+	return 0 ;
+}
+
+
+/**
+ * Stars in the lunar band for the hour ta..tb, given the geocentric
+ * Moon vm[] at ta, the midpoint and tb.  Fills cand, brought to the
+ * equinox of the midpoint with aberration.  Returns the count.
+ */
+static int
+candidates(const OccultJob *job, const double vm[3][3], double tm,
+	Candidate **cand, int *calloc_)
+{
+	const StarCatalog *cat = job->cat ;
+	int	ranges[4*CAT_ZONES] ;
+	double	P[3][3], u[3][3] ;	/* precession, Moon directions J2000 */
+	double	ra[3], dec[3] ;
+	double	margin, cosm, w, d0, d1, dmax ;
+	double	ab[3], lat, lon, rad, eps ;
+	int	i, j, k, r, nr, n = 0 ;
+
+	precessionMatrix(JD2000, tm, P) ;
+
+	/* margin: parallax, semidiameter, track between samples, proper
+	 * motion, aberration */
+	margin = 0. ;
+	for(k=0; k < 3; ++k) {
+	  double d = sqrt(dot(vm[k], vm[k])) ;
+	  double m = asind(1. / d) + asind(MOON_K / d) ;
+	  if( m > margin ) margin = m ;
+	  for(i=0; i < 3; ++i)
+	    u[k][i] = (P[0][i]*vm[k][0] + P[1][i]*vm[k][1] + P[2][i]*vm[k][2]) / d ;
+	  ra[k] = limitAngle(atan2d(u[k][1], u[k][0])) ;
+	  dec[k] = asind(u[k][2]) ;
+	}
+	margin += SCREEN + .15 + job->pmmargin + .01 ;
+	cosm = cosd(margin) ;
+
+	d0 = fmin(dec[0], fmin(dec[1], dec[2])) - margin ;
+	d1 = fmax(dec[0], fmax(dec[1], dec[2])) + margin ;
+	dmax = fmax(fabs(d0), fabs(d1)) ;
+	w = 0. ;
+	for(k=0; k < 3; k += 2) {
+	  double dr = fabs(ra[k] - ra[1]) ;
+	  if( dr > 180. ) dr = 360. - dr ;
+	  if( dr > w ) w = dr ;
+	}
+	if( dmax >= 89. || (w += margin / cosd(dmax)) >= 180. )
+	  nr = StarCatalogRanges(cat, 0., 360., d0, d1, ranges) ;
+	else
+	  nr = StarCatalogRanges(cat, limitAngle(ra[1] - w),
+		limitAngle(ra[1] + w), d0, d1, ranges) ;
+
+	/* annual aberration: Earth moves towards the Sun's longitude - 90 */
+	SunEcliptic(tm, &lat, &lon, &rad) ;
+	eps = obliquity(tm) ;
+	ab[0] = ABERRATION * sind(lon) ;
+	ab[1] = -ABERRATION * cosd(lon) * cosd(eps) ;
+	ab[2] = -ABERRATION * cosd(lon) * sind(eps) ;
+
+	for(r = 0; r < nr; ++r)
+	  for(i = ranges[2*r]; i < ranges[2*r+1]; ++i)
+	  {
+	    const CompactStar *c = &cat->stars[i] ;
+	    double sra, sdec, s[3], pmr, pmd, len ;
+
+	    if( c->mag > job->mag )
+	      continue ;
+	    sra = c->ra / CU_PER_DEG ;
+	    sdec = c->dec / CU_PER_DEG ;
+	    s[0] = cosd(sdec) * cosd(sra) ;
+	    s[1] = cosd(sdec) * sind(sra) ;
+	    s[2] = sind(sdec) ;
+	    if( dot(s, u[0]) < cosm && dot(s, u[1]) < cosm && dot(s, u[2]) < cosm )
+	      continue ;
+
+	    if( n >= *calloc_ ) {
+	      Candidate *p ;
+	      *calloc_ = *calloc_ > 0 ? *calloc_*2 : 256 ;
+	      if( (p = realloc(*cand, *calloc_ * sizeof(*p))) == NULL )
+		return -1 ;
+	      *cand = p ;
+	    }
+	    pmr = c->pmr * .001 ;
+	    pmd = c->pmd * .001 ;
+	    propagateStars(1, &sra, &sdec, &pmr, &pmd, NULL, NULL,
+		(tm - (JD2000 + (c->epoch-100)*365.25)) / 365.25, &sra, &sdec) ;
+	    s[0] = cosd(sdec) * cosd(sra) ;
+	    s[1] = cosd(sdec) * sind(sra) ;
+	    s[2] = sind(sdec) ;
+	    (*cand)[n].idx = i ;
+	    for(j=0; j < 3; ++j)
+	      (*cand)[n].s[j] = P[j][0]*s[0] + P[j][1]*s[1] + P[j][2]*s[2] + ab[j] ;
+	    len = sqrt(dot((*cand)[n].s, (*cand)[n].s)) ;
+	    for(j=0; j < 3; ++j)
+	      (*cand)[n].s[j] /= len ;
+	    ++n ;
+	  }
+	return n ;
+}
+
+
+/**
+ * One window of time for one group of sites.
+ */
+static int
+occultChunk(TextChunk *chunk, void *arg)
+{
+	const OccultJob *job = arg ;
+	int	window = chunk->index / job->ngroups ;
+	int	s0 = (chunk->index % job->ngroups) * GROUP ;
+	int	s1 = s0 + GROUP < job->nsites ? s0 + GROUP : job->nsites ;
+	double	t0 = job->jd0 + window * WINDOW ;
+	double	t1 = t0 + WINDOW < job->jd1 ? t0 + WINDOW : job->jd1 ;
+	SiteGeo	g[GROUP] ;
+	Candidate *cand = NULL ;
+	int	ncand, calloc_ = 0 ;
+	int	nalloc = 0 ;
+	double	vm[3][3] ;
+	double	ta ;
+	int	i, j, k, s ;
+
+	for(s = s0; s < s1; ++s)
+	  siteGeo(&job->sites[s], &g[s-s0]) ;
+
+	moonVector(t0, vm[2]) ;
+	for(ta = t0; ta < t1; ta += SEGMENT)
+	{
+	  double tb = ta + SEGMENT, tm = ta + SEGMENT/2. ;
+	  double v[NSAMPLE+2][3] ;
+
+	  memcpy(vm[0], vm[2], sizeof(vm[0])) ;
+	  moonVector(tm, vm[1]) ;
+	  moonVector(tb, vm[2]) ;
+	  if( (ncand = candidates(job, vm, tm, &cand, &calloc_)) < 0 )
+	    goto fail ;
+	  if( ncand == 0 )
+	    continue ;
+
+	  /* geocentric Moon through the hour, by quadratic interpolation,
+	   * and two steps into the next */
+	  for(j=0; j < NSAMPLE+2; ++j) {
+	    double x = 2.*j/(NSAMPLE-1) - 1. ;
+	    for(i=0; i < 3; ++i)
+	      v[j][i] = vm[1][i] + x*(vm[2][i] - vm[0][i])/2. +
+		  x*x*((vm[0][i] + vm[2][i])/2. - vm[1][i]) ;
+	  }
+
+	  for(s = s0; s < s1; ++s)
+	  {
+	    double t[NSAMPLE+2][3], sd[NSAMPLE+2] ;
+
+	    for(j=0; j < NSAMPLE+2; ++j) {
+	      double o[3], d ;
+	      siteVector(&g[s-s0], ta + j*STEP, o, NULL) ;
+	      for(i=0; i < 3; ++i)
+		t[j][i] = v[j][i] - o[i] ;
+	      d = sqrt(dot(t[j], t[j])) ;
+	      for(i=0; i < 3; ++i)
+		t[j][i] /= d ;
+	      sd[j] = asind(MOON_K / d) ;
+	    }
+
+	    for(k=0; k < ncand; ++k)
+	    {
+	      const double *sv = cand[k].s ;
+	      double best = -2., c, sep[3] ;
+	      int jb = 0 ;
+	      for(j=0; j < NSAMPLE+2; ++j)
+		if( (c = dot(t[j], sv)) > best ) {
+		  best = c ;
+		  jb = j ;
+		}
+	      /* A closest sample at the start belongs to the hour before,
+	       * and more than a step past the end to the hour after.  The
+	       * overlap of a step makes sure nothing falls between; the
+	       * duplicates are removed at the end. */
+	      if( jb == 0 || jb > NSAMPLE )
+		continue ;
+	      for(j=0; j < 3; ++j)
+		sep[j] = separation(t[jb-1+j], sv) ;
+	      if( sep[1] - sd[jb] > SCREEN )
+		continue ;
+	      if( refine(job, chunk, &nalloc, s, &g[s-s0], &cand[k],
+			ta + jb*STEP, sep) < 0 )
+		goto fail ;
+	    }
+	  }
+	}
+	free(cand) ;
+	return 0 ;
+
+fail:
+	free(cand) ;
+	free(chunk->data) ;
+	chunk->data = NULL ;
+	chunk->count = 0 ;
+	return 1 ;
+}
+
+static int
+cmpSiteStar(const void *p1, const void *p2)
+{
+	const Occultation *a = p1, *b = p2 ;
+	if( a->site != b->site ) return a->site - b->site ;
+	if( a->star != b->star ) return a->star - b->star ;
+	return a->jd < b->jd ? -1 : a->jd > b->jd ;
+}
+
+static int
+cmpTime(const void *p1, const void *p2)
+{
+	const Occultation *a = p1, *b = p2 ;
+	if( a->jd != b->jd ) return a->jd < b->jd ? -1 : 1 ;
+	return a->site - b->site ;
+}
+
+
+/**
+ * Find the occultations of catalog stars by the Moon, as seen from a
+ * list of sites, between two dates.  Only events with the Moon above
+ * the horizon at disappearance or reappearance are returned, day or
+ * night; check sunalt for the ones that can be seen.
+ *
+ * @param cat      indexed catalog, positions J2000
+ * @param sites    observing sites
+ * @param jd0,jd1  time range, UT
+ * @param maxmag   faintest stars to consider
+ * @param nthreads number of threads, 0 for numThreads()
+ * @param rval     returned array of events in order of time, to be
+ *		   freed by the caller
+ * @return number of events, or -1 on error
+ */
+int
+StarCatalogOccultations(const StarCatalog *cat, const Site *sites,
+	int nsites, double jd0, double jd1, float maxmag, int nthreads,
+	Occultation **rval)
+{
+	OccultJob job ;
+	TextChunk *chunks ;
+	Occultation *occ = NULL ;
+	int	nwindows, n, count = 0 ;
+	int	i, k ;
+
+	*rval = NULL ;
+	if( cat->cells == NULL || nsites <= 0 || jd1 <= jd0 )
+	  return cat->cells == NULL ? -1 : 0 ;
+
+	job.cat = cat ;
+	job.sites = sites ;
+	job.nsites = nsites ;
+	job.ngroups = (nsites + GROUP - 1) / GROUP ;
+	job.jd0 = jd0 ;
+	job.jd1 = jd1 ;
+	job.mag = maxmag * 1000. > 32767. ? 32767 : lround(maxmag * 1000.) ;
+	job.pmmargin = 0. ;
+	for(i=0; i < cat->count; ++i) {
+	  const CompactStar *c = &cat->stars[i] ;
+	  double ep = JD2000 + (c->epoch - 100) * 365.25 ;
+	  double dt = fmax(fabs(jd0 - ep), fabs(jd1 - ep)) / 365.25 ;
+	  double pm = (abs(c->pmr) + abs(c->pmd)) * .001 / 3600. * dt ;
+	  if( c->mag <= job.mag && pm > job.pmmargin )
+	    job.pmmargin = pm ;
+	}
+
+	nwindows = ceil((jd1 - jd0) / WINDOW) ;
+	n = nwindows * job.ngroups ;
+	if( (chunks = calloc(n, sizeof(*chunks))) == NULL )
+	  return -1 ;
+	for(i=0; i < n; ++i)
+	  chunks[i].index = i ;
+
+	if( runTextChunks(chunks, n, nthreads, occultChunk, &job) == 0 )
+	{
+	  for(i=0; i < n; ++i)
+	    count += chunks[i].count ;
+	  if( (occ = malloc((count > 0 ? count : 1) * sizeof(*occ))) != NULL )
+	  {
+	    for(i = count = 0; i < n; ++i) {
+	      if( chunks[i].count > 0 )
+		memcpy(occ + count, chunks[i].data, chunks[i].count * sizeof(*occ)) ;
+	      count += chunks[i].count ;
+	    }
+	  }
+	}
+	for(i=0; i < n; ++i)
+	  free(chunks[i].data) ;
+	free(chunks) ;
+	if( occ == NULL )
+	  return -1 ;
+
+	/* An approach near the end of one hour can be found from both
+	 * sides; keep one. */
+	qsort(occ, count, sizeof(*occ), cmpSiteStar) ;
+	for(i = k = 0; i < count; ++i)
+	  if( k == 0 || occ[i].site != occ[k-1].site ||
+	      occ[i].star != occ[k-1].star || occ[i].jd - occ[k-1].jd > .01 )
+	    occ[k++] = occ[i] ;
+	count = k ;
+	qsort(occ, count, sizeof(*occ), cmpTime) ;
+
+	*rval = occ ;
+	return count ;
+}
+
+
+#ifdef	STANDALONE
+
+#include <time.h>
+#include <unistd.h>
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+  "usage: %s [-m mag] [-d days] [-j jd] [-n threads] [-a] catalog.cat lat,lon[,height]...\n"
+  "	List lunar occultations of catalog stars at one or more sites.\n"
+  "	lat, lon in degrees, longitude positive west, height in metres.\n"
+  "	-m mag	faintest star, default 8\n"
+  "	-d days	days to search, default 365\n"
+  "	-j jd	starting Julian date, default now\n"
+  "	-n n	number of threads\n"
+  "	-a	include daylight events\n", prog) ;
+	exit(2) ;
+}
+
+int
+main(int argc, char **argv)
+{
+	StarCatalog cat ;
+	Site	*sites ;
+	Occultation *occ ;
+	float	maxmag = 8. ;
+	double	days = 365., jd0 = jnow() ;
+	int	nthreads = 0, all = 0 ;
+	int	nsites = 0, n, i, c ;
+	struct timespec t0, t1 ;
+
+	while( (c = getopt(argc, argv, "m:d:j:n:a")) != -1 )
+	  switch( c ) {
+	    case 'm': maxmag = atof(optarg) ; break ;
+	    case 'd': days = atof(optarg) ; break ;
+	    case 'j': jd0 = atof(optarg) ; break ;
+	    case 'n': nthreads = atoi(optarg) ; break ;
+	    case 'a': all = 1 ; break ;
+	    default: usage(argv[0]) ;
+	  }
+	if( argc - optind < 2 )
+	  usage(argv[0]) ;
+
+	if( StarCatalogOpen(argv[optind], &cat) < 0 )
+	  return 1 ;
+	if( (sites = calloc(argc - optind, sizeof(*sites))) == NULL )
+	  return 1 ;
+	for(i = optind+1; i < argc; ++i) {
+	  Site *st = &sites[nsites++] ;
+	  if( sscanf(argv[i], "%lf,%lf,%lf", &st->lat, &st->lon, &st->height) < 2 )
+	    usage(argv[0]) ;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0) ;
+	n = StarCatalogOccultations(&cat, sites, nsites, jd0, jd0 + days,
+		maxmag, nthreads, &occ) ;
+	clock_gettime(CLOCK_MONOTONIC, &t1) ;
+	if( n < 0 ) {
+	  fprintf(stderr, "%s: catalog is not indexed\n", argv[optind]) ;
+	  return 1 ;
+	}
+
+	for(i=0; i < n; ++i)
+	{
+	  const CompactStar *s = &cat.stars[occ[i].star] ;
+	  const char *name = StarCatalogName(&cat, occ[i].star) ;
+	  int	y,m,d, hr,mn ;
+	  double sec ;
+	  if( !all && occ[i].sunalt > -6. )
+	    continue ;
+	  julian2time(occ[i].jd, &y,&m,&d, &hr,&mn,&sec) ;
+	  printf("%2d %04d-%02d-%02d %02d:%02d:%02.0f", occ[i].site,
+		y, m, d, hr, mn, floor(sec)) ;
+	  julian2time(occ[i].in, &y,&m,&d, &hr,&mn,&sec) ;
+	  printf("  in %02d:%02d:%02.0f", hr, mn, floor(sec)) ;
+	  julian2time(occ[i].out, &y,&m,&d, &hr,&mn,&sec) ;
+	  printf("  out %02d:%02d:%02.0f", hr, mn, floor(sec)) ;
+	  printf("  alt %3.0f sun %4.0f  mag %5.2f  %u %s\n",
+		occ[i].alt, occ[i].sunalt, s->mag * .001, s->cat,
+		name != NULL ? name : "") ;
+	}
+	fprintf(stderr, "%d occultations, %d sites, %.0f days, %.3f s\n",
+		n, nsites, days, (t1.tv_sec - t0.tv_sec) +
+		(t1.tv_nsec - t0.tv_nsec) * 1e-9) ;
+	free(occ) ;
+	free(sites) ;
+	FreeStarCatalog(&cat) ;
+	return 0 ;
+}
+#endif	/* STANDALONE */
@@ -52,14 +52,6 @@ typedef	struct	{
 	} Elements ;
 
 
-static void
-range(double *x)
-{
-	while( *x < 0. ) *x += 360. ;
-	if( *x >= 360. ) *x -= (int)*x/360*360 ;
-}
-
-
 	/* utility: return orbital elements, units in degrees */
 
 static void
@@ -82,12 +74,12 @@ getElements(Elements *el, double date, PlanetState *p)
 	p->ad = el->ad ;
 	p->mag = el->mag ;
 	p->M = el->M0 + el->M1*T + el->M2*T2 ;
-	range( &p->L ) ;
-	range( &p->i ) ;
-	range( &p->w ) ;
-	range( &p->om ) ;
-	range( &p->pi ) ;
-	range( &p->M ) ;
+	p->L = limitAngle(p->L) ;
+	p->i = limitAngle(p->i) ;
+	p->w = limitAngle(p->w) ;
+	p->om = limitAngle(p->om) ;
+	p->pi = limitAngle(p->pi) ;
+	p->M = limitAngle(p->M) ;
 	p->year = 360.*36525./el->L1 ;
 }
 
@@ -102,7 +94,7 @@ anomaly(date, m0,m1,m2)
 	double	M ;
 
 	M = m0 + m1*T + m2*T*T ;
-	range( &M ) ;
+	M = limitAngle(M) ;
 	return M ;
 }
 
@@ -124,12 +116,12 @@ planet(PlanetState *p)
 	u = (p->L - p->M - p->om)*RAD + v ;
 
 	p->lon = datan2(cos(i)*sin(u), cos(u)) + p->om ;
-	range( &p->lon ) ;
+	p->lon = limitAngle(p->lon) ;
 
 	p->lat = dasin( sin(u) * sin(i) ) ;
 
 	p->v = v*DEG ;
-	range( &p->v ) ;
+	p->v = limitAngle(p->v) ;
 }
 
 
@@ -209,7 +201,7 @@ Earth(date, p)
 	SunEcliptic(date, &p->lat, &p->lon, &p->R) ;
 	p->lat = -p->lat ;
 	p->lon += 180. ;
-	range(&p->lon) ;
+	p->lon = limitAngle(p->lon) ;
 	p->year = 365.2424 ;
 }
 
@@ -0,0 +1,1069 @@
+	/* Identify star fields: a geometric hash index for plate solving */
+
+#include <complex.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Given the pixel positions of the stars in a camera image, find
+ * where in the sky the camera was pointed.  The method is the one
+ * used by astrometry.net (Lang et al., 2010):
+ *
+ * Index.  Small groups of four stars, "quads", are chosen all over
+ * the sky.  In a quad, A and B are the two stars furthest apart, and
+ * C and D lie inside the circle with diameter AB.  Placing A at 0 and
+ * B at 1 in the complex plane, the positions of C and D,
+ *
+ *	t = (P - A) / (B - A)
+ *
+ * form a four-number code which does not change when the quad is
+ * moved, rotated or scaled.  The codes are kept in a k-d tree.
+ *
+ * Solve.  Quads are formed from the brightest image stars, brightest
+ * first, and their codes looked up in the tree.  Each hit gives a
+ * candidate mapping from image to sky, which is checked by projecting
+ * the other index stars into the image and counting how many land on
+ * an image star.  The first candidate that passes is refined by a
+ * least-squares fit to all the matched stars.
+ *
+ * A mirrored image conjugates the code, and the labels A/B and C/D
+ * are arbitrary, so each image quad is looked up in eight variants.
+ * The index stores each quad once, in canonical order:
+ * Re(tC) <= Re(tD) and Re(tC) + Re(tD) <= 1.
+ *
+ * Image coordinates are pixels, x right and y down.  On the sky,
+ * positions are projected onto a tangent plane, xi east and eta north
+ * (gnomonic projection), and written w = xi + i*eta.  The mapping
+ * from image to sky is the similarity w = a*z + b, z = x + i*y; for a
+ * mirrored image, z = x - i*y.
+ *
+ * int
+ * PlateIndexBuild(const StarCatalog *cat, float maxmag,
+ *		double smin, double smax, PlateIndex *idx)
+ *	Build an index from the stars of a catalog.
+ *
+ * int
+ * PlateIndexWrite(const PlateIndex *idx, const char *filename)
+ * int
+ * PlateIndexOpen(const char *filename, PlateIndex *idx)
+ *	Save an index to a file and map it back in.
+ *
+ * void
+ * FreePlateIndex(PlateIndex *idx)
+ *
+ * int
+ * PlateSolve(const PlateIndex *idx, const double *x, const double *y,
+ *		int n, double width, double height, PlateSolution *sol)
+ *	Find the field of an image.
+ */
+
+#define	QUAD_NEIGHBORS	10	/* B stars tried for each A */
+#define	QUAD_INSIDE	3	/* C, D chosen from this many stars */
+#define	QUAD_TOL	0.015	/* code match tolerance */
+#define	SOLVE_STARS	20	/* image stars used to form quads */
+#define	VERIFY_STARS	60	/* image stars used to verify */
+#define	VERIFY_MIN	6	/* matches needed to accept */
+
+
+	/* vectors and projections */
+
+static void
+starVector(const CompactStar *s, double v[3])
+{
+	double	ra = s->ra / CU_PER_DEG * RAD, dec = s->dec / CU_PER_DEG * RAD ;
+	v[0] = cos(dec) * cos(ra) ;
+	v[1] = cos(dec) * sin(ra) ;
+	v[2] = sin(dec) ;
+}
+
+static double
+dot3(const double a[3], const double b[3])
+{
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] ;
+}
+
+static void
+normalize3(double v[3])
+{
+	double	r = sqrt(dot3(v, v)) ;
+	v[0] /= r ; v[1] /= r ; v[2] /= r ;
+}
+
+/**
+ * A tangent plane: the point of tangency and the east and north
+ * unit vectors there.
+ */
+typedef struct {
+	  double c[3], e[3], n[3] ;
+	} Tangent ;
+
+static void
+makeTangent(const double c[3], Tangent *t)
+{
+	double	r = hypot(c[0], c[1]) ;
+
+	memcpy(t->c, c, sizeof(t->c)) ;
+	if( r < 1e-12 ) {		/* at a pole, pick any east */
+	  t->e[0] = 0. ; t->e[1] = 1. ; t->e[2] = 0. ;
+	} else {
+	  t->e[0] = -c[1]/r ; t->e[1] = c[0]/r ; t->e[2] = 0. ;
+	}
+	t->n[0] = c[1]*t->e[2] - c[2]*t->e[1] ;
+	t->n[1] = c[2]*t->e[0] - c[0]*t->e[2] ;
+	t->n[2] = c[0]*t->e[1] - c[1]*t->e[0] ;
+}
+
+static double complex
+project(const Tangent *t, const double v[3])
+{
+	double	d = dot3(v, t->c) ;
+	return dot3(v, t->e)/d + I * (dot3(v, t->n)/d) ;
+}
+
+static void
+deproject(const Tangent *t, double complex w, double v[3])
+{
+	int	i ;
+	for(i=0; i < 3; ++i)
+	  v[i] = t->c[i] + creal(w) * t->e[i] + cimag(w) * t->n[i] ;
+	normalize3(v) ;
+}
+
+
+	/* quad codes */
+
+static void
+quadCode(double complex a, double complex b,
+	double complex c, double complex d, float code[4])
+{
+	double complex ab = b - a ;
+	double complex tc = (c - a) / ab, td = (d - a) / ab ;
+	code[0] = creal(tc) ; code[1] = cimag(tc) ;
+	code[2] = creal(td) ; code[3] = cimag(td) ;
+}
+
+/**
+ * Put a quad in canonical order, see above.
+ */
+static void
+canonQuad(PlateQuad *q)
+{
+	uint32_t s ;
+	float	f ;
+	int	i ;
+
+	if( q->code[0] + q->code[2] > 1. ) {		/* swap A, B */
+	  for(i=0; i < 4; ++i)
+	    q->code[i] = (i & 1) ? -q->code[i] : 1. - q->code[i] ;
+	  s = q->star[0] ; q->star[0] = q->star[1] ; q->star[1] = s ;
+	}
+	if( q->code[0] > q->code[2] ) {			/* swap C, D */
+	  f = q->code[0] ; q->code[0] = q->code[2] ; q->code[2] = f ;
+	  f = q->code[1] ; q->code[1] = q->code[3] ; q->code[3] = f ;
+	  s = q->star[2] ; q->star[2] = q->star[3] ; q->star[3] = s ;
+	}
+}
+
+
+	/* k-d tree */
+
+/*
+ * The tree is implicit in the order of the quads array: the root of
+ * the range lo..hi is the quad at mid = (lo+hi)/2, splitting on code
+ * dimension depth%4, with the smaller values before it.  No pointers,
+ * so the array can be written to a file and mapped back.
+ */
+
+static void
+selectQuad(PlateQuad *q, int lo, int hi, int k, int dim)
+{
+	PlateQuad tmp ;
+
+	while( hi - lo > 1 )
+	{
+	  float	pivot = q[(lo+hi)/2].code[dim] ;
+	  int	i = lo, j = hi-1 ;
+	  while( i <= j ) {
+	    while( q[i].code[dim] < pivot ) ++i ;
+	    while( q[j].code[dim] > pivot ) --j ;
+	    if( i <= j ) {
+	      tmp = q[i] ; q[i] = q[j] ; q[j] = tmp ;
+	      ++i ; --j ;
+	    }
+	  }
+	  if( k <= j )
+	    hi = j+1 ;
+	  else if( k >= i )
+	    lo = i ;
+	  else
+	    return ;
+	}
+}
+
+static void
+buildTree(PlateQuad *q, int lo, int hi, int depth)
+{
+	int	mid = (lo+hi)/2 ;
+
+	if( hi - lo < 2 )
+	  return ;
+	selectQuad(q, lo, hi, mid, depth % 4) ;
+	buildTree(q, lo, mid, depth+1) ;
+	buildTree(q, mid+1, hi, depth+1) ;
+}
+
+typedef int (*QuadHit)(const PlateQuad *q, void *arg) ;
+
+/**
+ * Call hit() for every quad within tol of code in every dimension.
+ * Stops and returns nonzero if hit() does.
+ */
+static int
+searchTree(const PlateQuad *q, int lo, int hi, int depth,
+	const float code[4], float tol, QuadHit hit, void *arg)
+{
+	while( lo < hi )
+	{
+	  int	mid = (lo+hi)/2, dim = depth % 4 ;
+	  float	c = q[mid].code[dim] ;
+	  if( fabsf(q[mid].code[0] - code[0]) <= tol &&
+	      fabsf(q[mid].code[1] - code[1]) <= tol &&
+	      fabsf(q[mid].code[2] - code[2]) <= tol &&
+	      fabsf(q[mid].code[3] - code[3]) <= tol &&
+	      (*hit)(&q[mid], arg) )
+	    return 1 ;
+	  if( code[dim] - tol <= c &&
+	      searchTree(q, lo, mid, depth+1, code, tol, hit, arg) )
+	    return 1 ;
+	  if( code[dim] + tol < c )
+	    return 0 ;
+	  lo = mid+1 ;			/* right subtree, iteratively */
+	  ++depth ;
+	}
+	return 0 ;
+}
+
+
+	/* building the index */
+
+static int
+cmpDec(const void *a, const void *b)
+{
+	const CompactStar *sa = a, *sb = b ;
+	return sa->dec < sb->dec ? -1 : sa->dec > sb->dec ;
+}
+
+/**
+ * Find the first index star at or north of declination dec.
+ */
+static int
+decSearch(const PlateIndex *idx, double dec)
+{
+	int32_t	d = dec <= -90. ? INT32_MIN : dec >= 90. ? INT32_MAX :
+			(int32_t)lround(dec * CU_PER_DEG) ;
+	int	lo = 0, hi = idx->nstars ;
+
+	while( lo < hi ) {
+	  int mid = (lo+hi)/2 ;
+	  if( idx->stars[mid].dec < d )
+	    lo = mid+1 ;
+	  else
+	    hi = mid ;
+	}
+	return lo ;
+}
+
+/**
+ * Collect the index stars within radius degrees of v into list.
+ * @return number found
+ */
+static int
+starsNear(const PlateIndex *idx, const double v[3], double radius, int *list)
+{
+	double	dec = asind(v[2]) ;
+	double	mincos = cosd(radius) ;
+	int	i, end = decSearch(idx, dec + radius) ;
+	int	n = 0 ;
+
+	for(i = decSearch(idx, dec - radius); i < end; ++i)
+	  if( dot3(idx->vec + 3*i, v) >= mincos )
+	    list[n++] = i ;
+	return n ;
+}
+
+/*
+ * Stars are ordered by brightness through keys of rank:32, index:32,
+ * so the comparison needs nothing but the keys.
+ */
+static int
+cmpKey(const void *a, const void *b)
+{
+	uint64_t ka = *(const uint64_t *)a, kb = *(const uint64_t *)b ;
+	return ka < kb ? -1 : ka > kb ;
+}
+
+/* sort a list of stars by rank[] */
+static void
+sortByRank(int *list, int n, const int *rank, uint64_t *keys)
+{
+	int	i ;
+
+	for(i=0; i < n; ++i)
+	  keys[i] = (uint64_t)rank[list[i]] << 32 | list[i] ;
+	qsort(keys, n, sizeof(*keys), cmpKey) ;
+	for(i=0; i < n; ++i)
+	  list[i] = keys[i] & 0xffffffff ;
+}
+
+static int
+addQuad(PlateIndex *idx, int *nalloc, const double *vec,
+	int a, int b, int c, int d)
+{
+	double	m[3] ;
+	Tangent	t ;
+	PlateQuad *q ;
+	int	i ;
+
+	if( idx->nquads >= *nalloc ) {
+	  *nalloc = *nalloc > 0 ? *nalloc*2 : 65536 ;
+	  if( (q = realloc(idx->quads, *nalloc * sizeof(*q))) == NULL )
+	    return -1 ;
+	  idx->quads = q ;
+	}
+	q = &idx->quads[idx->nquads++] ;
+
+	for(i=0; i < 3; ++i)
+	  m[i] = vec[3*a+i] + vec[3*b+i] ;
+	normalize3(m) ;
+	makeTangent(m, &t) ;
+	quadCode(project(&t, vec+3*a), project(&t, vec+3*b),
+		project(&t, vec+3*c), project(&t, vec+3*d), q->code) ;
+	q->star[0] = a ; q->star[1] = b ;
+	q->star[2] = c ; q->star[3] = d ;
+	canonQuad(q) ;
+	return 0 ;
+}
+
+
+/**
+ * Build a plate-solving index from the stars of magnitude maxmag or
+ * brighter in a catalog.  Quads are made with A-B separations from
+ * smin to smax degrees; this should match the cameras to be used, a
+ * quarter to the whole of the field width.
+ *
+ * For each star A, the QUAD_NEIGHBORS brightest fainter stars B at
+ * the right distance are paired with it, and each pair makes quads
+ * with every two of the QUAD_INSIDE brightest stars inside the circle
+ * AB.  The Yale catalog gives about 120,000 quads.
+ *
+ * @return number of quads, or -1 if out of memory
+ */
+int
+PlateIndexBuild(const StarCatalog *cat, float maxmag,
+	double smin, double smax, PlateIndex *idx)
+{
+	int16_t	mag = maxmag * 1000. >= 32767. ? 32767 : lround(maxmag * 1000.) ;
+	double	*vec = NULL ;
+	int	*order = NULL, *rank = NULL, *near = NULL ;
+	uint64_t *keys = NULL ;
+	int	nalloc = 0 ;
+	double	cosmin = cosd(smin) ;
+	int	i, j, k, l ;
+
+	memset(idx, 0, sizeof(*idx)) ;
+	idx->smin = smin ;
+	idx->smax = smax ;
+
+	for(i=0; i < cat->count; ++i)
+	  idx->nstars += cat->stars[i].mag <= mag ;
+	idx->stars = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(CompactStar)) ;
+	vec = idx->vec = malloc((idx->nstars > 0 ? idx->nstars : 1) * 3 * sizeof(double)) ;
+	order = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(int)) ;
+	rank = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(int)) ;
+	near = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(int)) ;
+	keys = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(*keys)) ;
+	if( idx->stars == NULL || vec == NULL || order == NULL ||
+	    rank == NULL || near == NULL || keys == NULL )
+	  goto fail ;
+
+	/* Stars sorted by declination, for starsNear() */
+	for(i=0, j=0; i < cat->count; ++i)
+	  if( cat->stars[i].mag <= mag )
+	    idx->stars[j++] = cat->stars[i] ;
+	qsort(idx->stars, idx->nstars, sizeof(CompactStar), cmpDec) ;
+
+	/* ... and their brightness ranks */
+	for(i=0; i < idx->nstars; ++i) {
+	  starVector(&idx->stars[i], vec + 3*i) ;
+	  order[i] = i ;
+	  rank[i] = idx->stars[i].mag + 32768 ;
+	}
+	sortByRank(order, idx->nstars, rank, keys) ;
+	for(i=0; i < idx->nstars; ++i)
+	  rank[order[i]] = i ;
+
+	for(i=0; i < idx->nstars; ++i)
+	{
+	  int	a = order[i] ;
+	  int	nn = starsNear(idx, vec + 3*a, smax, near) ;
+	  int	nb = 0 ;
+
+	  /* neighbours, brightest first */
+	  sortByRank(near, nn, rank, keys) ;
+
+	  for(j=0; j < nn && nb < QUAD_NEIGHBORS; ++j)
+	  {
+	    int	b = near[j] ;
+	    int	inside[QUAD_INSIDE], ni = 0 ;
+	    double m[3], cosr ;
+
+	    if( rank[b] <= rank[a] || dot3(vec+3*a, vec+3*b) > cosmin )
+	      continue ;
+	    ++nb ;
+
+	    /* brightest stars inside the circle on AB */
+	    for(k=0; k < 3; ++k)
+	      m[k] = vec[3*a+k] + vec[3*b+k] ;
+	    normalize3(m) ;
+	    cosr = dot3(m, vec+3*a) ;
+	    for(k=0; k < nn && ni < QUAD_INSIDE; ++k)
+	      if( near[k] != a && near[k] != b &&
+		  dot3(m, vec+3*near[k]) > cosr )
+		inside[ni++] = near[k] ;
+
+	    for(k=0; k < ni; ++k)
+	      for(l=k+1; l < ni; ++l)
+		if( addQuad(idx, &nalloc, vec, a, b, inside[k], inside[l]) < 0 )
+		  goto fail ;
+	  }
+	}
+
+	buildTree(idx->quads, 0, idx->nquads, 0) ;
+	free(order) ;
+	free(rank) ;
+	free(near) ;
+	free(keys) ;
+	return idx->nquads ;
+
+fail:
+	free(order) ;
+	free(rank) ;
+	free(near) ;
+	free(keys) ;
+	FreePlateIndex(idx) ;
+	return -1 ;
+}
+
+
+/*
+ * Index file, written by PlateIndexWrite() and mapped by
+ * PlateIndexOpen().  Native byte order.
+ *
+ *	header
+ *	CompactStar stars[nstars]	sorted by declination
+ *	PlateQuad quads[nquads]		in k-d tree order
+ */
+
+#define	PLATE_MAGIC	"ASTROQAD"
+#define	PLATE_VERSION	1
+
+typedef struct {
+	  char	magic[8] ;
+	  uint32_t version ;
+	  uint32_t nstars ;
+	  uint32_t nquads ;
+	  uint32_t pad ;
+	  double smin, smax ;
+	} PlateHeader ;
+
+/**
+ * Write an index to a file.
+ * @return 0 on success, -1 on error
+ */
+int
+PlateIndexWrite(const PlateIndex *idx, const char *filename)
+{
+	PlateHeader h ;
+	FILE	*ofile ;
+	int	ok ;
+
+	if( (ofile = fopen(filename, "w")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+	memset(&h, 0, sizeof(h)) ;
+	memcpy(h.magic, PLATE_MAGIC, sizeof(h.magic)) ;
+	h.version = PLATE_VERSION ;
+	h.nstars = idx->nstars ;
+	h.nquads = idx->nquads ;
+	h.smin = idx->smin ;
+	h.smax = idx->smax ;
+
+	ok = fwrite(&h, sizeof(h), 1, ofile) == 1 &&
+	  fwrite(idx->stars, sizeof(CompactStar), idx->nstars, ofile) == (size_t)idx->nstars &&
+	  fwrite(idx->quads, sizeof(PlateQuad), idx->nquads, ofile) == (size_t)idx->nquads ;
+	if( fclose(ofile) != 0 )
+	  ok = 0 ;
+	if( !ok )
+	  perror(filename) ;
+	return ok ? 0 : -1 ;
+}
+
+/**
+ * Map an index file written by PlateIndexWrite().
+ * @return number of quads, or -1 on error
+ */
+int
+PlateIndexOpen(const char *filename, PlateIndex *idx)
+{
+	const PlateHeader *h ;
+	struct stat st ;
+	char	*ptr ;
+	int	fd, i ;
+
+	memset(idx, 0, sizeof(*idx)) ;
+	if( (fd = open(filename, O_RDONLY)) < 0 ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+	if( fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(*h) ) {
+	  fprintf(stderr, "%s: not a plate index\n", filename) ;
+	  close(fd) ;
+	  return -1 ;
+	}
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) ;
+	close(fd) ;
+	if( ptr == MAP_FAILED ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	h = (const PlateHeader *)ptr ;
+	if( memcmp(h->magic, PLATE_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->version != PLATE_VERSION ||
+	    sizeof(*h) + h->nstars*sizeof(CompactStar) +
+		h->nquads*sizeof(PlateQuad) > (size_t)st.st_size )
+	{
+	  fprintf(stderr, "%s: not a plate index\n", filename) ;
+	  munmap(ptr, st.st_size) ;
+	  return -1 ;
+	}
+
+	idx->map = ptr ;
+	idx->mapsize = st.st_size ;
+	idx->nstars = h->nstars ;
+	idx->nquads = h->nquads ;
+	idx->smin = h->smin ;
+	idx->smax = h->smax ;
+	idx->stars = (CompactStar *)(ptr + sizeof(*h)) ;
+	idx->quads = (PlateQuad *)(ptr + sizeof(*h) + h->nstars*sizeof(CompactStar)) ;
+	if( (idx->vec = malloc((idx->nstars > 0 ? idx->nstars : 1) * 3 * sizeof(double))) == NULL ) {
+	  FreePlateIndex(idx) ;
+	  return -1 ;
+	}
+	for(i=0; i < idx->nstars; ++i)
+	  starVector(&idx->stars[i], idx->vec + 3*i) ;
+	return idx->nquads ;
+}
+
+/**
+ * Release everything owned by a PlateIndex.
+ */
+void
+FreePlateIndex(PlateIndex *idx)
+{
+	if( idx->map != NULL )
+	  munmap(idx->map, idx->mapsize) ;
+	else {
+	  free(idx->stars) ;
+	  free(idx->quads) ;
+	}
+	free(idx->vec) ;
+	memset(idx, 0, sizeof(*idx)) ;
+}
+
+
+	/* solving */
+
+typedef struct {
+	  const PlateIndex *idx ;
+	  const double *x, *y ;
+	  int	n ;			/* image stars */
+	  double width, height ;
+	  int	img[4] ;		/* image quad, in the variant's order */
+	  int	parity ;
+	  int	*list ;			/* scratch for starsNear() */
+	  int	*pair ;			/* index star matched to each image star */
+	  int	nver ;			/* image stars used to verify */
+	  PlateSolution *sol ;
+	  int	tried ;
+	} Solver ;
+
+static double complex
+imagePoint(const Solver *s, int i)
+{
+	return s->parity ? s->x[i] - I*s->y[i] : s->x[i] + I*s->y[i] ;
+}
+
+/**
+ * Least-squares similarity from image to tangent plane over the
+ * matched stars.
+ */
+static void
+fitMatches(const Solver *s, const Tangent *t,
+	double complex *a, double complex *b)
+{
+	double complex zm = 0, wm = 0, num = 0 ;
+	double	den = 0. ;
+	int	i, m = 0 ;
+
+	for(i=0; i < s->nver; ++i)
+	  if( s->pair[i] >= 0 ) {
+	    zm += imagePoint(s, i) ;
+	    wm += project(t, s->idx->vec + 3*s->pair[i]) ;
+	    ++m ;
+	  }
+	zm /= m ;
+	wm /= m ;
+	for(i=0; i < s->nver; ++i)
+	  if( s->pair[i] >= 0 ) {
+	    double complex dz = imagePoint(s, i) - zm ;
+	    num += conj(dz) * (project(t, s->idx->vec + 3*s->pair[i]) - wm) ;
+	    den += creal(dz)*creal(dz) + cimag(dz)*cimag(dz) ;
+	  }
+	*a = num / den ;
+	*b = wm - *a * zm ;
+}
+
+/**
+ * Project the index stars around a candidate field into the image
+ * and pair them with image stars.
+ * @return number of pairs
+ */
+static int
+matchField(Solver *s, const Tangent *t, double complex a, double complex b,
+	int *expected)
+{
+	double complex zc = s->parity ? s->width/2 - I*s->height/2 :
+					 s->width/2 + I*s->height/2 ;
+	double	diag = hypot(s->width, s->height) ;
+	double	tol = fmax(2., diag * .002) ;
+	double	c[3] ;
+	int	i, j, k, nf, matched = 0 ;
+
+	deproject(t, a*zc + b, c) ;
+	nf = starsNear(s->idx, c, cabs(a) * diag/2 * DEG * 1.05, s->list) ;
+
+	for(i=0; i < s->nver; ++i)
+	  s->pair[i] = -1 ;
+	*expected = 0 ;
+	for(k=0; k < nf; ++k)
+	{
+	  double complex z ;
+	  double x, y, best = tol ;
+	  int	bi = -1 ;
+
+	  const double *v = s->idx->vec + 3*s->list[k] ;
+	  if( dot3(v, t->c) <= 0. )
+	    continue ;
+	  z = (project(t, v) - b) / a ;
+	  x = creal(z) ;
+	  y = s->parity ? -cimag(z) : cimag(z) ;
+	  if( x < 0. || y < 0. || x > s->width || y > s->height )
+	    continue ;
+	  ++*expected ;
+	  for(j=0; j < s->nver; ++j) {
+	    double d = hypot(s->x[j] - x, s->y[j] - y) ;
+	    if( d < best && s->pair[j] < 0 ) {
+	      best = d ;
+	      bi = j ;
+	    }
+	  }
+	  if( bi >= 0 ) {
+	    s->pair[bi] = s->list[k] ;
+	    ++matched ;
+	  }
+	}
+	return matched ;
+}
+
+/**
+ * A code lookup found a quad: see whether it explains the image.
+ */
+static int
+tryQuad(const PlateQuad *q, void *arg)
+{
+	Solver	*s = arg ;
+	const PlateIndex *idx = s->idx ;
+	const double *va = idx->vec + 3*q->star[0], *vb = idx->vec + 3*q->star[1] ;
+	double	m[3], v[3] ;
+	double complex za, zb, a, b ;
+	Tangent	t ;
+	int	i, matched, expected ;
+	PlateSolution *sol = s->sol ;
+
+	++s->tried ;
+	for(i=0; i < 3; ++i)
+	  m[i] = va[i] + vb[i] ;
+	normalize3(m) ;
+	makeTangent(m, &t) ;
+
+	za = imagePoint(s, s->img[0]) ;
+	zb = imagePoint(s, s->img[1]) ;
+	a = (project(&t, vb) - project(&t, va)) / (zb - za) ;
+	b = project(&t, va) - a * za ;
+
+	matched = matchField(s, &t, a, b, &expected) ;
+	if( matched < VERIFY_MIN ||
+	    matched < .3 * (expected < s->nver ? expected : s->nver) )
+	  return 0 ;
+
+	/*
+	 * Refit, re-centre the tangent plane, refit and rematch.  The
+	 * image is a projection about its own centre, not the quad's, so
+	 * on a wide field the first match is rough at the edges.
+	 */
+	fitMatches(s, &t, &a, &b) ;
+	for(i=0; i < 3; ++i) {
+	  double complex zc = s->parity ? s->width/2 - I*s->height/2 :
+					   s->width/2 + I*s->height/2 ;
+	  deproject(&t, a*zc + b, v) ;
+	  makeTangent(v, &t) ;
+	  fitMatches(s, &t, &a, &b) ;
+	  matched = matchField(s, &t, a, b, &expected) ;
+	  fitMatches(s, &t, &a, &b) ;
+	}
+	if( matched < VERIFY_MIN ||
+	    matched < .5 * (expected < s->nver ? expected : s->nver) )
+	  return 0 ;
+
+	sol->ra = limitAngle(atan2d(t.c[1], t.c[0])) ;
+	sol->dec = asind(t.c[2]) ;
+	sol->scale = cabs(a) * DEG * 3600. ;
+	/* image "up" is z = -i; mirrored, conj(-i) = i */
+	v[0] = creal(a * (s->parity ? I : -I)) ;
+	v[1] = cimag(a * (s->parity ? I : -I)) ;
+	sol->rotation = limitAngle(atan2d(v[0], v[1])) ;
+	sol->parity = s->parity ;
+	sol->matched = matched ;
+	return 1 ;
+}
+
+/**
+ * Look up an image quad in all its variants.
+ */
+static int
+lookupQuad(Solver *s, const int quad[4])
+{
+	static const int perm[4][4] = {
+		{0,1,2,3}, {1,0,2,3}, {0,1,3,2}, {1,0,3,2} } ;
+	float	code[4] ;
+	int	p, v, i ;
+
+	for(p = 0; p < 2; ++p)
+	{
+	  s->parity = p ;
+	  for(v = 0; v < 4; ++v)
+	  {
+	    for(i=0; i < 4; ++i)
+	      s->img[i] = quad[perm[v][i]] ;
+	    quadCode(imagePoint(s, s->img[0]), imagePoint(s, s->img[1]),
+		imagePoint(s, s->img[2]), imagePoint(s, s->img[3]), code) ;
+	    if( searchTree(s->idx->quads, 0, s->idx->nquads, 0, code,
+			QUAD_TOL, tryQuad, s) )
+	      return 1 ;
+	  }
+	}
+	return 0 ;
+}
+
+/**
+ * Identify the field of an image.
+ *
+ * @param x,y	pixel positions of the stars found in the image,
+ *		brightest first; x right, y down
+ * @param n	number of stars
+ * @param width,height	image size, pixels
+ * @param sol	returned solution: the sky position of the image centre,
+ *		scale in arcseconds per pixel, and rotation, the position
+ *		angle of the image's up (-y) direction, east of north
+ * @return 1 if solved, 0 if not, -1 on error
+ *
+ * Quads are formed from the brightest SOLVE_STARS stars, trying the
+ * brightest combinations first.  No hint of position or scale is
+ * needed.
+ */
+int
+PlateSolve(const PlateIndex *idx, const double *x, const double *y,
+	int n, double width, double height, PlateSolution *sol)
+{
+	Solver	s ;
+	int	ns = n < SOLVE_STARS ? n : SOLVE_STARS ;
+	int	quad[4], i, j, k, l ;
+	double	best ;
+	int	rval = 0 ;
+
+	memset(sol, 0, sizeof(*sol)) ;
+	s.idx = idx ;
+	s.x = x ;
+	s.y = y ;
+	s.n = n ;
+	s.nver = n < VERIFY_STARS ? n : VERIFY_STARS ;
+	s.width = width ;
+	s.height = height ;
+	s.sol = sol ;
+	s.tried = 0 ;
+	s.list = malloc((idx->nstars > 0 ? idx->nstars : 1) * sizeof(int)) ;
+	s.pair = malloc((s.nver > 0 ? s.nver : 1) * sizeof(int)) ;
+	if( s.list == NULL || s.pair == NULL ) {
+	  free(s.list) ;
+	  free(s.pair) ;
+	  return -1 ;
+	}
+
+	/* Each new star l combines with the brighter ones before it */
+	for(l = 3; l < ns && !rval; ++l)
+	  for(k = 2; k < l && !rval; ++k)
+	    for(j = 1; j < k && !rval; ++j)
+	      for(i = 0; i < j && !rval; ++i)
+	      {
+		int	set[4] = { i, j, k, l } ;
+		int	p, q, a = 0, b = 1, c, d ;
+		double complex m ;
+
+		/* A, B the most distant pair, C, D inside its circle */
+		best = -1. ;
+		for(p = 0; p < 4; ++p)
+		  for(q = p+1; q < 4; ++q) {
+		    double dd = hypot(x[set[p]]-x[set[q]], y[set[p]]-y[set[q]]) ;
+		    if( dd > best ) { best = dd ; a = p ; b = q ; }
+		  }
+		for(c = 0; c == a || c == b; ++c) ;
+		for(d = c+1; d == a || d == b; ++d) ;
+		m = (x[set[a]] + x[set[b]])/2 + I*(y[set[a]] + y[set[b]])/2 ;
+		if( cabs(x[set[c]] + I*y[set[c]] - m) >= best/2 ||
+		    cabs(x[set[d]] + I*y[set[d]] - m) >= best/2 )
+		  continue ;
+
+		quad[0] = set[a] ; quad[1] = set[b] ;
+		quad[2] = set[c] ; quad[3] = set[d] ;
+		rval = lookupQuad(&s, quad) ;
+	      }
+
+	sol->tried = s.tried ;
+	free(s.list) ;
+	free(s.pair) ;
+	return rval ;
+}
+
+
+#ifdef STANDALONE
+
+#include <time.h>
+
+static	char	usage[] =
+"plate - build a plate-solving index, or solve an image\n"
+"\n"
+"  usage:  plate -b [-m mag] [-s smin,smax] catalog.cat index.qad\n"
+"	build an index from a catalog written by StarCatalogWrite()\n"
+"	-m mag		faintest stars to use (default 6.5)\n"
+"	-s smin,smax	quad sizes, degrees (default 4,20)\n"
+"\n"
+"	  plate index.qad width height < stars\n"
+"	solve an image; stars are \"x y\" lines, brightest first\n"
+"\n"
+"	  plate -t [n]\n"
+"	benchmark: n blind solves of synthetic images\n"
+;
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static void
+printSolution(int ok, const PlateSolution *sol)
+{
+	if( ok <= 0 ) {
+	  printf("no solution (%d quads tried)\n", sol->tried) ;
+	  return ;
+	}
+	printf("centre %.4f %+.4f, scale %.2f\"/pixel, rotation %.2f%s, "
+		"%d stars matched, %d quads tried\n",
+		sol->ra, sol->dec, sol->scale, sol->rotation,
+		sol->parity ? " mirrored" : "", sol->matched, sol->tried) ;
+}
+
+/*
+ * Simulate a camera: gnomonic projection at (ra,dec), given scale and
+ * rotation, centroid noise, a few stars lost and a few spurious ones.
+ */
+static int
+simulate(const PlateIndex *idx, double ra, double dec, double scale,
+	double rot, double width, double height, double *x, double *y)
+{
+	CompactStar c ;
+	Star	st ;
+	Tangent	t ;
+	double	v[3], a ;
+	double complex ca ;
+	int	i, n = 0 ;
+	double	mag[200] ;
+
+	memset(&st, 0, sizeof(st)) ;
+	st.ra = ra ; st.dec = dec ; st.epoch = 2000 ;
+	compactStar(&st, &c) ;
+	starVector(&c, v) ;
+	makeTangent(v, &t) ;
+	/* w = ca * z + b, up (-i) maps to position angle rot */
+	a = scale / 3600. * RAD ;
+	ca = a * cexp(I * (M_PI/2. - rot*RAD)) / -I ;
+	for(i=0; i < idx->nstars && n < 200; ++i)
+	{
+	  double complex z ;
+	  int	k ;
+	  starVector(&idx->stars[i], v) ;
+	  if( dot3(v, t.c) < .5 )
+	    continue ;
+	  z = project(&t, v) / ca + (width/2 + I*height/2) ;
+	  if( creal(z) < 0 || cimag(z) < 0 || creal(z) > width || cimag(z) > height )
+	    continue ;
+	  if( drand48() < .1 )
+	    continue ;
+	  /* insertion by magnitude */
+	  for(k = n++; k > 0 && mag[k-1] > idx->stars[i].mag; --k) {
+	    x[k] = x[k-1] ; y[k] = y[k-1] ; mag[k] = mag[k-1] ;
+	  }
+	  x[k] = creal(z) + drand48() - .5 ;
+	  y[k] = cimag(z) + drand48() - .5 ;
+	  mag[k] = idx->stars[i].mag + 300. * (drand48() - .5) ;
+	}
+	for(i=0; i < 5 && n < 200; ++i) {	/* spurious, anywhere */
+	  int k = lrand48() % (n+1) ;
+	  memmove(x+k+1, x+k, (n-k)*sizeof(*x)) ;
+	  memmove(y+k+1, y+k, (n-k)*sizeof(*y)) ;
+	  x[k] = width * drand48() ;
+	  y[k] = height * drand48() ;
+	  ++n ;
+	}
+	return n ;
+}
+
+int
+main(int argc, char **argv)
+{
+	PlateIndex idx ;
+	PlateSolution sol ;
+	double	x[200], y[200] ;
+	double	t0 ;
+	int	n, i, ok ;
+
+	if( argc > 1 && strcmp(argv[1], "-b") == 0 )
+	{
+	  StarCatalog cat ;
+	  float	maxmag = 6.5 ;
+	  double smin = 4., smax = 20. ;
+	  argc -= 2 ; argv += 2 ;
+	  for(; argc > 2 && **argv == '-'; --argc, ++argv)
+	    if( strcmp(*argv, "-m") == 0 )
+	      --argc, maxmag = atof(*++argv) ;
+	    else if( strcmp(*argv, "-s") == 0 )
+	      --argc, sscanf(*++argv, "%lf,%lf", &smin, &smax) ;
+	  if( argc != 2 ) {
+	    fputs(usage, stderr) ;
+	    exit(2) ;
+	  }
+	  if( StarCatalogOpen(argv[0], &cat) < 0 )
+	    exit(1) ;
+	  t0 = now() ;
+	  if( PlateIndexBuild(&cat, maxmag, smin, smax, &idx) < 0 ) {
+	    fprintf(stderr, "out of memory\n") ;
+	    exit(1) ;
+	  }
+	  fprintf(stderr, "%d stars, %d quads, built in %.2f s\n",
+		idx.nstars, idx.nquads, now()-t0) ;
+	  exit(PlateIndexWrite(&idx, argv[1]) < 0) ;
+	}
+
+	if( argc > 1 && strcmp(argv[1], "-t") == 0 )
+	{
+	  StarCatalog cat ;
+	  int	nt = argc > 2 ? atoi(argv[2]) : 20, solved = 0 ;
+	  double tmax = 0., ttot = 0., derr = 0. ;
+
+	  /* a synthetic bright star catalog, Yale-sized */
+	  srand48(1) ;
+	  memset(&cat, 0, sizeof(cat)) ;
+	  for(i=0; i < 9100; ++i) {
+	    Star s ;
+	    CompactStar c ;
+	    memset(&s, 0, sizeof(s)) ;
+	    s.ra = 360. * drand48() ;
+	    s.dec = asind(2.*drand48() - 1.) ;
+	    s.mag = 6.5 + log10(drand48() + 1e-9) * 2.5 ;
+	    s.epoch = 2000 ;
+	    compactStar(&s, &c) ;
+	    StarCatalogAdd(&cat, &c, 0, NULL) ;
+	  }
+	  t0 = now() ;
+	  if( PlateIndexBuild(&cat, 6.5, 4., 20., &idx) < 0 ) {
+	    fprintf(stderr, "out of memory\n") ;
+	    exit(1) ;
+	  }
+	  printf("%d stars, %d quads, built in %.2f s\n",
+		idx.nstars, idx.nquads, now()-t0) ;
+
+	  for(i=0; i < nt; ++i)
+	  {
+	    double ra = 360.*drand48(), dec = asind(2.*drand48() - 1.) ;
+	    double rot = 360.*drand48(), t ;
+	    n = simulate(&idx, ra, dec, 40., rot, 3000., 2000., x, y) ;
+	    t0 = now() ;
+	    ok = PlateSolve(&idx, x, y, n, 3000., 2000., &sol) ;
+	    t = now() - t0 ;
+	    ttot += t ;
+	    if( t > tmax ) tmax = t ;
+	    if( ok > 0 ) {
+	      double d = acosd(fmin(1., sind(dec)*sind(sol.dec) +
+			cosd(dec)*cosd(sol.dec)*cosd(ra-sol.ra))) * 3600. ;
+	      ++solved ;
+	      if( d > derr ) derr = d ;
+	    }
+	    printf("%8.3f %+8.3f rot %6.2f, %3d stars: ", ra, dec, rot, n) ;
+	    printSolution(ok, &sol) ;
+	  }
+	  printf("%d/%d solved, worst centre error %.1f\", "
+		"mean %.1f ms, worst %.1f ms\n",
+		solved, nt, derr, ttot/nt*1e3, tmax*1e3) ;
+	  FreePlateIndex(&idx) ;
+	  FreeStarCatalog(&cat) ;
+	  exit(0) ;
+	}
+
+	if( argc != 4 ) {
+	  fputs(usage, stderr) ;
+	  exit(2) ;
+	}
+	if( PlateIndexOpen(argv[1], &idx) < 0 )
+	  exit(1) ;
+	for(n = 0; n < 200 && scanf("%lf %lf", &x[n], &y[n]) == 2; ++n) ;
+	t0 = now() ;
+	ok = PlateSolve(&idx, x, y, n, atof(argv[2]), atof(argv[3]), &sol) ;
+	printSolution(ok, &sol) ;
+	fprintf(stderr, "%.1f ms\n", (now()-t0)*1e3) ;
+	FreePlateIndex(&idx) ;
+	exit(ok > 0 ? 0 : 1) ;
+}
+#endif	/* STANDALONE */
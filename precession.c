@@ -29,6 +29,10 @@
  *	Accepts declination and right ascension for one date, and
  *	returns declination and right ascension for another date.
  *
+ * precessionMatrix(double jdate0, jdate1, double m[3][3])
+ *	Rotation matrix taking unit vectors for one equinox to another,
+ *	for precessing many points at once.
+ *
  * nutation(double *psi, *eps, double jdate)
  *	Given a julian date, return the nutation in longitude and
  *	nutation in obliquity.  I have no idea what these really
@@ -118,6 +122,29 @@ precession(decl0,RA0, jdate0, decl1,RA1, jdate1)
 	*RA1 *= DEG*24/360 ;
 }
 
+/**
+ * Rotation matrix m such that v1 = m v0 takes an equatorial unit
+ * vector (x towards the equinox, z towards the pole) for the equinox
+ * of jdate0 to the equinox of jdate1.  The columns are the images of
+ * the three axes under precessionRad().
+ */
+void
+precessionMatrix(double jdate0, double jdate1, double m[3][3])
+{
+	static const double axes[3][2] = {	/* decl, RA in radians */
+		{ 0., 0. }, { 0., M_PI/2. }, { M_PI/2., 0. } } ;
+	double	d, r ;
+	int	j ;
+
+	for(j=0; j < 3; ++j) {
+	  precessionRad(axes[j][0], axes[j][1], jdate0, &d, &r, jdate1) ;
+	  m[0][j] = cos(d) * cos(r) ;
+	  m[1][j] = cos(d) * sin(r) ;
+	  m[2][j] = sin(d) ;
+	}
+}
+
+
 #if HIGH_PRECISION
 /* Table 22.A from [2]; units are .0001".  Coefficients smaller than
  * 0.0003" have been omitted.
@@ -206,7 +233,7 @@ static const NutationCoeffs nutationCoeffs[] = {
  *
  * @param psi    Returned nutation in longitude, arcseconds
  * @param eps    Returned nutation of obliquity of the eliptic, arcseconds
- * @param jdate  Julian day
+ * @param jdate  Julian ephemeris day (TT); see convertTime()
  */
 void
 nutation(double *psi, double *eps, double jdate)
@@ -218,8 +245,6 @@ nutation(double *psi, double *eps, double jdate)
 	double	F;		/* Moon's argument of longitude */
 	double	om;		/* Longitude of ascending node of the moon */
 
-	/* TODO: convert JD to JDE */
-
 	T = (jdate - JD2000)/36525.; T2 = T*T; T3 = T2*T;
 	D = limitAngle(297.85036 + 445267.111480*T - 0.0019142*T2 + T3/189474);
 	M = limitAngle(357.52772 + 35999.050340*T - 0.0001603*T2 - T3/300000);
@@ -0,0 +1,568 @@
+	/* What is above the horizon */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * The part of the sky above an observer's horizon is a cap in
+ * equatorial coordinates, centered on the zenith: RA = local sidereal
+ * time, dec = latitude.  Rather than convert every star in the
+ * catalog and throw away the half below the horizon, we work out the
+ * RA extent of the cap in each declination zone of the catalog index
+ * and only read those cells, and within each cell only the stars
+ * bright enough.  The survivors are converted to azimuth and
+ * altitude in blocks.
+ *
+ * int
+ * StarCatalogVisible(const StarCatalog *cat, double jd,
+ *		double lat, double lon, float maxmag, double minalt,
+ *		int *idx, double *az, double *alt)
+ *	Find all stars above the horizon.
+ *
+ * Rising and setting are found the other way round: instead of
+ * stepping through time, the hour angle at which a star crosses the
+ * horizon follows from its declination and the latitude alone,
+ *
+ *	cos H0 = (sin h0 - sin lat sin dec) / (cos lat cos dec)
+ *
+ * and the time of transit from its right ascension and the sidereal
+ * time.  The inner loop over the stars has no branches and a
+ * polynomial arc cosine, so that it can be vectorized.
+ *
+ * double
+ * riseAltitude(double height)
+ *	Altitude of a star at rising and setting, allowing for
+ *	refraction and the dip of the horizon.
+ *
+ * void
+ * riseTransitSet(int n, const double *ra, const double *dec,
+ *		const Site *site, double jd, float *rise, float *transit,
+ *		float *set, uint8_t *flags)
+ *	Next rising, transit and setting of a list of stars.
+ *
+ * int
+ * StarCatalogRiseSet(const StarCatalog *cat, const Site *sites,
+ *		int nsites, double jd, int nthreads, float *rise,
+ *		float *transit, float *set, uint8_t *flags)
+ *	The same for a whole catalog at many sites.
+ */
+
+#define	SIDEREAL_DAY	0.99726956633	/* days */
+#define	ROUNDER		6755399441055744.	/* 1.5 * 2^52, rounds to integer */
+
+
+/**
+ * Half-width in RA, degrees, of a cap of radius rho around dec0 at
+ * declination dec.  180 if the whole circle of declination is in
+ * the cap, -1 if none of it is.
+ */
+static double
+capWidth(double dec0, double rho, double dec)
+{
+	double	den = cosd(dec) * cosd(dec0) ;
+	double	c ;
+
+	if( fabs(dec - dec0) > rho )
+	  return -1. ;
+	if( den < 1e-12 )
+	  return 180. ;			/* pole, or observer at a pole */
+	c = (cosd(rho) - sind(dec) * sind(dec0)) / den ;
+	return c <= -1. ? 180. : c >= 1. ? 0. : acosd(c) ;
+}
+
+/**
+ * Widest RA extent of the cap anywhere in the band d0..d1.  The
+ * width peaks at asin(sin(dec0)/cos(rho)), so it is enough to look
+ * there and at the two edges.
+ */
+static double
+bandWidth(double dec0, double rho, double d0, double d1)
+{
+	double	w = capWidth(dec0, rho, d0), w1 ;
+	double	s ;
+
+	if( (w1 = capWidth(dec0, rho, d1)) > w )
+	  w = w1 ;
+	if( (s = cosd(rho)) > 0. && fabs(sind(dec0) / s) <= 1. )
+	{
+	  double dm = asind(sind(dec0) / s) ;
+	  if( dm > d0 && dm < d1 && (w1 = capWidth(dec0, rho, dm)) > w )
+	    w = w1 ;
+	}
+	if( w < 0. && dec0 + rho >= d0 && dec0 - rho <= d1 )
+	  w = 0. ;			/* cap lies inside the band */
+	return w ;
+}
+
+
+typedef struct {
+	  const StarCatalog *cat ;
+	  double lst ;			/* local sidereal time, degrees */
+	  double sinlat, coslat ;
+	  double sinmin ;		/* sin(minalt) */
+	  int	*idx ;
+	  double *az, *alt ;
+	  int	count ;
+	  int	block[STAR_BLOCK] ;	/* candidates awaiting conversion */
+	  int	nb ;
+	} SkyQuery ;
+
+/**
+ * Convert the candidates in the block to horizon coordinates and
+ * keep the ones above minalt.  Same conventions as equat2bearings():
+ * azimuth is measured westward from south.
+ */
+static void
+flushBlock(SkyQuery *q)
+{
+	double	ha[STAR_BLOCK], dec[STAR_BLOCK] ;
+	int	i, k ;
+
+	for(i=0; i < q->nb; ++i) {
+	  const CompactStar *c = &q->cat->stars[q->block[i]] ;
+	  ha[i] = (q->lst - c->ra / CU_PER_DEG) * RAD ;
+	  dec[i] = c->dec / CU_PER_DEG * RAD ;
+	}
+	for(i=0; i < q->nb; ++i)
+	{
+	  double sd = sin(dec[i]), cd = cos(dec[i]) ;
+	  double sh = sin(ha[i]), ch = cos(ha[i]) ;
+	  double salt = q->sinlat*sd + q->coslat*cd*ch ;
+	  if( salt < q->sinmin )
+	    continue ;
+	  k = q->count++ ;
+	  q->idx[k] = q->block[i] ;
+	  if( q->alt != NULL )
+	    q->alt[k] = asin(salt) * DEG ;
+	  if( q->az != NULL )
+	    q->az[k] = atan2(cd*sh, cd*ch*q->sinlat - sd*q->coslat) * DEG ;
+	}
+	q->nb = 0 ;
+}
+
+static void
+addStar(SkyQuery *q, int i)
+{
+	q->block[q->nb++] = i ;
+	if( q->nb == STAR_BLOCK )
+	  flushBlock(q) ;
+}
+
+/**
+ * Scan cells c0..c1 of the index, brightest first, stopping each
+ * cell at the first star fainter than mag.
+ */
+static void
+scanCells(SkyQuery *q, int c0, int c1, int16_t mag)
+{
+	const StarCatalog *cat = q->cat ;
+	int	c, i ;
+
+	for(c = c0; c <= c1; ++c)
+	  for(i = cat->cells[c]; i < cat->cells[c+1]; ++i) {
+	    if( cat->stars[i].mag > mag )
+	      break ;
+	    addStar(q, i) ;
+	  }
+}
+
+
+/**
+ * Find all stars of magnitude maxmag or brighter that are above the
+ * horizon for an observer, and return their azimuth and altitude.
+ *
+ * @param jd       Julian date and time, UT
+ * @param lat,lon  observer's latitude and longitude, degrees; longitude
+ *		   is positive west, as for equat2bearings()
+ * @param minalt   lowest altitude to return, degrees; 0 for the
+ *		   geometric horizon, -0.57 to allow for refraction
+ * @param idx      returned catalog indices, room for cat->count
+ * @param az,alt   returned azimuth (westward from south, as for
+ *		   equat2bearings()) and altitude, degrees; either
+ *		   may be NULL
+ * @return number of stars returned
+ *
+ * Positions are used as stored, without precession.  If the catalog
+ * is indexed, only the cells under the sky are read and the stars are
+ * returned in cell order; otherwise every star is examined.
+ */
+int
+StarCatalogVisible(const StarCatalog *cat, double jd,
+	double lat, double lon, float maxmag, double minalt,
+	int *idx, double *az, double *alt)
+{
+	SkyQuery q ;
+	int16_t	mag = maxmag * 1000. >= 32767. ? 32767 : lround(maxmag * 1000.) ;
+	double	rho = 90. - minalt ;	/* cap radius */
+	int	z, i ;
+
+	q.cat = cat ;
+	q.lst = limitAngle(time2sidereal(jd) * 15. - lon) ;
+	q.sinlat = sind(lat) ;
+	q.coslat = cosd(lat) ;
+	q.sinmin = sind(minalt) ;
+	q.idx = idx ;
+	q.az = az ;
+	q.alt = alt ;
+	q.count = 0 ;
+	q.nb = 0 ;
+
+	if( cat->cells == NULL ) {
+	  for(i=0; i < cat->count; ++i)
+	    if( cat->stars[i].mag <= mag )
+	      addStar(&q, i) ;
+	  flushBlock(&q) ;
+	  return q.count ;
+	}
+
+	for(z=0; z < CAT_ZONES; ++z)
+	{
+	  double d0 = -90. + z * 180./CAT_ZONES, d1 = d0 + 180./CAT_ZONES ;
+	  int	first = cat->zones[z], n = cat->zones[z+1] - first ;
+	  double w = bandWidth(lat, rho, d0, d1) ;
+	  int	c0, c1, wrap ;
+
+	  if( w < 0. )
+	    continue ;
+	  w += 1e-6 ;
+	  if( w >= 180. ) {
+	    scanCells(&q, first, first+n-1, mag) ;
+	    continue ;
+	  }
+	  c0 = (int)floor(limitAngle(q.lst - w) / 360. * n) ;
+	  c1 = (int)floor(limitAngle(q.lst + w) / 360. * n) ;
+	  if( c0 >= n ) c0 = n-1 ;
+	  if( c1 >= n ) c1 = n-1 ;
+	  wrap = q.lst - w < 0. || q.lst + w >= 360. ;
+	  if( !wrap )
+	    scanCells(&q, first+c0, first+c1, mag) ;
+	  else if( c0 <= c1 )		/* ends meet in one cell */
+	    scanCells(&q, first, first+n-1, mag) ;
+	  else {
+	    scanCells(&q, first+c0, first+n-1, mag) ;
+	    scanCells(&q, first, first+c1, mag) ;
+	  }
+	}
+	flushBlock(&q) ;
+	return q.count ;
+}
+
+
+/**
+ * Altitude of a star's centre when it rises or sets, degrees, for an
+ * observer height metres above sea level: 34' of refraction at the
+ * horizon, scaled by the air pressure of a standard atmosphere, and
+ * the dip of a sea horizon, 1.76' sqrt(height).  Use -34./60. for
+ * an observer whose horizon is hills rather than sea.
+ */
+double
+riseAltitude(double height)
+{
+	if( height <= 0. )
+	  return -34./60. ;
+	return -34./60. * exp(-height / 8435.) - 1.76/60. * sqrt(height) ;
+}
+
+/**
+ * The inner loop, for up to STAR_BLOCK stars.  lst is the local
+ * sidereal time at jd, degrees; sd, cd the sine and cosine of the
+ * declinations.  The first loop does the arithmetic without branches
+ * or calls (gcc vectorizes it given -O3 -fno-math-errno
+ * -fno-trapping-math); the second, cheap one sets the flags.
+ */
+static void
+rtsKernel(int n, const double *ra, const double *sd, const double *cd,
+	double lst, double sinh0, double sinlat, double coslat,
+	float *rise, float *transit, float *set, uint8_t *flags)
+{
+	double	cosh0[STAR_BLOCK] ;
+	int	i ;
+
+	for(i=0; i < n; ++i)
+	{
+	  double x = (ra[i] - lst) / 360. ;
+	  double t, c, h, r, s ;
+
+	  x -= (x + ROUNDER) - ROUNDER ;	/* fraction, -.5 .. .5 */
+	  x += x < 0. ;
+	  t = x * SIDEREAL_DAY ;
+	  c = (sinh0 - sinlat * sd[i]) / (coslat * cd[i]) ;
+	  cosh0[i] = c ;
+	  c = c < -1. ? -1. : c > 1. ? 1. : c ;
+	  h = acosPoly(c) * (SIDEREAL_DAY / (2.*M_PI)) ;
+	  r = t - h ;
+	  r += (r < 0.) * SIDEREAL_DAY ;
+	  s = t + h ;
+	  s -= (s >= SIDEREAL_DAY) * SIDEREAL_DAY ;
+	  transit[i] = t ;
+	  rise[i] = r ;
+	  set[i] = s ;
+	}
+
+	for(i=0; i < n; ++i) {
+	  flags[i] = (cosh0[i] < -1.) * RTS_CIRCUMPOLAR |
+		(cosh0[i] > 1.) * RTS_NEVER_RISES ;
+	  if( flags[i] != 0 )
+	    rise[i] = set[i] = NAN ;
+	}
+}
+
+
+/**
+ * Find the next rising, upper transit and setting of n stars after
+ * time jd, for one site.  Times are returned in days after jd, all
+ * less than one sidereal day.  Stars that never set or never rise
+ * are flagged RTS_CIRCUMPOLAR or RTS_NEVER_RISES, and their rise and
+ * set times are NaN.
+ *
+ * @param ra,dec  positions for the equinox of date, degrees
+ * @param site    observer; the horizon is at riseAltitude(site->height)
+ * @param jd      start time, UT
+ */
+void
+riseTransitSet(int n, const double *ra, const double *dec,
+	const Site *site, double jd, float *rise, float *transit,
+	float *set, uint8_t *flags)
+{
+	double	sd[STAR_BLOCK], cd[STAR_BLOCK] ;
+	double	lst = time2sidereal(jd) * 15. - site->lon ;
+	double	sinh0 = sind(riseAltitude(site->height)) ;
+	int	i, j, nb ;
+
+	for(i=0; i < n; i += nb)
+	{
+	  nb = n - i < STAR_BLOCK ? n - i : STAR_BLOCK ;
+	  for(j=0; j < nb; ++j) {
+	    sd[j] = sind(dec[i+j]) ;
+	    cd[j] = cosd(dec[i+j]) ;
+	  }
+	  rtsKernel(nb, ra+i, sd, cd, lst, sinh0, sind(site->lat),
+		cosd(site->lat), rise+i, transit+i, set+i, flags+i) ;
+	}
+}
+
+
+#define	RTS_BLOCK	(256*STAR_BLOCK)	/* stars per work item */
+
+typedef struct {
+	  const StarCatalog *cat ;
+	  const Site *sites ;
+	  double jd ;
+	  double m[3][3] ;		/* precession to date */
+	  double *ra, *sd, *cd ;	/* catalog, of date */
+	  int	nblocks ;
+	  float	*rise, *transit, *set ;
+	  uint8_t *flags ;
+	} RtsJob ;
+
+/**
+ * Bring one block of the catalog to the equinox of date.
+ */
+static int
+rtsPrepare(TextChunk *chunk, void *arg)
+{
+	RtsJob	*job = arg ;
+	int	i0 = chunk->index * RTS_BLOCK ;
+	int	i1 = i0 + RTS_BLOCK < job->cat->count ? i0 + RTS_BLOCK : job->cat->count ;
+	int	i ;
+
+	for(i = i0; i < i1; ++i)
+	{
+	  const CompactStar *c = &job->cat->stars[i] ;
+	  double ra = c->ra / CU_PER_DEG * RAD, dec = c->dec / CU_PER_DEG * RAD ;
+	  double v[3], w[3] ;
+	  int	k ;
+	  v[0] = cos(dec) * cos(ra) ;
+	  v[1] = cos(dec) * sin(ra) ;
+	  v[2] = sin(dec) ;
+	  for(k=0; k < 3; ++k)
+	    w[k] = job->m[k][0]*v[0] + job->m[k][1]*v[1] + job->m[k][2]*v[2] ;
+	  job->ra[i] = atan2d(w[1], w[0]) ;
+	  job->sd[i] = w[2] ;
+	  job->cd[i] = sqrt(w[0]*w[0] + w[1]*w[1]) ;
+	}
+	return 0 ;
+}
+
+/**
+ * One block of the catalog for one site.
+ */
+static int
+rtsChunk(TextChunk *chunk, void *arg)
+{
+	const RtsJob *job = arg ;
+	const Site *site = &job->sites[chunk->index / job->nblocks] ;
+	double	lst = time2sidereal(job->jd) * 15. - site->lon ;
+	double	sinh0 = sind(riseAltitude(site->height)) ;
+	int	count = job->cat->count ;
+	int	i0 = (chunk->index % job->nblocks) * RTS_BLOCK ;
+	int	i1 = i0 + RTS_BLOCK < count ? i0 + RTS_BLOCK : count ;
+	size_t	off = (size_t)(chunk->index / job->nblocks) * count ;
+	int	i, nb ;
+
+	for(i = i0; i < i1; i += nb) {
+	  nb = i1 - i < STAR_BLOCK ? i1 - i : STAR_BLOCK ;
+	  rtsKernel(nb, job->ra + i, job->sd + i, job->cd + i, lst, sinh0,
+		sind(site->lat), cosd(site->lat), job->rise + off + i,
+		job->transit + off + i, job->set + off + i, job->flags + off + i) ;
+	}
+	return 0 ;
+}
+
+
+/**
+ * Rising, transit and setting of every star in a catalog, for each
+ * of a list of sites, as riseTransitSet().  Positions are precessed
+ * from J2000 to the date once for all the sites; proper motion is
+ * ignored.  The results are in site-major order: entry
+ * s*cat->count + i is star i at site s.
+ *
+ * @param nthreads  number of threads, 0 for numThreads()
+ * @param rise,transit,set,flags  room for nsites*cat->count entries
+ * @return 0, or -1 on error
+ */
+int
+StarCatalogRiseSet(const StarCatalog *cat, const Site *sites, int nsites,
+	double jd, int nthreads, float *rise, float *transit, float *set,
+	uint8_t *flags)
+{
+	RtsJob	job ;
+	TextChunk *chunks ;
+	int	n, i, rval ;
+
+	if( cat->count == 0 || nsites <= 0 )
+	  return 0 ;
+	job.cat = cat ;
+	job.sites = sites ;
+	job.jd = jd ;
+	job.rise = rise ;
+	job.transit = transit ;
+	job.set = set ;
+	job.flags = flags ;
+	job.nblocks = (cat->count + RTS_BLOCK - 1) / RTS_BLOCK ;
+	precessionMatrix(JD2000, jd, job.m) ;
+	if( (job.ra = malloc(cat->count * 3 * sizeof(double))) == NULL )
+	  return -1 ;
+	job.sd = job.ra + cat->count ;
+	job.cd = job.sd + cat->count ;
+
+	n = job.nblocks * nsites ;
+	if( (chunks = calloc(n, sizeof(*chunks))) == NULL ) {
+	  free(job.ra) ;
+	  return -1 ;
+	}
+	for(i=0; i < n; ++i)
+	  chunks[i].index = i ;
+
+	rval = runTextChunks(chunks, job.nblocks, nthreads, rtsPrepare, &job) ;
+	if( rval == 0 )
+	  rval = runTextChunks(chunks, n, nthreads, rtsChunk, &job) ;
+	free(chunks) ;
+	free(job.ra) ;
+	return rval ;
+}
+
+
+#ifdef STANDALONE
+
+/*
+ * Benchmark: rising and setting of a catalog, by default a synthetic
+ * one of 2.5 million stars, at one site and then at many.
+ */
+
+#include <time.h>
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+int
+main(int argc, char **argv)
+{
+	StarCatalog cat ;
+	Site	*sites ;
+	float	*rise, *transit, *set ;
+	uint8_t	*flags ;
+	int	nsites = argc > 2 ? atoi(argv[2]) : 16 ;
+	int	nthreads = argc > 3 ? atoi(argv[3]) : 0 ;
+	size_t	n ;
+	double	jd = jnow(), t0, t1, t2 ;
+	int	i, k, count[3] = {0, 0, 0} ;
+
+	memset(&cat, 0, sizeof(cat)) ;
+	if( argc > 1 && strcmp(argv[1], "-") != 0 ) {
+	  if( StarCatalogOpen(argv[1], &cat) < 0 )
+	    return 1 ;
+	}
+	else {
+	  srand48(1) ;
+	  for(i=0; i < 2500000; ++i) {
+	    Star s ;
+	    CompactStar c ;
+	    memset(&s, 0, sizeof(s)) ;
+	    s.ra = 360. * drand48() ;
+	    s.dec = asind(2.*drand48() - 1.) ;
+	    s.mag = 12.5 + log10(drand48() + 1e-9) * 2.5 ;
+	    s.epoch = 2000 ;
+	    compactStar(&s, &c) ;
+	    StarCatalogAdd(&cat, &c, 0, NULL) ;
+	  }
+	}
+
+	if( nsites < 1 ) {
+	  fprintf(stderr, "sky: nsites must be at least 1\n") ;
+	  return 1 ;
+	}
+	if( (sites = malloc(nsites * sizeof(*sites))) == NULL ) {
+	  fprintf(stderr, "out of memory\n") ;
+	  return 1 ;
+	}
+	for(i=0; i < nsites; ++i) {
+	  sites[i].lat = -60. + 120. * i / (nsites > 1 ? nsites-1 : 1) ;
+	  sites[i].lon = 360. * i / nsites ;
+	  sites[i].height = 100. * i ;
+	}
+	n = (size_t)cat.count * nsites ;
+	rise = malloc(n * sizeof(float)) ;
+	transit = malloc(n * sizeof(float)) ;
+	set = malloc(n * sizeof(float)) ;
+	flags = malloc(n) ;
+	if( rise == NULL || transit == NULL || set == NULL || flags == NULL ) {
+	  fprintf(stderr, "out of memory\n") ;
+	  return 1 ;
+	}
+	memset(flags, 0, n) ;		/* fault the pages in */
+	memset(rise, 0, n * sizeof(float)) ;
+	memset(transit, 0, n * sizeof(float)) ;
+	memset(set, 0, n * sizeof(float)) ;
+
+	t0 = now() ;
+	StarCatalogRiseSet(&cat, sites, 1, jd, nthreads, rise, transit, set, flags) ;
+	t1 = now() ;
+	StarCatalogRiseSet(&cat, sites, nsites, jd, nthreads, rise, transit, set,
+		flags) ;
+	t2 = now() ;
+
+	for(k=0; k < nsites; ++k) {
+	  count[0] = count[1] = count[2] = 0 ;
+	  for(i=0; i < cat.count; ++i)
+	    ++count[flags[(size_t)k*cat.count + i]] ;
+	  printf("lat %5.1f: %d rise and set, %d circumpolar, %d never rise\n",
+		sites[k].lat, count[0], count[RTS_CIRCUMPOLAR],
+		count[RTS_NEVER_RISES]) ;
+	}
+	printf("%d stars: 1 site %.1f ms, %d sites %.1f ms, %.1f ns per star per site\n",
+		cat.count, (t1-t0)*1e3, nsites, (t2-t1)*1e3,
+		((t2-t1) - (t1-t0)) / ((double)cat.count * (nsites-1 > 0 ? nsites-1 : 1)) * 1e9) ;
+	return 0 ;
+}
+#endif	/* STANDALONE */
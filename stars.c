@@ -7,6 +7,7 @@ static const char rcsid[] = "$Id: stars.c,v 1.2 2009-08-12 15:37:26 falk Exp $"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <sys/types.h>
 
@@ -18,6 +19,8 @@ static const char rcsid[] = "$Id: stars.c,v 1.2 2009-08-12 15:37:26 falk Exp $"
 
 #define	MAX24	((1<<24)-1)	/* max 24-bit # */
 
+#define	PPMRECSIZE	19	/* bytes per catalog record */
+
 
 /* 
  *   PPM (Positions & Proper Motion) catalog:
@@ -68,125 +71,256 @@ static const char rcsid[] = "$Id: stars.c,v 1.2 2009-08-12 15:37:26 falk Exp $"
 #define	ppm2ra(x)	((((x)/64)*10125)/2048)
 #define	dec2ppm(d)	(((((d)+324000)/45)*0x40000)/225)
 
+/**
+ * Seek the catalog to the first record at or before declination d0.
+ * If minimum declination is much more than -90, it is worthwhile
+ * to execute a search for the first declination.  There are more
+ * effecient methods than binary search, but binary search is simpler
+ * and safer.
+ */
+static void
+ppmSeek(FILE *ifile, long d0)
+{
+	unsigned char	buf[PPMRECSIZE] ;
+	long	rec0,rec1,rec ;
+	u_long id, target = dec2ppm(d0) ;
+
+	if( d0 <= -80 *60*60 )
+	  return ;
+
+	rec0 = 0 ;
+	fseek(ifile, 0L, 2) ;
+	rec1 = ftell(ifile) / sizeof(buf) - 1 ;
+	while( rec0 < rec1 )
+	{
+	  rec = (rec0+rec1)/2 ;
+	  if( fseek(ifile, rec*sizeof(buf), 0) == -1 )
+	    rec0 = rec1 = -1 ;
+	  else if( fread(buf, sizeof(buf), 1, ifile) != 1 )
+	    rec0 = rec1 = -1 ;
+	  else
+	  {
+	    id = buf[9]<<16 | buf[10]<<8 | buf[11] ;
+	    if( id >= target )
+	      rec1 = rec - 1 ;
+	    else
+	      rec0 = rec + 1 ;
+	  }
+	}
+	if( rec1 >= 0 )
+	  fseek(ifile, rec1*sizeof(buf), 0) ;
+	else
+	  rewind(ifile) ;
+}
+
+
+/**
+ * Decode one catalog record into *star, with proper motion applied
+ * for the given number of years.  Returns nonzero if the star passes
+ * the magnitude and position filter.
+ */
+static int
+ppmDecode(const unsigned char *buf, double years, int maxmag,
+	long ra0, long ra1, long d0, long d1, int wrap, PPMStar *star)
+{
+	int	type ;
+	long	ra,dec, mag, pma, pmd ;
+
+	type = buf[0]>>6 ;
+
+	ra = ppm2ra(buf[6]<<16 | buf[7]<<8 | buf[8]) ;
+	dec = ppm2dec(buf[9]<<16 | buf[10]<<8 | buf[11]) ;
+	mag = buf[12]*10 - 200 ;
+	pma = (buf[15]<<8 | buf[16]) - 5000 ;		/* pma*10000 */
+	pmd = (buf[17]<<8 | buf[18]) - 10000 ;		/* pmd*1000 */
+
+	/* integrate proper motion, to the nearest arcsecond */
+	ra += lround(pma*years*15/10000.) ;
+	dec += lround(pmd*years/1000.) ;
+	if( ra < 0 )
+	  ra += 360*60*60 ;
+	else if( ra >= 360*60*60 )
+	  ra -= 360*60*60 ;
+
+	if( wrap && ra < ra0 )
+	  ra += 360*60*60 ;
+
+	if( mag > maxmag  ||
+	    dec < d0 || dec > d1 || ra < ra0 || ra > ra1 )
+	  return 0 ;
+
+	if( star != NULL ) {
+	  star->ra = ra ;
+	  star->dec = dec ;
+	  star->mag = mag ;
+	  star->type[0] = 'S' ;
+	  star->type[1] = type == 2 ? 'D' : 'S' ;
+	  star->spec[0] = buf[13] ;
+	  star->spec[1] = buf[14] ;
+	}
+	return 1 ;
+}
+
+
+/**
+ * Read the PPM catalog, passing matching stars to a callback one
+ * block at a time.  Memory use is bounded by STAR_BLOCK records
+ * no matter how many stars match.
+ *
+ * @param maxmag   maximum magnitude * 100
+ * @param ra0,ra1  right ascension bounds, seconds of arc
+ * @param d0,d1    declination bounds, seconds of arc
+ * @param jd       date for proper motion
+ * @param filename catalog filename, NULL defaults to "ppm.xe"
+ * @param visit    callback, see PPMStarVisitor in astro.h
+ * @param arg      passed through to visit
+ *
+ * @return number of stars passed to visit, or -1 if the file could
+ *	not be opened.
+ */
 int
-ReadPPMStars(maxmag, ra0,ra1, d0,d1, jd, filename,  rval)
-	int	maxmag ;
-	long	ra0,ra1, d0,d1 ;
-	double	jd ;
-	char	*filename ;
-	PPMStar	**rval ;
+VisitPPMStars(int maxmag, long ra0, long ra1, long d0, long d1,
+	double jd, char *filename, PPMStarVisitor visit, void *arg)
 {
-	unsigned char	buf[19] ;
+	unsigned char	buf[PPMRECSIZE] ;
+	PPMStar	block[STAR_BLOCK] ;
 	FILE	*ifile ;
-	int	type;
-	long	ra,dec, mag, pma, pmd ;
 	int	wrap ;
-	float	minmag = 100. ;
 	int	count = 0 ;
-	int	nalloc = 256 ;
-	int	n ;
-	int	years = (float)(jd-JD2000)/365.24 ;
-	PPMStar	*ptr ;
+	int	n = 0 ;
+	double	years = (jd-JD2000)/365.25 ;
 
 	if( filename == NULL )
 	  filename = "ppm.xe" ;
 
 	if( (ifile = fopen(filename, "r")) == NULL ) {
 	  perror(filename) ;
-	  return 0 ;
+	  return -1 ;
 	}
 
-	*rval = NULL ;
-	ptr = (PPMStar *)malloc(nalloc*sizeof(PPMStar)) ;
+	ppmSeek(ifile, d0) ;
 
-	if( ptr == NULL )
-	  return 0 ;
+	wrap = ra1 < ra0 ;
+	if( wrap )
+	  ra1 += 360*60*60 ;
 
-	n = 0 ;
+	while( fread(buf, sizeof(buf), 1, ifile) == 1 )
+	{
+	  if( !ppmDecode(buf, years, maxmag, ra0,ra1, d0,d1, wrap, &block[n]) )
+	    continue ;
+	  ++count ;
+	  if( ++n == STAR_BLOCK ) {
+	    n = 0 ;
+	    if( (*visit)(block, STAR_BLOCK, arg) )
+	      break ;
+	  }
+	}
+	if( n > 0 )
+	  (*visit)(block, n, arg) ;
 
-	/* if minimum declination is much more than -90, it is worthwhile
-	 * to execute a search for the first declination.  There are more
-	 * effecient methods than binary search, but binary search is simpler
-	 * and safer.
-	 */
+	fclose(ifile) ;
+	return count ;
+}
 
-	if( d0 > -80 *60*60 )
-	{
-	  long	rec0,rec1,rec ;
-	  u_long id, target = dec2ppm(d0) ;
 
-	  rec0 = 0 ;
-	  fseek(ifile, 0L, 2) ;
-	  rec1 = ftell(ifile) / sizeof(buf) - 1 ;
-	  while( rec0 < rec1 )
-	  {
-	    rec = (rec0+rec1)/2 ;
-	    if( fseek(ifile, rec*sizeof(buf), 0) == -1 )
-	      rec0 = rec1 = -1 ;
-	    else if( fread(buf, sizeof(buf), 1, ifile) != 1 )
-	      rec0 = rec1 = -1 ;
-	    else
-	    {
-	      id = buf[9]<<16 | buf[10]<<8 | buf[11] ;
-	      if( id >= target )
-		rec1 = rec - 1 ;
-	      else
-		rec0 = rec + 1 ;
-	    }
-	  }
-	  if( rec1 >= 0 )
-	    fseek(ifile, rec1*sizeof(buf), 0) ;
-	  else
-	    rewind(ifile) ;
+/**
+ * Count the stars that VisitPPMStars() would return, without
+ * keeping any of them.  Used to size an output array exactly.
+ *
+ * @return number of matching stars, or -1 on error.
+ */
+int
+CountPPMStars(int maxmag, long ra0, long ra1, long d0, long d1,
+	double jd, char *filename)
+{
+	unsigned char	buf[PPMRECSIZE] ;
+	FILE	*ifile ;
+	int	wrap ;
+	int	count = 0 ;
+	double	years = (jd-JD2000)/365.25 ;
+
+	if( filename == NULL )
+	  filename = "ppm.xe" ;
+
+	if( (ifile = fopen(filename, "r")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
 	}
 
+	ppmSeek(ifile, d0) ;
+
 	wrap = ra1 < ra0 ;
 	if( wrap )
 	  ra1 += 360*60*60 ;
 
 	while( fread(buf, sizeof(buf), 1, ifile) == 1 )
-	{
-	  type = buf[0]>>6 ;
+	  count += ppmDecode(buf, years, maxmag, ra0,ra1, d0,d1, wrap, NULL) ;
 
-	  ra = ppm2ra(buf[6]<<16 | buf[7]<<8 | buf[8]) ;
-	  dec = ppm2dec(buf[9]<<16 | buf[10]<<8 | buf[11]) ;
-	  mag = buf[12]*10 - 200 ;
-	  pma = (buf[15]<<8 | buf[16]) - 5000 ;		/* pma*10000 */
-	  pmd = (buf[17]<<8 | buf[18]) - 10000 ;	/* pmd*1000 */
+	fclose(ifile) ;
+	return count ;
+}
 
-	  /* integrate proper motion */
-	  ra += pma*years*15/10000 ;
-	  dec += pmd*years/1000 ;
 
-	  if( wrap && ra < ra0 )
-	    ra += 360*60*60 ;
+typedef struct {
+	  PPMStar *ptr ;
+	  int	count ;
+	  int	max ;
+	} PPMCollector ;
 
-	  if( mag <= maxmag  && 
-	      dec >= d0 && dec <= d1 && ra >= ra0 && ra <= ra1 )
-	  {
-	    if( mag < minmag ) minmag = mag ;
-	    if( count >= nalloc ) {
-	      nalloc *= 2 ;
-	      ptr = (PPMStar *)realloc(ptr, nalloc*sizeof(PPMStar)) ;
-	      if( ptr == NULL )
-		return 0 ;
-	    }
-	    ptr[count].ra = ra ;
-	    ptr[count].dec = dec ;
-	    ptr[count].mag = mag ;
-	    ptr[count].type[0] = 'S' ;
-	    ptr[count].type[1] = type == 2 ? 'D' : 'S' ;
-	    ptr[count].spec[0] = buf[13] ;
-	    ptr[count].spec[1] = buf[14] ;
-	    ++count ;
-	  }
+static int
+ppmCollect(const PPMStar *stars, int n, void *arg)
+{
+	PPMCollector *c = arg ;
+
+	if( n > c->max - c->count )
+	  n = c->max - c->count ;
+	memcpy(c->ptr + c->count, stars, n*sizeof(*stars)) ;
+	c->count += n ;
+	return c->count >= c->max ;
+}
+
+
+/**
+ * Read the PPM catalog into a malloc'ed array.  A quick counting
+ * pass is made first so that the array is allocated once, at its
+ * final size.
+ */
+int
+ReadPPMStars(maxmag, ra0,ra1, d0,d1, jd, filename,  rval)
+	int	maxmag ;
+	long	ra0,ra1, d0,d1 ;
+	double	jd ;
+	char	*filename ;
+	PPMStar	**rval ;
+{
+	PPMCollector c ;
+	int	minmag = 10000 ;
+	int	i ;
+
+	*rval = NULL ;
+
+	if( (c.max = CountPPMStars(maxmag, ra0,ra1, d0,d1, jd, filename)) < 0 )
+	  return 0 ;
+
+	c.ptr = (PPMStar *)malloc((c.max > 0 ? c.max : 1) * sizeof(PPMStar)) ;
+	c.count = 0 ;
+	if( c.ptr == NULL )
+	  return 0 ;
+
+	if( c.max > 0 &&
+	    VisitPPMStars(maxmag, ra0,ra1, d0,d1, jd, filename,
+		ppmCollect, &c) < 0 )
+	{
+	  free(c.ptr) ;
+	  return 0 ;
 	}
 
-	fprintf(stderr, "%d stars of magnitude %.1f to %.1f\n",
-		count, .01*minmag, .01*maxmag) ;
+	for(i=0; i < c.count; ++i)
+	  if( c.ptr[i].mag < minmag ) minmag = c.ptr[i].mag ;
 
-	fclose(ifile) ;
+	fprintf(stderr, "%d stars of magnitude %.1f to %.1f\n",
+		c.count, .01*minmag, .01*maxmag) ;
 
-	*rval = ptr ;
-	return count ;
+	*rval = c.ptr ;
+	return c.count ;
 }
@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <time.h>
 #include <math.h>
+#include <unistd.h>
 
 #include "astro.h"
 
@@ -39,6 +41,91 @@ main()
 	julian2date(2436116.81, &y, &m, &d);
 	printf("2436116.81 = %d-%d-%d\n", y, m, d);	/* Example [2]7.c */
 	printDate(2436116.81);
+
+	/* Across the Gregorian reform, scalar against array conversions */
+	{
+	    double jd[400], jd2[400], s[400];
+	    int ya[400], ma[400], da[400], ha[400], mna[400];
+	    int i, bad = 0;
+	    for (i=0; i < 400; ++i)
+		jd[i] = 2299160.5 - 200. + i * 1.01;
+	    julian2time_n(400, jd, ya, ma, da, ha, mna, s);
+	    for (i=0; i < 400; ++i) {
+		int y1, m1, d1, h1, mn1;
+		double s1;
+		julian2time(jd[i], &y1, &m1, &d1, &h1, &mn1, &s1);
+		bad += y1 != ya[i] || m1 != ma[i] || d1 != da[i] ||
+		    h1 != ha[i] || mn1 != mna[i] || s1 != s[i];
+		s[i] = da[i] + (ha[i] + mna[i]/60. + s[i]/3600.) / 24.;
+	    }
+	    date2julian_n(400, ya, ma, s, jd2);
+	    for (i=0; i < 400; ++i)
+		bad += jd2[i] != date2julian(ya[i], ma[i], s[i]) ||
+		    fabs(jd2[i] - jd[i]) > 1e-8;
+	    julian2date(2299160.5, &y, &m, &d);
+	    julian2date(2299159.5, &ya[0], &ma[0], &da[0]);
+	    printf("1582-10-15 = %.1f, 2299160.5 = %d-%d-%d, 2299159.5 = "
+		"%d-%d-%d, arrays %s\n", date2julian(1582, 10, 15), y, m, d,
+		ya[0], ma[0], da[0], bad == 0 &&
+		date2julian(1582, 10, 15) == 2299160.5 &&
+		date2julian(1582, 10, 4) == 2299159.5 && d == 15 && da[0] == 4 ?
+		"ok" : "wrong");
+	}
+
+	/* Split dates: nanoseconds survive the round trip */
+	{
+	    static const int64_t ns[2] = { 1700000000123456789LL, -1 };
+	    static const char *const iso[3] = {
+		"2023-11-14T22:13:20.123456789Z",
+		"2023-11-14 17:13:20.123456789-05:00", "2023-11-14T25:00" };
+	    SplitJD sj[3];
+	    double sec;
+	    int h, mn, bad;
+	    unixNs2splitJD_n(2, ns, sj);
+	    splitJD2time(&sj[0], &y, &m, &d, &h, &mn, &sec);
+	    printf("split: %d-%d-%d %d:%d:%.9f, ns %s", y, m, d, h, mn, sec,
+		splitJD2unixNs(&sj[0]) == ns[0] &&
+		splitJD2unixNs(&sj[1]) == ns[1] ? "ok" : "wrong");
+	    bad = iso2splitJD_n(3, iso, sj);
+	    printf(", iso %s", bad == 1 && isnan(sj[2].frac) &&
+		splitJD2unixNs(&sj[0]) == ns[0] &&
+		splitJD2unixNs(&sj[1]) == ns[0] ? "ok" : "wrong");
+	    printf(", sidereal %s\n", match(splitJD2sidereal(&sj[0]),
+		time2sidereal(joinJD(&sj[0])), 1e-8));
+	}
+
+	/* Bulk parsing, straight out of CSV fields */
+	{
+	    static const char line[] =
+		"2000-01-01T12:00:00Z,000101 120000,2000-01-01T13:00:00+01:00,"
+		"2023-02-29,2000-01-01X,-2000000-01-01,+1000000-12-31";
+	    const char *f[7];
+	    double jd[7];
+	    uint8_t err[7];
+	    int i, bad;
+	    for (i=0, f[0] = line; i < 6; ++i)
+		f[i+1] = strchr(f[i], ',') + 1;
+	    bad = parseJulian_n(7, f, jd, err);
+	    printf("parse: %d bad, errors %d %d %d %d %d %d %d (%s)\n", bad,
+		err[0], err[1], err[2], err[3], err[4], err[5], err[6],
+		bad == 3 && jd[0] == JD2000 && jd[1] == JD2000 && jd[2] == JD2000 &&
+		err[3] == TIME_RANGE && err[4] == TIME_SYNTAX && isnan(jd[4]) &&
+		err[5] == TIME_RANGE && isnan(jd[5]) && err[6] == 0 &&
+		jd[6] == date2julian(1000000, 12, 31) ? "ok" : "wrong");
+	}
+
+	/* Formatting into caller buffers, rounded with carries */
+	{
+	    static const double v[3] = { 12.5, -0.5, 359.999999 };
+	    char buf[FMT_BUFSIZE], buf2[FMT_BUFSIZE], out[3 * FMT_BUFSIZE];
+	    formatValues(3, v, FMT_DM, ' ', out);
+	    julian2str_r(JD2000 - 1e-7, buf);
+	    hours2hmsStr_r(-1.75, buf2);
+	    printf("format: %s, %s, %s (%s)\n", buf, buf2, out,
+		strcmp(buf, "1-Jan-2000 12:00:00") == 0 &&
+		strcmp(buf2, "-1:45:00.0") == 0 &&
+		strcmp(out, "12°30.00 -0°30.00 360°00.00") == 0 ? "ok" : "wrong");
+	}
 	putchar('\n');
 
 	date = time2julian(1992, 10, 13, 0,0,0.);
@@ -174,6 +261,920 @@ main()
 	Moon(date, &p) ;
 	printf("Moon @ %f = %f,%f,%f, par=%f\n",
 		date, p.lat,p.lon,p.R, p.ad) ;
+	putchar('\n');
+
+	/* Compact star records */
+	{
+	    Star s = { 101.287155, -16.716116, -1.46, 2000,
+			-0.546, -1.223, "SS", "A", 151881, NULL };
+	    Star s2;
+	    CompactStar c;
+	    compactStar(&s, &c);
+	    expandStar(&c, &s2);
+	    printf("CompactStar: %d bytes, ra=%lf (%s), dec=%lf (%s), "
+		"mag=%lf (%s), pmd=%lf (%s)\n", (int)sizeof(c),
+		s2.ra, match(s2.ra, s.ra, 1e-6),
+		s2.dec, match(s2.dec, s.dec, 1e-6),
+		s2.mag, match(s2.mag, s.mag, .0005),
+		s2.pmd, match(s2.pmd, s.pmd, .0005));
+	}
+
+	/* Barnard's star, 100 years of proper motion */
+	{
+	    double ra = 269.454022, dec = 4.668288;
+	    double pmr = -0.79838, pmd = 10.32812;
+	    propagateStars(1, &ra, &dec, &pmr, &pmd, NULL, NULL, 100.,
+		&ra, &dec);
+	    printf("Barnard's star 2100: ra=%lf (%s), dec=%lf (%s)\n",
+		ra, match(ra, 269.431781, .0001),
+		dec, match(dec, 4.955180, .0001));
+	}
+
+	/* Cross-match: a true pair, one just outside 2", one across RA 0 */
+	{
+	    static const double bpos[4][2] = {
+		{ 10., 20. }, { 359.9997, 5. }, { 100., -30. },
+		{ 10., 20. + 1.5/3600. } };
+	    double apos[3][2];
+	    StarCatalog a, b;
+	    StarMatch *pairs;
+	    CompactStar c;
+	    int	best[3], i, n, np;
+	    double sep[3];
+
+	    apos[0][0] = 10. + .5/3600. / cos(20. * M_PI/180.);
+	    apos[0][1] = 20.;
+	    apos[1][0] = 100.;
+	    apos[1][1] = -30. + 2.1/3600.;
+	    apos[2][0] = .0002;		/* 1.79" from b #2 */
+	    apos[2][1] = 5.;
+	    memset(&a, 0, sizeof(a));
+	    memset(&b, 0, sizeof(b));
+	    memset(&c, 0, sizeof(c));
+	    c.epoch = 100;
+	    for (i=0; i < 4; ++i) {
+		c.ra = llround(bpos[i][0] * CU_PER_DEG);
+		c.dec = lround(bpos[i][1] * CU_PER_DEG);
+		c.cat = i+1;
+		StarCatalogAdd(&b, &c, 0, NULL);
+	    }
+	    for (i=0; i < 3; ++i) {
+		c.ra = llround(apos[i][0] * CU_PER_DEG);
+		c.dec = lround(apos[i][1] * CU_PER_DEG);
+		c.cat = i+1;
+		StarCatalogAdd(&a, &c, 0, NULL);
+	    }
+	    StarCatalogIndex(&b);
+	    n = StarCatalogMatch(&a, &b, 2., 2, best, sep);
+	    np = StarCatalogMatchAll(&a, &b, 2., 2, &pairs);
+	    printf("cross-match: %d (%s), sep %s, outside (%s), wrap %s",
+		n, n == 2 ? "ok" : "wrong", match(sep[0], .5, .01),
+		best[1] < 0 ? "ok" : "wrong",
+		match(best[2] >= 0 ? sep[2] : 0., .0005 * cos(5. * M_PI/180.) * 3600., .01));
+	    printf(", all %d (%s)\n", np, np == 3 &&
+		b.stars[best[0]].cat == 1 && b.stars[best[2]].cat == 2 &&
+		pairs[0].a == 0 && b.stars[pairs[0].b].cat == 1 &&
+		b.stars[pairs[1].b].cat == 4 && pairs[2].a == 2 ? "ok" : "wrong");
+	    free(pairs);
+	    FreeStarCatalog(&a);
+	    FreeStarCatalog(&b);
+	}
+
+	/* Selecting on 2100 positions: Barnard's star moves into the box */
+	{
+	    static Star stars[] = {
+		{ 269.454022, 4.668288, 9.5, 2000, -0.79838,10.32812, "SS", "M", 0, "Barnard" },
+		{ 269.43, 4.95, 8.0, 2000, 0,0, "SS", "G", 0, "" },
+		{ 269.50, 4.70, 8.0, 2000, 0,0, "SS", "G", 0, "" },
+		{ 120.00, -40.00, 8.0, 2000, -5.,5., "SS", "G", 0, "" },
+	    };
+	    StarCatalog cat;
+	    CompactStar c;
+	    int	idx[4], i, n, n0;
+	    double ra[4], dec[4];
+
+	    memset(&cat, 0, sizeof(cat));
+	    for (i=0; i < 4; ++i) {
+		compactStar(&stars[i], &c);
+		StarCatalogAdd(&cat, &c, 0, stars[i].name);
+	    }
+	    StarCatalogIndex(&cat);
+	    n0 = StarCatalogSelectEpoch(&cat, JD2000, 10., 269.42, 269.44,
+		4.94, 4.96, idx, ra, dec);
+	    n = StarCatalogSelectEpoch(&cat, JD2000 + 36525., 10., 269.42, 269.44,
+		4.94, 4.96, idx, ra, dec);
+	    for (i=0; i < n; ++i)
+		if (cat.stars[idx[i]].mag == 9500)
+		    break;
+	    printf("in box 2000: %d (%s), 2100: %d, Barnard's star ra (%s) dec (%s)\n",
+		n0, n0 == 1 ? "ok" : "wrong", n,
+		match(i < n ? ra[i] : 0., 269.431781, .0001),
+		match(i < n ? dec[i] : 0., 4.955180, .0001));
+	    FreeStarCatalog(&cat);
+	}
+
+	/* A box from -10 to 20 degrees of ra is the one from 350 to 20 */
+	{
+	    StarCatalog cat;
+	    int *idx = malloc(5000 * sizeof(int)), i, n0, n1, n2, n3, n4, nb = 0;
+	    double *ra = malloc(5000 * sizeof(double)), *dec = malloc(5000 * sizeof(double));
+
+	    memset(&cat, 0, sizeof(cat));
+	    srand48(3);
+	    for (i=0; i < 5000; ++i) {
+		Star s;
+		CompactStar c;
+		memset(&s, 0, sizeof(s));
+		s.ra = 360. * drand48();
+		s.dec = 60. * drand48() - 30.;
+		s.mag = 8.;
+		s.epoch = 2000;
+		compactStar(&s, &c);
+		StarCatalogAdd(&cat, &c, 0, NULL);
+		nb += (s.ra >= 350. || s.ra <= 20.) && s.dec >= -10. && s.dec <= 10.;
+	    }
+	    n0 = StarCatalogSelect(&cat, 10., -10., 20., -10., 10., NULL);
+	    StarCatalogIndex(&cat);
+	    n1 = StarCatalogSelect(&cat, 10., -10., 20., -10., 10., NULL);
+	    n2 = StarCatalogSelect(&cat, 10., 350., 20., -10., 10., NULL);
+	    n3 = StarCatalogSelect(&cat, 10., 350., 380., -10., 10., NULL);
+	    n4 = StarCatalogSelectEpoch(&cat, JD2000, 10., -10., 20., -10., 10.,
+		idx, ra, dec);
+	    printf("box through 0h: %d %d %d %d %d of %d (%s)\n", n0, n1, n2, n3,
+		n4, nb, nb > 0 && n0 == nb && n1 == nb && n2 == nb && n3 == nb &&
+		n4 == nb ? "ok" : "wrong");
+	    free(idx);
+	    free(ra);
+	    free(dec);
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Name and number lookup */
+	{
+	    static Star stars[] = {
+		{ 101.287155, -16.716116, -1.46, 2000, 0,0, "SS", "A", 151881, "Sirius" },
+		{ 95.987958, -52.695661, -0.72, 2000, 0,0, "SS", "F", 234480, "Canopus" },
+		{ 213.915300, 19.182409, -0.04, 2000, 0,0, "SS", "K", 100944, "Arcturus" },
+		{ 279.234735, 38.783689, 0.03, 2000, 0,0, "SS", "A", 67174, "Vega" },
+		{ 114.825493, 5.224993, 0.34, 2000, 0,0, "SS", "F", 115456, "Procyon" },
+		{ 116.328958, 28.026199, 1.14, 2000, 0,0, "SS", "K", 79666, "Pollux" },
+	    };
+	    static int hr[] = { 2491, 2326, 5340, 7001, 2943, 2990 };
+	    StarCatalog cat;
+	    CompactStar c;
+	    int	idx[6], i, n;
+
+	    memset(&cat, 0, sizeof(cat));
+	    for (i=0; i < 6; ++i) {
+		compactStar(&stars[i], &c);
+		c.cat = hr[i];
+		StarCatalogAdd(&cat, &c, stars[i].sao, stars[i].name);
+	    }
+	    StarCatalogIndex(&cat);
+	    i = StarCatalogFind(&cat, 7001);
+	    printf("HR 7001 = %s (%s)", StarCatalogName(&cat, i),
+		strcmp(StarCatalogName(&cat, i), "Vega") == 0 ? "ok" : "wrong");
+	    i = StarCatalogFindSAO(&cat, 151881);
+	    printf(", SAO 151881 = %s (%s)", StarCatalogName(&cat, i),
+		strcmp(StarCatalogName(&cat, i), "Sirius") == 0 ? "ok" : "wrong");
+	    n = StarCatalogFindName(&cat, "p", idx, 6);
+	    printf(", \"p\" = %d: %s %s (%s)\n", n,
+		StarCatalogName(&cat, idx[0]), StarCatalogName(&cat, idx[1]),
+		n == 2 && strcmp(StarCatalogName(&cat, idx[0]), "Pollux") == 0 &&
+		StarCatalogFind(&cat, 9999) < 0 ? "ok" : "wrong");
+
+	    /* Boston, 2000-01-01 0h UT: Vega and Arcturus are up */
+	    {
+		double az[6], alt[6], A, H;
+		n = StarCatalogVisible(&cat, JD2000 - .5, 42.36, 71.06, 6.,
+			0., idx, az, alt);
+		for (i=0; i < n; ++i)
+		    if (cat.stars[idx[i]].cat == 7001)
+			break;
+		equat2bearings(stars[3].dec, stars[3].ra/15., 42.36, 71.06,
+			&A, &H, JD2000 - .5, 0.);
+		printf("visible from Boston: %d, Vega az=%lf (%s) alt=%lf (%s)\n",
+		    n, i < n ? az[i] : 0., match(i < n ? az[i] : 0., A, 1e-4),
+		    i < n ? alt[i] : 0., match(i < n ? alt[i] : 0., H, 1e-4));
+	    }
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Constellations: the built-in table, then the first rows of
+	 * Roman's table and a catch-all from a file */
+	{
+	    static const char table[] =
+		" 0.0000 24.0000  88.0000 UMi\n"
+		" 8.0000 14.5000  86.5000 UMi\n"
+		"21.0000 23.0000  86.1667 UMi\n"
+		"18.0000 21.0000  86.0000 UMi\n"
+		" 0.0000  8.0000  85.0000 Cep\n"
+		" 0.0000 24.0000 -90.0000 Oct\n";
+	    char fn[] = "/tmp/consXXXXXX";
+	    int fd = mkstemp(fn);
+	    FILE *f = fdopen(fd, "w");
+	    int c1, c2, c3, c4, c5;
+	    /* Sirius, Betelgeuse, and Acrux right on the Cru/Cen line */
+	    c3 = constellation(-16.716116, 101.287155/15., JD2000);
+	    c4 = constellation(7.407064, 88.792939/15., JD2000);
+	    c5 = constellation(-63.099093, 186.649563/15., JD2000);
+	    printf("built in: Sirius in %s, Betelgeuse in %s, Acrux in %s (%s)\n",
+		constellations[c3], constellations[c4], constellations[c5],
+		strcmp(constellations[c3], "CMa") == 0 &&
+		strcmp(constellations[c4], "Ori") == 0 &&
+		strcmp(constellations[c5], "Cru") == 0 ? "ok" : "wrong");
+	    fputs(table, f);
+	    fclose(f);
+	    LoadConstellationBounds(fn);
+	    unlink(fn);
+	    /* Polaris; and a point at 88.2 that was below 88 in 1875 */
+	    c1 = constellation(hms2h(89,15,51.), hms2h(2,31,49.09), JD2000);
+	    c2 = constellation(88.2, 1., JD2000);
+	    printf("Polaris in %s (%s), 1h +88.2 in %s (%s)\n",
+		constellations[c1], strcmp(constellations[c1], "UMi") == 0 ? "ok" : "wrong",
+		constellations[c2], strcmp(constellations[c2], "Cep") == 0 ? "ok" : "wrong");
+	    c3 = constellation(-16.716116, 101.287155/15., JD2000);
+	    LoadConstellationBounds(NULL);
+	    c4 = constellation(-16.716116, 101.287155/15., JD2000);
+	    printf("from file: Sirius in %s, built in again: %s (%s)\n",
+		constellations[c3], constellations[c4],
+		strcmp(constellations[c3], "Oct") == 0 &&
+		strcmp(constellations[c4], "CMa") == 0 ? "ok" : "wrong");
+	}
+
+	/* Bright Star Catalog: two records, one too faint, and a name note;
+	 * the constellation comes from the built-in table */
+	{
+	    static const char data[] =
+		" 372          BD+44  271   7647 37077    I                  "
+		"011115.6+442231011705.1+445407127.70-17.73 6.34R                     "
+		"K5                 +0.014-0.045      -052\n"
+		" 373          BD+44  271   7647 37078    I                  "
+		"011115.6+442231011805.1+445407127.70-17.73 7.50R                     "
+		"K5                 +0.014-0.045      -052\n";
+	    static const char notes[] = "  372 1N:   Test Star\n";
+	    char dfn[] = "/tmp/bscXXXXXX", nfn[] = "/tmp/bscXXXXXX";
+	    FILE *f;
+	    YaleCatalog yc;
+	    int n;
+	    f = fdopen(mkstemp(dfn), "w");
+	    fputs(data, f);
+	    fclose(f);
+	    f = fdopen(mkstemp(nfn), "w");
+	    fputs(notes, f);
+	    fclose(f);
+	    n = LoadYaleCatalog(7., 0., 360., -90., 90., dfn, nfn, &yc);
+	    unlink(dfn);
+	    unlink(nfn);
+	    printf("Yale: %d stars (%s), HR %d ra=%lf (%s) dec=%lf (%s) mag %s, "
+		"SAO %ld, \"%s\" in %.3s (%s)\n",
+		n, n == 1 ? "ok" : "wrong", n > 0 ? yc.stars[0].yale_cat : 0,
+		n > 0 ? yc.stars[0].s.ra : 0., match(n > 0 ? yc.stars[0].s.ra : 0., 19.27125, 1e-6),
+		n > 0 ? yc.stars[0].s.dec : 0., match(n > 0 ? yc.stars[0].s.dec : 0., 44.901944, 1e-6),
+		match(n > 0 ? yc.stars[0].s.mag : 0., 6.34, 1e-6),
+		n > 0 ? yc.stars[0].s.sao : 0L,
+		n > 0 && yc.stars[0].s.name != NULL ? yc.stars[0].s.name : "",
+		n > 0 ? yc.stars[0].cons : "",
+		n > 0 && yc.stars[0].yale_cat == 372 &&
+		memcmp(yc.stars[0].cons, "And", 3) == 0 && yc.stars[0].s.sao == 37077 &&
+		yc.stars[0].s.name != NULL &&
+		strcmp(yc.stars[0].s.name, "Test Star") == 0 ? "ok" : "wrong");
+	    if (n >= 0)
+		FreeYaleCatalog(&yc);
+	}
+
+	/* The threaded Yale loader against the serial one, on files long
+	 * enough to be cut into several chunks, mid-record */
+	{
+	    static const char rec[] =
+		" 372          BD+44  271   7647 37077    I                  "
+		"011115.6+442231011705.1+445407127.70-17.73 6.34R                     "
+		"K5                 +0.014-0.045      -052";
+	    char dfn[] = "/tmp/bscXXXXXX", nfn[] = "/tmp/bscXXXXXX";
+	    char line[sizeof(rec) + 8];
+	    FILE *df, *nf;
+	    YaleCatalog a, b;
+	    int na, nb, i, same, named, renamed;
+	    df = fdopen(mkstemp(dfn), "w");
+	    nf = fdopen(mkstemp(nfn), "w");
+	    for (i = 1; i <= 1500; ++i) {
+		memcpy(line, rec, sizeof(rec));
+		sprintf(line + 102, "%5.2f", 1. + (i % 70) / 10.);
+		line[107] = rec[107];
+		sprintf(line + 75, "%02d%02d%04.1f%c%02d%02d%02d", i % 24, i * 7 % 60,
+		    i * .37 - 60. * floor(i * .37 / 60.), i % 3 ? '+' : '-', i % 89,
+		    i % 60, i * 11 % 60);
+		line[90] = rec[90];
+		sprintf(line + 31, "%6d", 100000 + i);
+		line[37] = rec[37];
+		sprintf(line, "%4d", i);
+		line[4] = rec[4];
+		fprintf(df, "%s\n", line);
+		if (i % 4 == 0)
+		    fprintf(nf, "%5d 1N:   Star %d of the fixture, a name long enough "
+			"to pad the notes file\n", i, i);
+		if (i % 12 == 0)
+		    fprintf(nf, "%5d 2N:   Star %d renamed\n", i, i);
+		fprintf(nf, "%5d 3C:   Remark on star %d, not a name, which the "
+		    "loaders must skip over\n", i, i);
+	    }
+	    fclose(df);
+	    fclose(nf);
+	    na = LoadYaleCatalog(6., 300., 60., -60., 80., dfn, nfn, &a);
+	    nb = LoadYaleCatalogThreads(6., 300., 60., -60., 80., dfn, nfn, 3, &b);
+	    unlink(dfn);
+	    unlink(nfn);
+	    same = na > 100 && na == nb;
+	    for (i = 0; same && i < na; ++i) {
+		const YaleStar *p = &a.stars[i], *q = &b.stars[i];
+		same = p->yale_cat == q->yale_cat && p->s.ra == q->s.ra &&
+		    p->s.dec == q->s.dec && p->s.mag == q->s.mag &&
+		    p->s.pmr == q->s.pmr && p->s.pmd == q->s.pmd &&
+		    p->s.sao == q->s.sao && p->s.spec[0] == q->s.spec[0] &&
+		    memcmp(p->cons, q->cons, 3) == 0 &&
+		    (p->s.name == NULL ? q->s.name == NULL : q->s.name != NULL &&
+		     strcmp(p->s.name, q->s.name) == 0);
+	    }
+	    for (i = 0, named = renamed = 0; same && i < nb; ++i)
+		if (b.stars[i].s.name != NULL) {
+		    ++named;
+		    renamed += strstr(b.stars[i].s.name, "renamed") != NULL;
+		}
+	    printf("Yale threaded: %d stars, %d named, %d renamed; serial %d (%s)\n",
+		nb, named, renamed, na, same && renamed > 0 &&
+		named > renamed ? "ok" : "wrong");
+	    if (na >= 0)
+		FreeYaleCatalog(&a);
+	    if (nb >= 0)
+		FreeYaleCatalog(&b);
+	}
+
+	/* Tycho-2 and Hipparcos readers, then a catalog file round trip */
+	{
+	    static const char tyc[] =
+		"0001 00008 1| |  2.31750494|  2.23184345|  -16.3|   -9.0| 68| 73| 1.7| 1.8|1958.89|1951.94| 4|1.0|1.0|0.9|1.0|12.146|0.158|12.146|0.223|999| |         |  2.31754222|  2.23186444|1.67|1.54| 88.0|100.8| |-0.2\n"
+		"0001 00013 1|X|            |            |       |       |   |   |    |    |       |       |  |   |   |   |   | 9.000|0.030| 8.500|0.020|999| |         | 10.00000000| -5.00000000|1.52|1.55|  5.0|  6.0|D|-0.3\n"
+		"0002 00001 1| | 20.00000000| 30.00000000|  100.0| -200.0| 10| 10| 1.0| 1.0|1990.50|1990.50| 4|1.0|1.0|1.0|1.0|10.500|0.030|10.000|0.020|999|T|000123AB | 20.00000000| 30.00000000|1.52|1.55|  5.0|  6.0| |-0.1\n"
+		"0002 00002 1| | 21.00000000| 31.00000000|    1.0|    1.0| 10| 10| 1.0| 1.0|1990.50|1990.50| 4|1.0|1.0|1.0|1.0|13.900|0.030|13.500|0.020|999| |         | 21.00000000| 31.00000000|1.52|1.55|  5.0|  6.0| |-0.1\n";
+	    static const char hip[] =
+		"H|       87937|||| 9.54|||269.45402305| +4.66828815|| 549.01| -797.84|10326.93|||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||sdM4|\n"
+		"H|       32349||||-1.44|||101.28715539|-16.71611582|| 379.21| -546.01|-1223.08|||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||A0m...|\n"
+		"H|         999||||     ||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||\n";
+	    char tfn[] = "/tmp/tycXXXXXX", hfn[] = "/tmp/hipXXXXXX";
+	    char cfn[] = "/tmp/catXXXXXX";
+	    static const uint32_t nums[] = { TYC_NUMBER(1,8,1),
+		TYC_NUMBER(1,13,1), TYC_NUMBER(2,1,1), 87937, 32349 };
+	    StarCatalog cat, map;
+	    YaleStar ys[5];
+	    FILE *f;
+	    int nt, nh, i, k, same;
+	    memset(&cat, 0, sizeof(cat));
+	    f = fdopen(mkstemp(tfn), "w");
+	    fputs(tyc, f);
+	    fclose(f);
+	    f = fdopen(mkstemp(hfn), "w");
+	    fputs(hip, f);
+	    fclose(f);
+	    nt = ReadTycho2Catalog(tfn, 13., &cat);
+	    nh = ReadHipparcosCatalog(hfn, 13., &cat);
+	    unlink(tfn);
+	    unlink(hfn);
+	    for (k = 0; k < 5; ++k) {
+		memset(&ys[k], 0, sizeof(ys[k]));
+		for (i = 0; i < cat.count; ++i)
+		    if (cat.stars[i].cat == nums[k])
+			StarCatalogGet(&cat, i, &ys[k]);
+	    }
+	    printf("Tycho-2: %d stars (%s), TYC 1-8-1 V %s ra %s, "
+		"TYC 1-13-1 V %s dec %s, TYC 2-1-1 %.2s %s\n",
+		nt, nt == 3 ? "ok" : "wrong",
+		match(ys[0].s.mag, 12.146, 1e-3), match(ys[0].s.ra, 2.31750494, 1e-6),
+		match(ys[1].s.mag, 8.455, 1e-3), match(ys[1].s.dec, -5., 1e-6),
+		ys[2].s.type, match(ys[2].s.pmd, -.2, 1e-3));
+	    printf("Hipparcos: %d stars (%s), Barnard's star V %s at J2000 %s %s, "
+		"Sirius %s spec %c (%s)\n", nh, nh == 2 ? "ok" : "wrong",
+		match(ys[3].s.mag, 9.54, 1e-3), match(ys[3].s.ra, 269.452077, 1e-5),
+		match(ys[3].s.dec, 4.693388, 1e-5), match(ys[4].s.mag, -1.44, 1e-3),
+		ys[4].s.spec[0], ys[4].s.spec[0] == 'A' &&
+		strcmp(ys[2].s.type, "SD") == 0 ? "ok" : "wrong");
+
+	    StarCatalogIndex(&cat);
+	    close(mkstemp(cfn));
+	    k = StarCatalogWrite(&cat, cfn) == 0 ? StarCatalogOpen(cfn, &map) : -1;
+	    unlink(cfn);
+	    same = k == cat.count && map.count == cat.count && map.ncells == cat.ncells &&
+		map.ncathash == cat.ncathash &&
+		memcmp(map.stars, cat.stars, cat.count * sizeof(*cat.stars)) == 0 &&
+		memcmp(map.zones, cat.zones, (CAT_ZONES + 1) * sizeof(*cat.zones)) == 0 &&
+		memcmp(map.cells, cat.cells, (cat.ncells + 1) * sizeof(*cat.cells)) == 0 &&
+		memcmp(map.motion, cat.motion, (cat.ncells + 1) * sizeof(*cat.motion)) == 0 &&
+		memcmp(map.cathash, cat.cathash, cat.ncathash * sizeof(*cat.cathash)) == 0;
+	    for (k = 0; same && k < 5; ++k)
+		same = StarCatalogFind(&map, nums[k]) == StarCatalogFind(&cat, nums[k]) &&
+		    StarCatalogFind(&map, nums[k]) >= 0;
+	    printf("catalog file: %d records, cells, hashes (%s)\n", k,
+		same && StarCatalogFind(&map, 999) < 0 ? "ok" : "wrong");
+	    if (k >= 0)
+		FreeStarCatalog(&map);
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Deep-sky objects from OpenNGC, in one catalog with a star */
+	{
+	    static const char table[] =
+		"Name;Type;RA;Dec;Const;MajAx;MinAx;PosAng;B-Mag;V-Mag;Hubble;M;Common names\n"
+		"NGC0224;G;00:42:44.35;+41:16:08.6;And;177.83;69.66;35;4.29;3.44;Sb;031;Andromeda Galaxy\n"
+		"NGC0225;OCl;00:43:39.20;+61:46:30.0;Cas;15.00;15.00;;7.00;;;;\n"
+		"NGC1976;Cl+N;05:35:16.48;-05:23:22.8;Ori;90.00;60.00;;4.00;;;042;Great Orion Nebula,Orion Nebula\n"
+		"NGC4486;G;12:30:49.42;+12:23:28.0;Vir;7.11;6.72;160;9.59;8.63;E0-1;087;Virgo A\n"
+		"NGC7000;*;20:58:47.0;+44:19:48.0;Cyg;;;;;;;;\n";
+	    Star s = { 10.5, 41.3, 8.5, 2000, 0, 0, "SS", "K", 0, NULL };
+	    StarCatalog cat;
+	    CompactStar c;
+	    YaleStar ys;
+	    char fn[] = "/tmp/ngcXXXXXX";
+	    int fd = mkstemp(fn);
+	    FILE *f = fdopen(fd, "w");
+	    int idx[8], i, n;
+
+	    fputs(table, f);
+	    fclose(f);
+	    memset(&cat, 0, sizeof(cat));
+	    compactStar(&s, &c);
+	    c.cat = 224;			/* as HIP 224 */
+	    StarCatalogAdd(&cat, &c, 0, NULL);
+	    n = ReadOpenNGC(fn, 20., &cat);
+	    unlink(fn);
+	    StarCatalogIndex(&cat);
+	    i = StarCatalogFindMessier(&cat, 31);
+	    StarCatalogGet(&cat, i, &ys);
+	    printf("OpenNGC: %d objects (%s), M31 = %s %s %.1f' pa %d (%s)",
+		n, n == 4 ? "ok" : "wrong", ys.s.name, ys.s.type,
+		cat.shape[i].major * .1, cat.shape[i].pa,
+		strcmp(ys.s.type, "GS") == 0 && cat.shape[i].major == 1778 &&
+		cat.shape[i].pa == 35 ? "ok" : "wrong");
+	    printf(", NGC 224 (%s), HIP 224 (%s)",
+		StarCatalogFind(&cat, DSO_NGC(224)) == i ? "ok" : "wrong",
+		StarCatalogFind(&cat, 224) >= 0 &&
+		StarCatalogFind(&cat, 224) != i ? "ok" : "wrong");
+	    i = StarCatalogFind(&cat, DSO_NGC(4486));
+	    printf(", NGC 4486 = %s %s (%s)\n", StarCatalogName(&cat, i),
+		starTypes[cat.stars[i].type],
+		strcmp(starTypes[cat.stars[i].type], "GP") == 0 ? "ok" : "wrong");
+	    n = StarCatalogSelect(&cat, 10., 10., 11.5, 40.5, 42., idx);
+	    printf("field around M31: %d records (%s)\n", n, n == 2 ? "ok" : "wrong");
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Plate solving: an image of a synthetic sky, 40"/pixel, north up */
+	{
+	    StarCatalog cat;
+	    PlateIndex pidx;
+	    PlateSolution sol;
+	    double x[60], y[60];
+	    int mag[60];
+	    int n = 0, i, k, ok;
+
+	    memset(&cat, 0, sizeof(cat));
+	    srand48(1);
+	    for (i=0; i < 9000; ++i) {
+		Star s;
+		CompactStar c;
+		memset(&s, 0, sizeof(s));
+		s.ra = 360. * drand48();
+		s.dec = asind(2. * drand48() - 1.);
+		s.mag = 6.5 + 2.5 * log10(drand48() + 1e-9);
+		s.epoch = 2000;
+		compactStar(&s, &c);
+		StarCatalogAdd(&cat, &c, 0, NULL);
+	    }
+	    PlateIndexBuild(&cat, 6.5, 4., 20., &pidx);
+	    /* the image's stars, brightest first */
+	    for (i=0; i < cat.count; ++i) {
+		double ra = cat.stars[i].ra / CU_PER_DEG - 80.;
+		double dec = cat.stars[i].dec / CU_PER_DEG;
+		double c = cosd(dec) * cosd(ra), px, py;
+		int k;
+		if (c < .8)
+		    continue;
+		px = 1500. - cosd(dec) * sind(ra) / c / (40./3600.*RAD);
+		py = 1000. - sind(dec) / c / (40./3600.*RAD);
+		if (px < 0. || py < 0. || px > 3000. || py > 2000.)
+		    continue;
+		for (k = n < 60 ? n++ : 60; k > 0 && mag[k-1] > cat.stars[i].mag; --k)
+		    if (k < 60) {
+			x[k] = x[k-1]; y[k] = y[k-1]; mag[k] = mag[k-1];
+		    }
+		if (k < 60) {
+		    x[k] = px; y[k] = py; mag[k] = cat.stars[i].mag;
+		}
+	    }
+	    ok = PlateSolve(&pidx, x, y, n, 3000., 2000., &sol);
+	    printf("plate solve %d: ra=%lf (%s) dec=%lf (%s) scale=%lf (%s)\n",
+		ok, sol.ra, match(sol.ra, 80., 1e-3), sol.dec,
+		match(sol.dec, 0., 1e-3), sol.scale, match(sol.scale, 40., 1e-2));
+	    /* the same index written out and mapped back */
+	    {
+		char fn[] = "/tmp/plateXXXXXX";
+		PlateIndex map;
+		PlateSolution sol2;
+		close(mkstemp(fn));
+		k = PlateIndexWrite(&pidx, fn) == 0 ? PlateIndexOpen(fn, &map) : -1;
+		unlink(fn);
+		ok = k == pidx.nquads && map.nstars == pidx.nstars &&
+		    map.smin == pidx.smin && map.smax == pidx.smax &&
+		    memcmp(map.stars, pidx.stars, pidx.nstars * sizeof(*pidx.stars)) == 0 &&
+		    memcmp(map.quads, pidx.quads, pidx.nquads * sizeof(*pidx.quads)) == 0 &&
+		    PlateSolve(&map, x, y, n, 3000., 2000., &sol2) > 0 &&
+		    sol2.ra == sol.ra && sol2.dec == sol.dec &&
+		    sol2.scale == sol.scale && sol2.matched == sol.matched;
+		printf("plate index file: %d quads (%s)\n", k, ok ? "ok" : "wrong");
+		if (k >= 0)
+		    FreePlateIndex(&map);
+	    }
+	    FreePlateIndex(&pidx);
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Lunar occultation: a star put behind the Moon for an observer
+	 * standing under it */
+	{
+	    StarCatalog cat;
+	    Site site;
+	    Occultation *occ;
+	    double T = 2460680.75, r, dd;
+	    int i, k;
+
+	    memset(&cat, 0, sizeof(cat));
+	    MoonPrecise(T, &p);
+	    ecliptic2equat(p.lat, p.lon, &decl, &RA, T);
+	    site.lat = decl;
+	    site.lon = limitAngle(time2sidereal(T) * 15. - RA * 15.);
+	    site.height = 0.;
+	    MoonTopocentric(T, &site, &decl, &RA, NULL);
+	    precession(decl, RA, T, &dd, &r, JD2000);
+	    for (i=0; i < 3; ++i) {
+		Star s;
+		CompactStar c;
+		memset(&s, 0, sizeof(s));
+		s.ra = limitAngle(r * 15. + i * 10.);
+		s.dec = dd;
+		s.mag = 5.;
+		s.epoch = 2000;
+		compactStar(&s, &c);
+		c.cat = i + 1;
+		StarCatalogAdd(&cat, &c, 0, NULL);
+	    }
+	    StarCatalogIndex(&cat);
+	    n = StarCatalogOccultations(&cat, &site, 1, T - .5, T + .5, 6., 0, &occ);
+	    k = StarCatalogFind(&cat, 1);
+	    printf("occultations: %d (%s)", (int)n, n == 1 ? "ok" : "wrong");
+	    if (n >= 1)
+		printf(", star %u at %s, in %.0f min, out %.0f min (%s)",
+		    cat.stars[occ[0].star].cat,
+		    match(occ[0].jd, T, 2./1440.), (occ[0].in - T) * 1440.,
+		    (occ[0].out - T) * 1440.,
+		    occ[0].star == k && occ[0].in < T && occ[0].out > T ?
+			"ok" : "wrong");
+	    putchar('\n');
+	    free(occ);
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Rising and setting at 50N: circumpolar, never rises, and one that does */
+	{
+	    static const double ra[3] = {0., 90., 200.}, dec[3] = {80., -60., 20.};
+	    float rise[3], transit[3], set[3];
+	    uint8_t flags[3];
+	    Site site;
+	    double A, H1, H2, A3, H3, jd0 = JD2000 - .5;
+
+	    site.lat = 50.;
+	    site.lon = 0.;
+	    site.height = 0.;
+	    riseTransitSet(3, ra, dec, &site, JD2000, rise, transit, set, flags);
+	    equat2bearings(dec[2], ra[2]/15., site.lat, site.lon, &A, &H1,
+		jd0, (JD2000 + rise[2] - jd0) * 24.);
+	    equat2bearings(dec[2], ra[2]/15., site.lat, site.lon, &A, &H2,
+		jd0, (JD2000 + set[2] - jd0) * 24.);
+	    equat2bearings(dec[2], ra[2]/15., site.lat, site.lon, &A3, &H3,
+		jd0, (JD2000 + transit[2] - jd0) * 24.);
+	    printf("rise/set flags %d %d %d (%s)", flags[0], flags[1], flags[2],
+		flags[0] == RTS_CIRCUMPOLAR && flags[1] == RTS_NEVER_RISES &&
+		flags[2] == 0 && isnan(rise[0]) ? "ok" : "wrong");
+	    printf(", rise alt %s", match(H1, riseAltitude(0.), .01));
+	    printf(", set alt %s", match(H2, riseAltitude(0.), .01));
+	    printf(", transit az %s\n", match(A3, 0., .01));
+	}
+
+	/* A catalog at two sites, in blocks on two threads, against
+	 * riseTransitSet() one site at a time */
+	{
+	    static const Site sites[2] = {{50., 0., 0.}, {-33.9, -151.2, 100.}};
+	    enum { N = 20000 };
+	    StarCatalog cat;
+	    double *ra = malloc(N * sizeof(double)), *dec = malloc(N * sizeof(double));
+	    float *rise = malloc(3*N*3 * sizeof(float)), *transit = rise + 3*N,
+		*set = transit + 3*N;
+	    uint8_t *flags = malloc(3*N);
+	    int i, k, same;
+
+	    memset(&cat, 0, sizeof(cat));
+	    srand48(2);
+	    for (i = 0; i < N; ++i) {
+		Star s;
+		CompactStar c;
+		memset(&s, 0, sizeof(s));
+		s.ra = 360. * drand48();
+		s.dec = asind(2. * drand48() - 1.);
+		s.mag = 8.;
+		s.epoch = 2000;
+		compactStar(&s, &c);
+		StarCatalogAdd(&cat, &c, 0, NULL);
+		ra[i] = c.ra / CU_PER_DEG;
+		dec[i] = c.dec / CU_PER_DEG;
+	    }
+	    same = StarCatalogRiseSet(&cat, sites, 2, JD2000, 2, rise, transit,
+		set, flags) == 0;
+	    for (k = 0; same && k < 2; ++k) {
+		riseTransitSet(N, ra, dec, &sites[k], JD2000, rise + 2*N,
+		    transit + 2*N, set + 2*N, flags + 2*N);
+		for (i = 0; same && i < N; ++i) {
+		    int j = k*N + i;
+		    same = flags[j] == flags[2*N+i] &&
+			(isnan(rise[j]) ? isnan(rise[2*N+i]) :
+			 fabs(rise[j] - rise[2*N+i]) < 1e-5) &&
+			(isnan(set[j]) ? isnan(set[2*N+i]) :
+			 fabs(set[j] - set[2*N+i]) < 1e-5) &&
+			fabs(transit[j] - transit[2*N+i]) < 1e-5;
+		}
+	    }
+	    printf("catalog rise/set, %d stars at 2 sites (%s)\n", N,
+		same ? "ok" : "wrong");
+	    free(ra);
+	    free(dec);
+	    free(rise);
+	    free(flags);
+	    FreeStarCatalog(&cat);
+	}
+
+	/* Time scales: leap seconds, Delta T and a round trip */
+	{
+	    double t[3], u[3], jd = date2julian(2017, 1, 1);
+
+	    printf("TAI-UTC %g %g (%s)", taiMinusUtc(jd - 1e-6), taiMinusUtc(jd),
+		taiMinusUtc(jd - 1e-6) == 36. && taiMinusUtc(jd) == 37. ?
+		"ok" : "wrong");
+	    printf(", J2000 TT-UTC %s",
+		match((convertTime(JD2000, TS_UTC, TS_TT) - JD2000) * 86400.,
+		    64.184, 1e-3));
+	    printf(", Delta T %s\n", match(deltaT(JD2000), 63.8, .1));
+	    t[0] = JD2000; t[1] = 2438800.3; t[2] = 2300000.;
+	    convertTimes(3, t, TS_UTC, TS_TDB, u);
+	    convertTimes(3, u, TS_TDB, TS_UTC, u);
+	    printf("time scale round trip %s",
+		match(fabs(u[0]-t[0]) + fabs(u[1]-t[1]) + fabs(u[2]-t[2]), 0., 1e-9));
+	    printf(", 1965 TAI-UTC %s\n",
+		match(taiMinusUtc(2438761.5), 3.54013, 1e-6));
+	}
+
+	/* Time zones: a POSIX rule across the spring and autumn changes */
+	{
+	    TimeZone tz;
+	    double t[3], u[3];
+
+	    if (LoadTimeZone("CET-1CEST,M3.5.0,M10.5.0/3", &tz) < 0)
+		printf("time zone: load failed (wrong)\n");
+	    else {
+		t[0] = time2julian(2024, 3, 31, 0, 59, 0.);
+		t[1] = time2julian(2024, 3, 31, 1, 0, 0.);
+		t[2] = time2julian(2024, 10, 27, 2, 0, 0.);
+		utc2local_n(&tz, 3, t, u);
+		printf("time zone %d %d %d %s (%s)", tzOffset(&tz, t[0]),
+		    tzOffset(&tz, t[1]), tzOffset(&tz, t[2]), tzAbbrev(&tz, t[1]),
+		    tzOffset(&tz, t[0]) == 3600 && tzOffset(&tz, t[1]) == 7200 &&
+		    tzOffset(&tz, t[2]) == 3600 ? "ok" : "wrong");
+		printf(", local %s", match(u[1], time2julian(2024, 3, 31, 3, 0, 0.), 1e-8));
+		local2utc_n(&tz, 3, u, u);
+		printf(", round trip %s\n",
+		    match(fabs(u[0]-t[0]) + fabs(u[1]-t[1]) + fabs(u[2]-t[2]), 0., 1e-8));
+		FreeTimeZone(&tz);
+	    }
+	}
+
+	/* TZif file starting with the RFC 8536 -2^59 "big bang" */
+	{
+	    static const unsigned char v1[] = { 'T','Z','i','f','2',
+		[39] = 1, [43] = 4, [50] = 'U','T','C',0 };
+	    static const unsigned char v2[] = { 'T','Z','i','f','2',
+		[35] = 2, [39] = 2, [43] = 8,
+		0xf8,0,0,0,0,0,0,0, 0,0,0,0,0x65,0x53,0xf1,0x00,  /* 1.7e9 */
+		0, 1, 0,0,0x0e,0x10,0,0, 0,0,0x1c,0x20,0,4,
+		'X','S','T',0,'Y','S','T',0, '\n','Y','S','T','-','2','\n' };
+	    char fn[] = "/tmp/tzXXXXXX";
+	    int fd = mkstemp(fn);
+	    FILE *f = fdopen(fd, "w");
+	    TimeZone tz;
+
+	    fwrite(v1, 1, sizeof(v1), f);
+	    fwrite(v2, 1, sizeof(v2), f);
+	    fclose(f);
+	    if (LoadTimeZone(fn, &tz) < 0)
+		printf("big bang zone: load failed (wrong)\n");
+	    else {
+		printf("big bang zone %d %d %d (%s)\n",
+		    tzOffset(&tz, time2julian(-3000, 1, 1, 0, 0, 0.)),
+		    tzOffset(&tz, time2julian(2000, 1, 1, 0, 0, 0.)),
+		    tzOffset(&tz, time2julian(2024, 1, 1, 0, 0, 0.)),
+		    tz.nindex == 1 &&
+		    tzOffset(&tz, time2julian(-3000, 1, 1, 0, 0, 0.)) == 3600 &&
+		    tzOffset(&tz, time2julian(2000, 1, 1, 0, 0, 0.)) == 3600 &&
+		    tzOffset(&tz, time2julian(2024, 1, 1, 0, 0, 0.)) == 7200 ?
+			"ok" : "wrong");
+		FreeTimeZone(&tz);
+	    }
+	    unlink(fn);
+	}
+
+	/* Sidereal series: hourly for 100 days at two longitudes */
+	{
+	    SiderealSeries ss;
+	    static double lst[2400*2];
+	    double lon[2] = {0., -135.}, err = 0., d;
+	    SplitJD sj;
+	    int i;
+
+	    siderealSeriesInit(&ss, 2460000.5, 1./24., 0);
+	    siderealSeries_n(&ss, 2400, 2, lon, lst);
+	    for (i = 0; i < 2400; ++i) {
+		sj.day = 2460001 + (i + 12) / 24 - 1;
+		sj.frac = ((i + 12) % 24) / 24.;
+		d = fabs(lst[2*i] - splitJD2sidereal(&sj));
+		err = d > err ? d : err;
+		d = lst[2*i+1] - lst[2*i] - 9.;
+		d = fabs(d - 24. * floor(d / 24. + .5));
+		err = d > err ? d : err;
+	    }
+	    printf("sidereal series %s\n", match(err, 0., 1e-8));
+	}
+
+	/* Angle reduction: tiny negatives, arguments past INT_MAX */
+	{
+	    double in[4] = {-1e-20, 3e12 + 7.5, -3e12 - 7.5, 725.}, out[4];
+
+	    limitAngles_n(4, in, out, ANGLE_DEG);
+	    printf("limitAngle %g %g %g (%s)", limitAngle(-1e-20),
+		limitAngle(3e12 + 7.5), limitAngle(-3e12 - 7.5),
+		limitAngle(-1e-20) == 0. && limitAngle(3e12 + 7.5) == 127.5 &&
+		limitAngle(-3e12 - 7.5) == 232.5 &&
+		memcmp(out, (double[4]){0., 127.5, 232.5, 5.}, sizeof(out)) == 0 ?
+		    "ok" : "wrong");
+	    printf(", signed %g %g (%s)", limitAngleSigned(180.),
+		limitHourSigned(-12.5),
+		limitAngleSigned(180.) == -180. && limitHourSigned(-12.5) == 11.5 &&
+		limitHour(-1e-18) == 0. ? "ok" : "wrong");
+	    printf(", radians %s\n",
+		match(limitRadians(-1.) + limitRadiansSigned(7.), 6., 1e-14));
+	}
+
+	/* Nautical almanac, 2024 Jan 1 0h: Aries 100 09.1, Sun S23 03.5 */
+	{
+	    Almanac alm, alm1;
+	    const AlmanacEntry *e;
+	    double err = 0., dg;
+	    int h;
+
+	    if( AlmanacCompute(date2julian(2024, 1, 1.3), 3, 2, &alm) < 0 ||
+		AlmanacCompute(date2julian(2024, 1, 1.), 3, 1, &alm1) < 0 )
+	      printf("almanac (wrong)\n");
+	    else {
+		e = alm.rows;
+		printf("almanac Aries %s", match(e[ALM_ARIES].gha, 100.+9.1/60., .1/60));
+		printf(", Sun %s", match(e[ALM_SUN].dec, -23.-3.5/60., .5/60));
+		for (h = 0; h < alm.nhours; ++h, e += ALM_NBODIES) {
+		    dg = e[ALM_NBODIES+ALM_MOON].gha - e[ALM_MOON].gha -
+			14.-19./60. - e[ALM_MOON].v/60.;
+		    dg = fabs(dg - 360. * floor(dg / 360. + .5)) +
+			fabs(e[ALM_NBODIES+ALM_MARS].dec - e[ALM_MARS].dec -
+			    e[ALM_MARS].d/60.);
+		    err = dg > err ? dg : err;
+		}
+		printf(", v d %s", match(err, 0., 1e-4));
+		printf(", threads (%s)\n", memcmp(alm.rows, alm1.rows,
+		    (alm.nhours+1) * ALM_NBODIES * sizeof(AlmanacEntry)) == 0 ?
+		    "ok" : "wrong");
+		FreeAlmanac(&alm);
+		FreeAlmanac(&alm1);
+	    }
+	}
+
+	/* Almanac file: mapped tables, interpolated between the hours */
+	{
+	    Almanac alm;
+	    char fn[] = "/tmp/almXXXXXX";
+	    int fd = mkstemp(fn);
+	    double g[ALM_NBODIES], d[ALM_NBODIES], hp[ALM_NBODIES];
+	    double jd[3], gha[3], dec[3], err = 0., e;
+	    int body[3] = {ALM_MOON, ALM_SUN, ALM_MOON}, i, bad;
+
+	    close(fd);
+	    if( AlmanacCompute(date2julian(2024, 3, 20.), 2, 0, &alm) < 0 ||
+		AlmanacWrite(&alm, fn) < 0 )
+	      printf("almanac file (wrong)\n");
+	    else {
+		FreeAlmanac(&alm);
+		AlmanacOpen(fn, &alm);
+		jd[0] = date2julian(2024, 3, 20.01);	/* before the 2nd hour */
+		jd[1] = date2julian(2024, 3, 20.6789);
+		jd[2] = date2julian(2024, 3, 21.99);	/* after the next to last */
+		bad = AlmanacGhaDec_n(&alm, 3, body, jd, gha, dec);
+		for (i = 0; i < 3; ++i) {
+		    almanacPositions(jd[i], g, d, hp);
+		    e = fabs(limitAngleSigned(gha[i] - g[body[i]])) +
+			fabs(dec[i] - d[body[i]]);
+		    err = e > err ? e : err;
+		}
+		printf("almanac file %d hours (%s), lookup %s",
+		    alm.nhours, alm.nhours == 48 && bad == 0 ? "ok" : "wrong",
+		    match(err * 60., 0., .005));
+		printf(", outside (%s)\n",
+		    AlmanacGhaDec(&alm, ALM_SUN, date2julian(2024, 3, 22.01),
+			gha, dec) < 0 ? "ok" : "wrong");
+		FreeAlmanac(&alm);
+	    }
+	    unlink(fn);
+	}
+
+	/* Sight reduction; a running fix from two stars and the Sun's
+	 * lower limb, sailing 090 at 10 knots, DR 12 miles out */
+	{
+	    double gha[2] = {53., 300.}, dec[2] = {-15., 40.};
+	    double la[2] = {32., -20.}, lo[2] = {-16., 100.};
+	    double Hc[2], Zn[2], alt, az, err = 0., e;
+	    double jd = time2julian(2024, 1, 15, 15, 0, 0.);
+	    double tlat = 35., tlon = -40., g[ALM_NBODIES], d[ALM_NBODIES];
+	    double hp[ALM_NBODIES], h[3] = {40., 30., 0.}, z[3] = {300., 60., 0.};
+	    Sight sights[3];
+	    SightSet set;
+	    Fix fix;
+	    int i, k;
+
+	    sightReduce_n(2, gha, dec, la, lo, NULL, Hc, Zn, NULL);
+	    for (i = 0; i < 2; ++i) {
+		altaz(limitAngle(gha[i] + lo[i]), dec[i], la[i], &alt, &az);
+		e = fabs(alt - Hc[i]) + fabs(az - Zn[i]);
+		err = e > err ? e : err;
+	    }
+	    printf("sight reduction %s", match(err * 60., 0., .001));
+
+	    memset(&set, 0, sizeof(set));
+	    set.jd = jd;
+	    set.lat = tlat + 8./60.;
+	    set.lon = tlon - 9./60.;
+	    set.course = 90.;
+	    set.speed = 10.;
+	    set.height = 3.;
+	    set.nsights = 3;
+	    set.sights = sights;
+	    for (i = 0; i < 3; ++i) {
+		Sight *s = &sights[i];
+		double plon = tlon + 10. * (i - 2) * .5 / (60. * cos(tlat * M_PI/180.));
+		double sl = sin(tlat * M_PI/180.), cl = cos(tlat * M_PI/180.);
+		double Ho, sd;
+
+		s->jd = jd + (i - 2) * .5 / 24.;
+		almanacPositions(s->jd, g, d, hp);
+		if (i < 2) {		/* a star seen at h, z */
+		    s->body = SIGHT_STAR;
+		    s->limb = 0;
+		    s->dec = asin(sl * sin(h[i] * M_PI/180.) + cl *
+			cos(h[i] * M_PI/180.) * cos(z[i] * M_PI/180.)) * 180./M_PI;
+		    s->sha = limitAngle(atan2(-sin(z[i] * M_PI/180.) *
+			cos(h[i] * M_PI/180.), (sin(h[i] * M_PI/180.) - sl *
+			sin(s->dec * M_PI/180.)) / cl) * 180./M_PI - plon - g[0]);
+		    Ho = h[i];
+		    sd = 0.;
+		} else {
+		    s->body = ALM_SUN;
+		    s->limb = SIGHT_LOWER;
+		    altaz(limitAngle(g[ALM_SUN] + plon), d[ALM_SUN], tlat, &Ho, &az);
+		    sd = hp[ALM_SUN] * 959.63 / 8.794 / 60.;
+		}
+		s->Hs = Ho;
+		for (k = 0; k < 6; ++k)
+		    s->Hs += Ho - sd - sext2obs(s->Hs, 0., set.height, 0., 0.,
+			hp[s->body] / 60.);
+	    }
+	    k = sightFix(NULL, &set, &fix);
+	    printf(", running fix %s", match(hypot(fix.lat - tlat,
+		(fix.lon - tlon) * cos(tlat * M_PI/180.)) * 60., 0., .01));
+	    set.nsights = 2;
+	    set.sigma = 2.;
+	    sightFix(NULL, &set, &fix);
+	    printf(", covariance %s", match(fix.cov[0] + fix.cov[2], 32./3., .05));
+	    printf(", status (%s)\n", k == 0 && fix.status == 0 &&
+		sightFix_n(NULL, 1, &set, 0, &fix) == 0 ? "ok" : "wrong");
+	}
 
 	exit(0) ;
 }
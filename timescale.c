@@ -0,0 +1,395 @@
+	/* Time scales: UTC, UT1, TAI, TT and TDB */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Meeus' formulae for the Sun, Moon and planets take their dates in
+ * Dynamical Time (TT, or TDB for the planets; the two differ by less
+ * than 2 milliseconds), while the sidereal time and anything tied to
+ * the rotation of the Earth take Universal Time (UT1).  Clocks keep
+ * UTC, which follows TAI by a whole number of leap seconds and stays
+ * within 0.9 seconds of UT1.
+ *
+ *	TAI = UTC + (TAI - UTC)		leap seconds, from a table
+ *	TT  = TAI + 32.184 s
+ *	TT  = UT1 + Delta T		observed, or extrapolated
+ *	TDB = TT + 0.001657 s sin g + ...	Meeus, ch. 10
+ *
+ * Both tables are built once, on first use, as arrays indexed
+ * directly by the date, so a lookup is a subtraction and a load:
+ *
+ *  - Delta T is sampled at the start of every year from 2000 BC to
+ *    AD 2200 and interpolated linearly.  From 1972 the samples are
+ *    the observed values; before that they are the polynomials of
+ *    Espenak & Meeus (NASA TP-2006-214141), which follow the
+ *    historical record; after the last observed year, the same
+ *    polynomials shifted to meet it.  Outside the table, the parabola
+ *    -20 + 32 u^2 of Morrison & Stephenson.
+ *
+ *  - TAI - UTC is indexed by day from 1961, when UTC began.  Until
+ *    1972 UTC ran at an offset rate and TAI - UTC changed daily;
+ *    since then it has changed by whole seconds.  The table knows
+ *    the leap seconds through 2017; later dates get the last value
+ *    until the table is brought up to date.  Before 1961 UTC is taken
+ *    to be UT1.
+ *
+ * double
+ * deltaT(double jd)
+ *	TT - UT1 in seconds at a date.
+ *
+ * double
+ * taiMinusUtc(double jd)
+ *	TAI - UTC in seconds at a UTC date.
+ *
+ * double
+ * convertTime(double jd, int from, int to)
+ *	Convert a Julian date between time scales.
+ *
+ * void
+ * convertTimes(int n, const double *jd, int from, int to, double *out)
+ *	The same for an array of dates.
+ *
+ * void
+ * PlanetAt(PlanetFunc planet, double jd, int scale, PlanetState *p)
+ *	Call one of the planet or Moon functions at a date in any scale.
+ */
+
+#define	TT_TAI		32.184		/* TT - TAI, seconds */
+
+#define	DT_YEAR0	(-2000)		/* first year in the Delta T table */
+#define	DT_YEAR1	2200		/* last */
+#define	DT_N		(DT_YEAR1 - DT_YEAR0 + 1)
+
+#define	LS_JD0		2437300.5	/* 1961 Jan 1, start of UTC */
+#define	LS_DAYS		25202		/* through 2029 Dec 31 */
+
+
+/**
+ * Delta T at the start of each year from 1972, seconds, from the
+ * IERS and USNO values of UT1 - UTC.
+ */
+static const float dtObserved[] = {
+	42.23, 43.37, 44.49, 45.48, 46.46, 47.52, 48.53, 49.59,	/* 1972 */
+	50.54, 51.38, 52.17, 52.96, 53.79, 54.34, 54.87, 55.32,	/* 1980 */
+	55.82, 56.30, 56.86, 57.57, 58.31, 59.12, 59.98, 60.78,	/* 1988 */
+	61.63, 62.29, 62.97, 63.47, 63.83, 64.09, 64.30, 64.47,	/* 1996 */
+	64.57, 64.69, 64.85, 65.15, 65.46, 65.78, 66.07, 66.32,	/* 2004 */
+	66.60, 66.91, 67.28, 67.64, 68.10, 68.59, 68.97, 69.22,	/* 2012 */
+	69.36, 69.36, 69.29, 69.20, 69.18, 69.14,		/* 2020 */
+} ;
+#define	DT_OBS0		1972
+#define	DT_NOBS		(sizeof(dtObserved)/sizeof(dtObserved[0]))
+
+/**
+ * TAI - UTC = offset + (MJD - mjd) * rate from each date on.
+ * From the USNO table tai-utc.dat.
+ */
+static const struct {
+	  double jd, offset ;
+	  int mjd ;
+	  float rate ;
+	} leapTable[] = {
+	  {2437300.5, 1.4228180, 37300, 0.001296},	/* 1961 Jan 1 */
+	  {2437512.5, 1.3728180, 37300, 0.001296},	/* 1961 Aug 1 */
+	  {2437665.5, 1.8458580, 37665, 0.0011232},	/* 1962 Jan 1 */
+	  {2438334.5, 1.9458580, 37665, 0.0011232},	/* 1963 Nov 1 */
+	  {2438395.5, 3.2401300, 38761, 0.001296},	/* 1964 Jan 1 */
+	  {2438486.5, 3.3401300, 38761, 0.001296},	/* 1964 Apr 1 */
+	  {2438639.5, 3.4401300, 38761, 0.001296},	/* 1964 Sep 1 */
+	  {2438761.5, 3.5401300, 38761, 0.001296},	/* 1965 Jan 1 */
+	  {2438820.5, 3.6401300, 38761, 0.001296},	/* 1965 Mar 1 */
+	  {2438942.5, 3.7401300, 38761, 0.001296},	/* 1965 Jul 1 */
+	  {2439004.5, 3.8401300, 38761, 0.001296},	/* 1965 Sep 1 */
+	  {2439126.5, 4.3131700, 39126, 0.002592},	/* 1966 Jan 1 */
+	  {2439887.5, 4.2131700, 39126, 0.002592},	/* 1968 Feb 1 */
+	  {2441317.5, 10., 0, 0.},			/* 1972 Jan 1 */
+	  {2441499.5, 11., 0, 0.},			/* 1972 Jul 1 */
+	  {2441683.5, 12., 0, 0.},			/* 1973 Jan 1 */
+	  {2442048.5, 13., 0, 0.},			/* 1974 Jan 1 */
+	  {2442413.5, 14., 0, 0.},			/* 1975 Jan 1 */
+	  {2442778.5, 15., 0, 0.},			/* 1976 Jan 1 */
+	  {2443144.5, 16., 0, 0.},			/* 1977 Jan 1 */
+	  {2443509.5, 17., 0, 0.},			/* 1978 Jan 1 */
+	  {2443874.5, 18., 0, 0.},			/* 1979 Jan 1 */
+	  {2444239.5, 19., 0, 0.},			/* 1980 Jan 1 */
+	  {2444786.5, 20., 0, 0.},			/* 1981 Jul 1 */
+	  {2445151.5, 21., 0, 0.},			/* 1982 Jul 1 */
+	  {2445516.5, 22., 0, 0.},			/* 1983 Jul 1 */
+	  {2446247.5, 23., 0, 0.},			/* 1985 Jul 1 */
+	  {2447161.5, 24., 0, 0.},			/* 1988 Jan 1 */
+	  {2447892.5, 25., 0, 0.},			/* 1990 Jan 1 */
+	  {2448257.5, 26., 0, 0.},			/* 1991 Jan 1 */
+	  {2448804.5, 27., 0, 0.},			/* 1992 Jul 1 */
+	  {2449169.5, 28., 0, 0.},			/* 1993 Jul 1 */
+	  {2449534.5, 29., 0, 0.},			/* 1994 Jul 1 */
+	  {2450083.5, 30., 0, 0.},			/* 1996 Jan 1 */
+	  {2450630.5, 31., 0, 0.},			/* 1997 Jul 1 */
+	  {2451179.5, 32., 0, 0.},			/* 1999 Jan 1 */
+	  {2453736.5, 33., 0, 0.},			/* 2006 Jan 1 */
+	  {2454832.5, 34., 0, 0.},			/* 2009 Jan 1 */
+	  {2456109.5, 35., 0, 0.},			/* 2012 Jul 1 */
+	  {2457204.5, 36., 0, 0.},			/* 2015 Jul 1 */
+	  {2457754.5, 37., 0, 0.},			/* 2017 Jan 1 */
+} ;
+#define	LS_N		((int)(sizeof(leapTable)/sizeof(leapTable[0])))
+
+static	double	dtTable[DT_N] ;		/* Delta T at the start of each year */
+static	uint8_t	leapIndex[LS_DAYS] ;	/* leapTable entry for each day */
+static	pthread_once_t	tablesOnce = PTHREAD_ONCE_INIT ;
+
+
+/**
+ * Long-term parabola of Morrison & Stephenson.
+ */
+static double
+dtParabola(double y)
+{
+	double	u = (y - 1820.) / 100. ;
+	return -20. + 32.*u*u ;
+}
+
+/**
+ * Delta T from the polynomials of Espenak & Meeus, seconds.
+ */
+static double
+dtPolynomial(double y)
+{
+	double	t, u ;
+
+	if( y < -500. )
+	  return dtParabola(y) ;
+	if( y < 500. ) {
+	  u = y / 100. ;
+	  return 10583.6 + u*(-1014.41 + u*(33.78311 + u*(-5.952053 +
+		u*(-0.1798452 + u*(0.022174192 + u*0.0090316521))))) ;
+	}
+	if( y < 1600. ) {
+	  u = (y - 1000.) / 100. ;
+	  return 1574.2 + u*(-556.01 + u*(71.23472 + u*(0.319781 +
+		u*(-0.8503463 + u*(-0.005050998 + u*0.0083572073))))) ;
+	}
+	if( y < 1700. ) {
+	  t = y - 1600. ;
+	  return 120. + t*(-0.9808 + t*(-0.01532 + t/7129.)) ;
+	}
+	if( y < 1800. ) {
+	  t = y - 1700. ;
+	  return 8.83 + t*(0.1603 + t*(-0.0059285 + t*(0.00013336 -
+		t/1174000.))) ;
+	}
+	if( y < 1860. ) {
+	  t = y - 1800. ;
+	  return 13.72 + t*(-0.332447 + t*(0.0068612 + t*(0.0041116 +
+		t*(-0.00037436 + t*(0.0000121272 + t*(-0.0000001699 +
+		t*0.000000000875)))))) ;
+	}
+	if( y < 1900. ) {
+	  t = y - 1860. ;
+	  return 7.62 + t*(0.5737 + t*(-0.251754 + t*(0.01680668 +
+		t*(-0.0004473624 + t/233174.)))) ;
+	}
+	if( y < 1920. ) {
+	  t = y - 1900. ;
+	  return -2.79 + t*(1.494119 + t*(-0.0598939 + t*(0.0061966 -
+		t*0.000197))) ;
+	}
+	if( y < 1941. ) {
+	  t = y - 1920. ;
+	  return 21.20 + t*(0.84493 + t*(-0.076100 + t*0.0020936)) ;
+	}
+	if( y < 1961. ) {
+	  t = y - 1950. ;
+	  return 29.07 + t*(0.407 + t*(-1./233. + t/2547.)) ;
+	}
+	if( y < 1986. ) {
+	  t = y - 1975. ;
+	  return 45.45 + t*(1.067 + t*(-1./260. - t/718.)) ;
+	}
+	if( y < 2005. ) {
+	  t = y - 2000. ;
+	  return 63.86 + t*(0.3345 + t*(-0.060374 + t*(0.0017275 +
+		t*(0.000651814 + t*0.00002373599)))) ;
+	}
+	if( y < 2050. ) {
+	  t = y - 2000. ;
+	  return 62.92 + t*(0.32217 + t*0.005589) ;
+	}
+	if( y < 2150. )
+	  return dtParabola(y) - 0.5628 * (2150. - y) ;
+	return dtParabola(y) ;
+}
+
+/**
+ * Delta T for any year: observed, or the polynomials, shifted to
+ * continue from the last observation.
+ */
+static double
+dtModel(double y)
+{
+	double	last = DT_OBS0 + DT_NOBS - 1 ;
+	int	i ;
+
+	if( y < DT_OBS0 )
+	  return dtPolynomial(y) ;
+	if( y >= last )
+	  return dtObserved[DT_NOBS-1] + dtPolynomial(y) - dtPolynomial(last) ;
+	i = (int)(y - DT_OBS0) ;
+	return dtObserved[i] + (y - DT_OBS0 - i) *
+		(dtObserved[i+1] - dtObserved[i]) ;
+}
+
+static void
+buildTables(void)
+{
+	int	i, j ;
+
+	for(i = 0; i < DT_N; ++i)
+	  dtTable[i] = dtModel(DT_YEAR0 + i) ;
+
+	for(i = j = 0; i < LS_DAYS; ++i) {
+	  while( j+1 < LS_N && LS_JD0 + i >= leapTable[j+1].jd )
+	    ++j ;
+	  leapIndex[i] = j ;
+	}
+}
+
+static inline void
+tables(void)
+{
+	pthread_once(&tablesOnce, buildTables) ;
+}
+
+
+/**
+ * Delta T = TT - UT1, in seconds, at Julian date jd.  Either scale
+ * will do for jd; Delta T changes by a second or so a year.
+ */
+double
+deltaT(double jd)
+{
+	double	y = 2000. + (jd - JD2000) / 365.25 ;
+	double	f ;
+	int	i ;
+
+	tables() ;
+	f = y - DT_YEAR0 ;
+	if( !(f >= 0. && f < DT_N - 1) )
+	  return y < DT_YEAR0 ? dtParabola(y) : dtModel(y) ;
+	i = (int)f ;
+	f -= i ;
+	return dtTable[i] + f * (dtTable[i+1] - dtTable[i]) ;
+}
+
+
+/**
+ * TAI - UTC, in seconds, at UTC Julian date jd.  Before 1961, when
+ * there was no UTC, returns the value that makes UTC equal UT1.
+ */
+double
+taiMinusUtc(double jd)
+{
+	double	d = jd - LS_JD0 ;
+	int	j ;
+
+	tables() ;
+	if( !(d >= 0.) )
+	  return deltaT(jd) - TT_TAI ;
+	j = d < LS_DAYS ? leapIndex[(int)d] : LS_N - 1 ;
+	return leapTable[j].offset +
+		(jd - 2400000.5 - leapTable[j].mjd) * leapTable[j].rate ;
+}
+
+
+/**
+ * TDB - TT, seconds.  Meeus, ch. 10.
+ */
+static inline double
+tdbMinusTT(double jd)
+{
+	double	g = (357.53 + 0.98560028 * (jd - JD2000)) * RAD ;
+	return 0.001657 * sin(g) + 0.000014 * sin(2.*g) ;
+}
+
+static inline double
+toTT(double jd, int scale)
+{
+	switch( scale ) {
+	  case TS_UTC: return jd + (taiMinusUtc(jd) + TT_TAI) / 86400. ;
+	  case TS_UT1: return jd + deltaT(jd) / 86400. ;
+	  case TS_TAI: return jd + TT_TAI / 86400. ;
+	  case TS_TDB: return jd - tdbMinusTT(jd) / 86400. ;
+	  default: return jd ;
+	}
+}
+
+static inline double
+fromTT(double jd, int scale)
+{
+	double	tai, u ;
+
+	switch( scale ) {
+	  case TS_UTC:
+	    /* TAI - UTC is a function of UTC; one correction settles it
+	     * except within a leap second of the step */
+	    tai = jd - TT_TAI / 86400. ;
+	    u = tai - taiMinusUtc(tai) / 86400. ;
+	    u = tai - taiMinusUtc(u) / 86400. ;
+	    return u < LS_JD0 ? jd - deltaT(jd) / 86400. : u ;
+	  case TS_UT1: return jd - deltaT(jd) / 86400. ;
+	  case TS_TAI: return jd - TT_TAI / 86400. ;
+	  case TS_TDB: return jd + tdbMinusTT(jd) / 86400. ;
+	  default: return jd ;
+	}
+}
+
+
+/**
+ * Convert Julian date jd from one time scale (TS_UTC, TS_UT1, TS_TAI,
+ * TS_TT or TS_TDB) to another.  The result is as good as a double
+ * allows, about 40 microseconds at current dates, plus the error of
+ * Delta T for conversions between UT1 and the others.
+ */
+double
+convertTime(double jd, int from, int to)
+{
+	if( from == to )
+	  return jd ;
+	return fromTT(toTT(jd, from), to) ;
+}
+
+
+/**
+ * Convert n Julian dates from one time scale to another.  out may be
+ * the same array as jd.
+ */
+void
+convertTimes(int n, const double *jd, int from, int to, double *out)
+{
+	int	i ;
+
+	tables() ;
+	if( from == to ) {
+	  for(i = 0; i < n; ++i)
+	    out[i] = jd[i] ;
+	  return ;
+	}
+	for(i = 0; i < n; ++i)
+	  out[i] = fromTT(toTT(jd[i], from), to) ;
+}
+
+
+/**
+ * Call one of the planet or Moon functions, which want TT, at a
+ * date given in any time scale.
+ */
+void
+PlanetAt(PlanetFunc planet, double jd, int scale, PlanetState *p)
+{
+	(*planet)(convertTime(jd, scale, TS_TT), p) ;
+}
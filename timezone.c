@@ -0,0 +1,691 @@
+	/* Time zones from the zoneinfo database */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * A zone is read once from its TZif file (RFC 8536) into a sorted
+ * array of transition times and the local time type in force from
+ * each.  The POSIX TZ rule at the end of the file, which gives the
+ * daylight-saving rule after the last listed transition, is expanded
+ * into further transitions through TZ_HORIZON and evaluated directly
+ * after that.  Files in the "slim" format list transitions only up
+ * to the last change of rule, so the rule matters.
+ *
+ * Lookups go through a table indexed by the time in steps of 2^24
+ * seconds (194 days), which gives the last transition before each
+ * step; from there at most a few more transitions are passed over.
+ * A TimeZone is not changed after it is loaded, and nothing here
+ * uses the C library's time zone state, so any number of threads may
+ * share one.
+ *
+ * int
+ * LoadTimeZone(const char *name, TimeZone *tz)
+ *	Read a zone, e.g. "Europe/Paris", a TZif file or a POSIX TZ string.
+ *
+ * void
+ * FreeTimeZone(TimeZone *tz)
+ *	Release a zone.
+ *
+ * int
+ * tzOffset(const TimeZone *tz, double jd)
+ *	Local time - UTC, in seconds, at a UTC Julian date.
+ *
+ * const char *
+ * tzAbbrev(const TimeZone *tz, double jd)
+ *	Abbreviation in use at a UTC Julian date, e.g. "CEST".
+ *
+ * double
+ * utc2local(const TimeZone *tz, double jd)
+ * double
+ * local2utc(const TimeZone *tz, double jd)
+ * void
+ * utc2local_n(const TimeZone *tz, int n, const double *jd, double *out)
+ * void
+ * local2utc_n(const TimeZone *tz, int n, const double *jd, double *out)
+ *	Convert Julian dates between UTC and local time.
+ */
+
+#define	TZ_DIR		"/usr/share/zoneinfo"
+#define	TZ_DEFAULT	"/etc/localtime"
+#define	TZ_MAXFILE	(1<<20)
+#define	TZ_HORIZON	2100		/* last year expanded from the rule */
+#define	TZ_SHIFT	24		/* log2 seconds per index step */
+#define	TZ_FLOOR	(-((int64_t)1 << 40))	/* earliest indexed time */
+#define	TZ_MAXINDEX	(1 << 20)	/* index steps, 500,000 years */
+
+
+static uint32_t
+get32(const unsigned char *p)
+{
+	return (uint32_t)p[0]<<24 | p[1]<<16 | p[2]<<8 | p[3] ;
+}
+
+static int64_t
+get64(const unsigned char *p)
+{
+	return (int64_t)((uint64_t)get32(p) << 32 | get32(p+4)) ;
+}
+
+static int64_t
+floorDiv(int64_t a, int64_t b)
+{
+	int64_t	q = a / b ;
+	return q * b > a ? q - 1 : q ;
+}
+
+/**
+ * Days since 1970-01-01 of a Gregorian date.
+ */
+static int64_t
+unixDays(int y, int m, int d)
+{
+	return (int64_t)(date2julian(y, m, d) - JDUnix) ;
+}
+
+static int
+isLeap(int y)
+{
+	return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0 ;
+}
+
+
+	/* POSIX TZ strings */
+
+/**
+ * Zone abbreviation: letters, or anything between < and >.
+ */
+static const char *
+tzName(const char *s, char *abbr, size_t len)
+{
+	const char *e ;
+	size_t	n ;
+
+	if( *s == '<' ) {
+	  if( (e = strchr(++s, '>')) == NULL )
+	    return NULL ;
+	  n = e - s ;
+	  ++e ;
+	}
+	else {
+	  for(e = s; isalpha((unsigned char)*e); ++e) ;
+	  n = e - s ;
+	}
+	if( n < 1 )
+	  return NULL ;
+	if( n >= len )
+	  n = len - 1 ;
+	memcpy(abbr, s, n) ;
+	abbr[n] = '\0' ;
+	return e ;
+}
+
+/**
+ * [+|-]hh[:mm[:ss]], in seconds.
+ */
+static const char *
+tzSeconds(const char *s, int32_t *secs)
+{
+	int	sign = 1, f[3] = {0, 0, 0}, i ;
+
+	if( *s == '+' || *s == '-' )
+	  sign = *s++ == '-' ? -1 : 1 ;
+	for(i = 0; i < 3; ++i) {
+	  if( i > 0 && *s != ':' )
+	    break ;
+	  if( i > 0 )
+	    ++s ;
+	  if( !isdigit((unsigned char)*s) )
+	    return NULL ;
+	  for(; isdigit((unsigned char)*s) && f[i] < 1000; ++s)
+	    f[i] = f[i]*10 + *s - '0' ;
+	}
+	*secs = sign * (f[0]*3600 + f[1]*60 + f[2]) ;
+	return s ;
+}
+
+static const char *
+tzNumber(const char *s, int16_t *n)
+{
+	int	v = 0 ;
+
+	if( !isdigit((unsigned char)*s) )
+	  return NULL ;
+	for(; isdigit((unsigned char)*s) && v < 1000; ++s)
+	  v = v*10 + *s - '0' ;
+	*n = v ;
+	return s ;
+}
+
+/**
+ * Jn, n or Mm.w.d, with an optional /time.
+ */
+static const char *
+tzDate(const char *s, TimeZoneDate *d)
+{
+	if( *s == 'M' ) {
+	  d->kind = 'M' ;
+	  if( (s = tzNumber(s+1, &d->m)) == NULL || *s != '.' ||
+	      (s = tzNumber(s+1, &d->w)) == NULL || *s != '.' ||
+	      (s = tzNumber(s+1, &d->d)) == NULL ||
+	      d->m < 1 || d->m > 12 || d->w < 1 || d->w > 5 || d->d > 6 )
+	    return NULL ;
+	}
+	else {
+	  d->kind = *s == 'J' ? 'J' : 'n' ;
+	  if( *s == 'J' )
+	    ++s ;
+	  if( (s = tzNumber(s, &d->d)) == NULL || d->d > 365 ||
+	      (d->kind == 'J' && d->d < 1) )
+	    return NULL ;
+	}
+	d->secs = 7200 ;
+	if( *s == '/' && (s = tzSeconds(s+1, &d->secs)) == NULL )
+	  return NULL ;
+	return s ;
+}
+
+/**
+ * Add a local time type, or find an identical one.
+ */
+static int
+addType(TimeZone *tz, int32_t offset, int isdst, const char *abbr)
+{
+	TimeZoneType *t ;
+	int	i ;
+
+	for(i = 0; i < tz->ntypes; ++i) {
+	  t = &tz->types[i] ;
+	  if( t->offset == offset && t->isdst == isdst &&
+	      strcmp(t->abbr, abbr) == 0 )
+	    return i ;
+	}
+	if( tz->ntypes >= 256 )
+	  return -1 ;
+	t = &tz->types[tz->ntypes] ;
+	t->offset = offset ;
+	t->isdst = isdst ;
+	snprintf(t->abbr, sizeof(t->abbr), "%s", abbr) ;
+	return tz->ntypes++ ;
+}
+
+/**
+ * Parse a POSIX TZ string such as "CET-1CEST,M3.5.0,M10.5.0/3"
+ * into tz->rule, adding its types to tz->types.
+ * @return 0 on success, -1 if it is not one.
+ */
+static int
+parseRule(const char *s, TimeZone *tz)
+{
+	TimeZoneRule *r = &tz->rule ;
+	char	stdname[16], dstname[16] ;
+	int32_t	off ;
+	int	i ;
+
+	memset(r, 0, sizeof(*r)) ;
+	if( (s = tzName(s, stdname, sizeof(stdname))) == NULL ||
+	    (s = tzSeconds(s, &off)) == NULL )
+	  return -1 ;
+	r->stdoff = -off ;
+	if( *s != '\0' ) {
+	  if( (s = tzName(s, dstname, sizeof(dstname))) == NULL )
+	    return -1 ;
+	  r->dstoff = r->stdoff + 3600 ;
+	  if( *s != ',' && *s != '\0' ) {
+	    if( (s = tzSeconds(s, &off)) == NULL )
+	      return -1 ;
+	    r->dstoff = -off ;
+	  }
+	  if( *s == ',' ) {
+	    if( (s = tzDate(s+1, &r->start)) == NULL || *s != ',' ||
+		(s = tzDate(s+1, &r->end)) == NULL )
+	      return -1 ;
+	  }
+	  else {	/* the old US rules are the POSIX default */
+	    r->start.kind = r->end.kind = 'M' ;
+	    r->start.m = 4 ; r->start.w = 1 ;
+	    r->end.m = 10 ; r->end.w = 5 ;
+	    r->start.secs = r->end.secs = 7200 ;
+	  }
+	  r->hasdst = 1 ;
+	}
+	if( *s != '\0' )
+	  return -1 ;
+
+	if( (i = addType(tz, r->stdoff, 0, stdname)) < 0 )
+	  return -1 ;
+	r->stdtype = i ;
+	if( r->hasdst ) {
+	  if( (i = addType(tz, r->dstoff, 1, dstname)) < 0 )
+	    return -1 ;
+	  r->dsttype = i ;
+	}
+	return 0 ;
+}
+
+/**
+ * Local midnight starting a rule date in year y, days since 1970,
+ * plus the time of day.
+ */
+static int64_t
+ruleLocal(const TimeZoneDate *d, int y)
+{
+	static const int mdays[12] = {31,28,31,30,31,30,31,31,30,31,30,31} ;
+	int64_t	day ;
+	int	wd, md, len ;
+
+	switch( d->kind ) {
+	  case 'J':
+	    day = unixDays(y, 1, 1) + d->d - 1 +
+		(isLeap(y) && d->d >= 60) ;
+	    break ;
+	  case 'n':
+	    day = unixDays(y, 1, 1) + d->d ;
+	    break ;
+	  default:
+	    day = unixDays(y, d->m, 1) ;
+	    wd = (int)((day % 7 + 11) % 7) ;	/* 1970-01-01 was a Thursday */
+	    md = (d->d - wd + 7) % 7 + 7*(d->w - 1) ;
+	    len = mdays[d->m-1] + (d->m == 2 && isLeap(y)) ;
+	    while( md >= len )
+	      md -= 7 ;
+	    day += md ;
+	    break ;
+	}
+	return day * 86400 + d->secs ;
+}
+
+/**
+ * UTC of the start and end of daylight saving in year y.
+ */
+static void
+ruleYear(const TimeZoneRule *r, int y, int64_t *start, int64_t *end)
+{
+	*start = ruleLocal(&r->start, y) - r->stdoff ;
+	*end = ruleLocal(&r->end, y) - r->dstoff ;
+}
+
+static int
+ruleType(const TimeZoneRule *r, int64_t t)
+{
+	int64_t	start, end ;
+	int	y, m, d ;
+
+	if( !r->hasdst )
+	  return r->stdtype ;
+	julian2date(JDUnix + floorDiv(t, 86400) + .5, &y, &m, &d) ;
+	ruleYear(r, y, &start, &end) ;
+	if( start < end )
+	  return t >= start && t < end ? r->dsttype : r->stdtype ;
+	return t >= end && t < start ? r->stdtype : r->dsttype ;
+}
+
+
+	/* loading */
+
+static int
+addTransition(TimeZone *tz, int64_t when, int type, int *alloc)
+{
+	if( tz->n > 0 && tz->type[tz->n-1] == type )
+	  return 0 ;
+	if( tz->n >= *alloc ) {
+	  int64_t *w ;
+	  uint8_t *t ;
+	  *alloc = *alloc * 2 + 64 ;
+	  if( (w = realloc(tz->when, *alloc * sizeof(*w))) == NULL )
+	    return -1 ;
+	  tz->when = w ;
+	  if( (t = realloc(tz->type, *alloc)) == NULL )
+	    return -1 ;
+	  tz->type = t ;
+	}
+	tz->when[tz->n] = when ;
+	tz->type[tz->n++] = type ;
+	return 0 ;
+}
+
+/**
+ * Continue the transitions from the rule through TZ_HORIZON, then
+ * build the index.
+ */
+static int
+finishZone(TimeZone *tz, int *alloc)
+{
+	const TimeZoneRule *r = &tz->rule ;
+	int64_t	s, e, last, span ;
+	int	y, m, d, i, j ;
+
+	if( r->hasdst ) {
+	  y = 1970 ;
+	  if( tz->n > 0 )
+	    julian2date(JDUnix + floorDiv(tz->when[tz->n-1], 86400) + .5,
+		&y, &m, &d) ;
+	  for(; y <= TZ_HORIZON; ++y) {
+	    ruleYear(r, y, &s, &e) ;
+	    last = tz->n > 0 ? tz->when[tz->n-1] : INT64_MIN ;
+	    if( s < e ) {
+	      if( (s > last && addTransition(tz, s, r->dsttype, alloc) < 0) ||
+		  (e > last && addTransition(tz, e, r->stdtype, alloc) < 0) )
+		return -1 ;
+	    }
+	    else {
+	      if( (e > last && addTransition(tz, e, r->stdtype, alloc) < 0) ||
+		  (s > last && addTransition(tz, s, r->dsttype, alloc) < 0) )
+		return -1 ;
+	    }
+	  }
+	}
+
+	/* The index starts above TZ_FLOOR, skipping the -2^59 "big bang"
+	 * transition of RFC 8536 files. */
+	tz->nindex = 0 ;
+	if( tz->n == 0 )
+	  return 0 ;
+	for(j = 0; j+1 < tz->n && tz->when[j] < TZ_FLOOR; ++j)
+	  ;
+	tz->index0 = tz->when[j] ;
+	span = tz->when[tz->n-1] - tz->index0 ;
+	if( (span >> TZ_SHIFT) >= TZ_MAXINDEX ) {
+	  fprintf(stderr, "%s: transitions span too long\n", tz->name) ;
+	  return -1 ;
+	}
+	tz->nindex = (int)(span >> TZ_SHIFT) + 1 ;
+	if( (tz->index = malloc(tz->nindex * sizeof(*tz->index))) == NULL )
+	  return -1 ;
+	for(i = j = 0; i < tz->nindex; ++i) {
+	  int64_t t = tz->index0 + ((int64_t)i << TZ_SHIFT) ;
+	  while( j+1 < tz->n && tz->when[j+1] <= t )
+	    ++j ;
+	  tz->index[i] = j ;
+	}
+	return 0 ;
+}
+
+/**
+ * Read the TZif data in buf.  Version 2 and later files repeat the
+ * data with 64-bit times, followed by the POSIX TZ rule.
+ */
+static int
+parseTZif(const unsigned char *buf, size_t len, TimeZone *tz, int *alloc)
+{
+	const unsigned char *p = buf, *end = buf + len ;
+	uint32_t isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt, i ;
+	const unsigned char *times, *idx, *types, *chars ;
+	int	tsize = 4, v2 = 0 ;
+	size_t	need ;
+	char	rule[128] ;
+
+	for(;;) {
+	  if( end - p < 44 || memcmp(p, "TZif", 4) != 0 )
+	    return -1 ;
+	  isutcnt = get32(p+20) ; isstdcnt = get32(p+24) ;
+	  leapcnt = get32(p+28) ; timecnt = get32(p+32) ;
+	  typecnt = get32(p+36) ; charcnt = get32(p+40) ;
+	  need = (size_t)timecnt * (tsize+1) + typecnt * 6 + charcnt +
+		leapcnt * (tsize+4) + isstdcnt + isutcnt ;
+	  if( typecnt < 1 || typecnt > 256 || charcnt < 1 ||
+	      need > (size_t)(end - p - 44) )
+	    return -1 ;
+	  if( p[4] < '2' || v2 )
+	    break ;
+	  p += 44 + need ;		/* skip to the 64-bit data */
+	  tsize = 8 ;
+	  v2 = 1 ;
+	}
+	times = p + 44 ;
+	idx = times + (size_t)timecnt * tsize ;
+	types = idx + timecnt ;
+	chars = types + typecnt * 6 ;
+
+	for(i = 0; i < typecnt; ++i) {
+	  const unsigned char *t = types + 6*i ;
+	  TimeZoneType *tt = &tz->types[i] ;
+	  uint32_t c = t[5] ;
+	  tt->offset = (int32_t)get32(t) ;
+	  tt->isdst = t[4] ;
+	  if( c >= charcnt )
+	    return -1 ;
+	  snprintf(tt->abbr, sizeof(tt->abbr), "%.*s",
+		(int)strnlen((const char *)chars + c, charcnt - c),
+		(const char *)chars + c) ;
+	}
+	tz->ntypes = typecnt ;
+
+	for(i = 0; i < timecnt; ++i) {
+	  int64_t w = tsize == 8 ? get64(times + 8*i) :
+			(int32_t)get32(times + 4*i) ;
+	  if( idx[i] >= typecnt || (tz->n > 0 && w <= tz->when[tz->n-1]) )
+	    return -1 ;
+	  if( addTransition(tz, w, idx[i], alloc) < 0 )
+	    return -1 ;
+	}
+
+	p = times + need ;
+	if( v2 && p < end && *p == '\n' ) {
+	  const unsigned char *e = memchr(p+1, '\n', end - p - 1) ;
+	  if( e != NULL && e - p - 1 > 0 && (size_t)(e - p - 1) < sizeof(rule) ) {
+	    memcpy(rule, p+1, e - p - 1) ;
+	    rule[e - p - 1] = '\0' ;
+	    if( parseRule(rule, tz) < 0 )
+	      memset(&tz->rule, 0, sizeof(tz->rule)) ;
+	  }
+	}
+	if( !tz->rule.hasdst ) {
+	  /* without a rule the last type continues */
+	  tz->rule.stdtype = tz->n > 0 ? tz->type[tz->n-1] : 0 ;
+	  tz->rule.stdoff = tz->types[tz->rule.stdtype].offset ;
+	}
+	return 0 ;
+}
+
+
+/**
+ * Load a time zone.  name is a zone from the zoneinfo directory
+ * ($TZDIR, or /usr/share/zoneinfo), e.g. "America/New_York"; the
+ * path of a TZif file; or a POSIX TZ string, e.g. "EST5EDT,M3.2.0,
+ * M11.1.0".  NULL means $TZ, or else /etc/localtime.  Times are
+ * those of the "posix" zones; the leap-second "right" zones are not
+ * supported.
+ * @return 0 on success, -1 on error.
+ */
+int
+LoadTimeZone(const char *name, TimeZone *tz)
+{
+	char	path[1024] ;
+	const char *dir ;
+	unsigned char *buf ;
+	FILE	*ifile = NULL ;
+	size_t	len ;
+	int	alloc = 0, rval ;
+
+	memset(tz, 0, sizeof(*tz)) ;
+	if( (tz->types = calloc(256, sizeof(*tz->types))) == NULL )
+	  return -1 ;
+
+	if( name == NULL || *name == '\0' )
+	  name = getenv("TZ") ;
+	if( name == NULL || *name == '\0' )
+	  name = TZ_DEFAULT ;
+	if( *name == ':' )
+	  ++name ;
+	snprintf(tz->name, sizeof(tz->name), "%s", name) ;
+
+	if( *name == '/' )
+	  snprintf(path, sizeof(path), "%s", name) ;
+	else {
+	  if( (dir = getenv("TZDIR")) == NULL )
+	    dir = TZ_DIR ;
+	  snprintf(path, sizeof(path), "%s/%s", dir, name) ;
+	}
+	if( strstr(name, "..") == NULL )
+	  ifile = fopen(path, "r") ;
+
+	if( ifile == NULL ) {
+	  rval = parseRule(name, tz) ;
+	  if( rval < 0 )
+	    fprintf(stderr, "%s: unknown time zone\n", name) ;
+	}
+	else {
+	  if( (buf = malloc(TZ_MAXFILE)) == NULL ) {
+	    fclose(ifile) ;
+	    FreeTimeZone(tz) ;
+	    return -1 ;
+	  }
+	  len = fread(buf, 1, TZ_MAXFILE, ifile) ;
+	  fclose(ifile) ;
+	  rval = parseTZif(buf, len, tz, &alloc) ;
+	  free(buf) ;
+	  if( rval < 0 )
+	    fprintf(stderr, "%s: not a time zone file\n", path) ;
+	}
+	if( rval == 0 )
+	  rval = finishZone(tz, &alloc) ;
+	if( rval < 0 ) {
+	  FreeTimeZone(tz) ;
+	  return -1 ;
+	}
+	return 0 ;
+}
+
+
+void
+FreeTimeZone(TimeZone *tz)
+{
+	free(tz->when) ;
+	free(tz->type) ;
+	free(tz->types) ;
+	free(tz->index) ;
+	memset(tz, 0, sizeof(*tz)) ;
+}
+
+
+/**
+ * Local time type in force at Unix time t.
+ */
+static inline const TimeZoneType *
+zoneType(const TimeZone *tz, int64_t t)
+{
+	int64_t	k ;
+	int	i ;
+
+	if( tz->n == 0 || t < tz->when[0] )
+	  return &tz->types[tz->n == 0 ? tz->rule.stdtype : 0] ;
+	if( t >= tz->when[tz->n-1] )
+	  return &tz->types[ruleType(&tz->rule, t)] ;
+	if( t < tz->index0 )
+	  i = 0 ;
+	else {
+	  k = (t - tz->index0) >> TZ_SHIFT ;
+	  i = tz->index[k < tz->nindex ? k : tz->nindex - 1] ;
+	}
+	while( tz->when[i+1] <= t )
+	  ++i ;
+	return &tz->types[tz->type[i]] ;
+}
+
+/**
+ * Unix time of a Julian date, in whole seconds.  A double carries a
+ * current date to about 40 microseconds, so a time that should fall
+ * on a whole second may come out just short of it; anything within
+ * half a millisecond is taken as the second.
+ */
+static inline int
+unixTime(double jd, int64_t *t)
+{
+	double	s = (jd - JDUnix) * 86400. ;
+
+	if( !(fabs(s) < 1e15) )
+	  return 0 ;
+	*t = (int64_t)floor(s + 5e-4) ;
+	return 1 ;
+}
+
+static inline int32_t
+offsetAt(const TimeZone *tz, int64_t t)
+{
+	return zoneType(tz, t)->offset ;
+}
+
+/**
+ * Seconds to subtract from local Unix time l to get UTC.  Local times
+ * that occur twice, when the clocks go back, are taken as the
+ * earlier; times skipped when they go forward are read with the
+ * offset before the change.
+ */
+static inline int32_t
+localOffset(const TimeZone *tz, int64_t l)
+{
+	int32_t	a = offsetAt(tz, l - 86400), b ;
+
+	if( offsetAt(tz, l - a) == a )
+	  return a ;
+	b = offsetAt(tz, l + 86400) ;
+	if( offsetAt(tz, l - b) == b )
+	  return b ;
+	return a ;
+}
+
+
+/**
+ * Local time - UTC, in seconds, at UTC Julian date jd.
+ */
+int
+tzOffset(const TimeZone *tz, double jd)
+{
+	int64_t	t ;
+	return unixTime(jd, &t) ? offsetAt(tz, t) : 0 ;
+}
+
+/**
+ * Abbreviation of the local time in use at UTC Julian date jd.
+ */
+const char *
+tzAbbrev(const TimeZone *tz, double jd)
+{
+	int64_t	t ;
+	return zoneType(tz, unixTime(jd, &t) ? t : 0)->abbr ;
+}
+
+double
+utc2local(const TimeZone *tz, double jd)
+{
+	int64_t	t ;
+	return unixTime(jd, &t) ? jd + offsetAt(tz, t) / 86400. : jd ;
+}
+
+double
+local2utc(const TimeZone *tz, double jd)
+{
+	int64_t	t ;
+	return unixTime(jd, &t) ? jd - localOffset(tz, t) / 86400. : jd ;
+}
+
+/**
+ * Convert n UTC Julian dates to local time.  out may be the same
+ * array as jd.
+ */
+void
+utc2local_n(const TimeZone *tz, int n, const double *jd, double *out)
+{
+	int	i ;
+	for(i = 0; i < n; ++i)
+	  out[i] = utc2local(tz, jd[i]) ;
+}
+
+/**
+ * Convert n local Julian dates to UTC.  out may be the same array
+ * as jd.
+ */
+void
+local2utc_n(const TimeZone *tz, int n, const double *jd, double *out)
+{
+	int	i ;
+	for(i = 0; i < n; ++i)
+	  out[i] = local2utc(tz, jd[i]) ;
+}
@@ -0,0 +1,319 @@
+	/* Read the Tycho-2 and Hipparcos star catalogs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Both catalogs are available from CDS as fixed-width text files with
+ * '|' between the fields:
+ *
+ *   Tycho-2, I/259, "tyc2.dat", 2.5 million stars.
+ *	https://cdsarc.cds.unistra.fr/viz-bin/cat/I/259
+ *	Mean positions are ICRS, epoch J2000.  A few stars have no mean
+ *	position (pflag = 'X'); for those we use the observed position.
+ *
+ *   Hipparcos, I/239, "hip_main.dat", 118,000 stars.
+ *	https://cdsarc.cds.unistra.fr/viz-bin/cat/I/239
+ *	Positions are ICRS at epoch J1991.25; we move them to J2000.
+ *
+ * The readers append to a StarCatalog, so several files (or both
+ * catalogs) can be combined before calling StarCatalogIndex().
+ * Tycho-2 is parsed on several threads (see chunks.c), but loading
+ * the text is still slow; the intent is that it is done once,
+ * offline, and the result saved with StarCatalogWrite().  Compile this
+ * file with -DSTANDALONE to get a program that does exactly that.
+ */
+
+#define	MAXFIELDS	80
+
+/**
+ * Split a line into '|' separated fields, in place.
+ * @return number of fields
+ */
+static int
+splitFields(char *line, char **fields)
+{
+	int	n = 0 ;
+
+	fields[n++] = line ;
+	while( (line = strchr(line, '|')) != NULL && n < MAXFIELDS ) {
+	  *line++ = '\0' ;
+	  fields[n++] = line ;
+	}
+	return n ;
+}
+
+static int
+blank(const char *field)
+{
+	return field[strspn(field, " \n")] == '\0' ;
+}
+
+
+/**
+ * Parse one tyc2.dat record.
+ * @return 1 if the star is maxmag or brighter, else 0.
+ */
+static int
+tychoParse(char *line, float maxmag, CompactStar *c)
+{
+	char	*f[MAXFIELDS] ;
+	Star	s ;
+	int	t1,t2,t3 ;
+	double bt, vt ;
+
+	if( splitFields(line, f) < 32 ||
+	    sscanf(f[0], "%d %d %d", &t1, &t2, &t3) != 3 )
+	  return 0 ;
+
+	bt = blank(f[17]) ? 99. : atof(f[17]) ;
+	vt = blank(f[19]) ? 99. : atof(f[19]) ;
+	if( vt < 99. && bt < 99. )
+	  s.mag = vt - 0.090 * (bt - vt) ;
+	else
+	  s.mag = vt < bt ? vt : bt ;
+	if( s.mag > maxmag )
+	  return 0 ;
+
+	if( f[1][0] == 'X' ) {
+	  s.ra = atof(f[24]) ;
+	  s.dec = atof(f[25]) ;
+	  s.pmr = s.pmd = 0. ;
+	} else {
+	  s.ra = atof(f[2]) ;
+	  s.dec = atof(f[3]) ;
+	  s.pmr = atof(f[4]) * .001 ;
+	  s.pmd = atof(f[5]) * .001 ;
+	}
+	s.epoch = 2000 ;
+	strcpy(s.type, blank(f[23]+6) ? "SS" : "SD") ;
+	s.spec[0] = s.spec[1] = '\0' ;
+
+	compactStar(&s, c) ;
+	c->cat = TYC_NUMBER(t1, t2, t3) ;
+	return 1 ;
+}
+
+static int
+tychoChunk(TextChunk *chunk, void *arg)
+{
+	float	maxmag = *(float *)arg ;
+	char	line[256] ;
+	const char *ptr = chunk->start ;
+	CompactStar *stars = NULL, *c ;
+	int	nalloc = 0 ;
+
+	while( textLine(&ptr, chunk->end, line, sizeof(line)) != NULL )
+	{
+	  if( chunk->count >= nalloc ) {
+	    nalloc = nalloc > 0 ? nalloc*2 : 4096 ;
+	    if( (c = realloc(stars, nalloc*sizeof(*c))) == NULL ) {
+	      free(stars) ;
+	      chunk->count = 0 ;
+	      return 1 ;
+	    }
+	    stars = c ;
+	  }
+	  chunk->count += tychoParse(line, maxmag, &stars[chunk->count]) ;
+	}
+	chunk->data = stars ;
+	return 0 ;
+}
+
+
+/**
+ * Read the Tycho-2 main catalog, appending stars of magnitude maxmag
+ * or brighter to cat.  Tycho magnitudes are converted to Johnson V.
+ * Catalog numbers are packed with TYC_NUMBER().
+ *
+ * The file is mapped and parsed in chunks on numThreads() threads;
+ * stars are added in file order.
+ *
+ * @return number of stars added, or -1 on error.
+ */
+int
+ReadTycho2Catalog(const char *filename, float maxmag, StarCatalog *cat)
+{
+	const char *text ;
+	size_t	size ;
+	TextChunk *chunks ;
+	int	nthreads = numThreads() ;
+	int	n, i, j ;
+	int	count = 0 ;
+
+	if( filename == NULL )
+	  filename = "tyc2.dat" ;
+
+	if( (text = mapTextFile(filename, &size)) == NULL )
+	  return -1 ;
+	if( (chunks = malloc(nthreads*4 * sizeof(*chunks))) == NULL ) {
+	  unmapTextFile(text, size) ;
+	  return -1 ;
+	}
+	n = splitTextChunks(text, size, nthreads*4, chunks) ;
+
+	if( runTextChunks(chunks, n, nthreads, tychoChunk, &maxmag) < 0 )
+	  count = -1 ;
+	for(i = 0; i < n; ++i)
+	{
+	  const CompactStar *c = chunks[i].data ;
+	  for(j = 0; count >= 0 && j < chunks[i].count; ++j)
+	    if( StarCatalogAdd(cat, &c[j], 0, NULL) < 0 )
+	      count = -1 ;
+	    else
+	      ++count ;
+	  free(chunks[i].data) ;
+	}
+
+	free(chunks) ;
+	unmapTextFile(text, size) ;
+	return count ;
+}
+
+
+/**
+ * Read the Hipparcos main catalog, appending stars of magnitude maxmag
+ * or brighter to cat.  Positions are moved from J1991.25 to J2000.
+ * Catalog numbers are HIP numbers.
+ *
+ * @return number of stars added, or -1 on error.
+ */
+int
+ReadHipparcosCatalog(const char *filename, float maxmag, StarCatalog *cat)
+{
+	char	line[1024] ;
+	char	*f[MAXFIELDS] ;
+	FILE	*ifile ;
+	int	count = 0 ;
+
+	if( filename == NULL )
+	  filename = "hip_main.dat" ;
+
+	if( (ifile = fopen(filename, "r")) == NULL ) {
+	  perror(filename) ;
+	  return -1 ;
+	}
+
+	while( fgets(line, sizeof(line), ifile) != NULL )
+	{
+	  Star	s ;
+	  CompactStar c ;
+	  double plx ;
+
+	  if( splitFields(line, f) < 77 || blank(f[8]) || blank(f[5]) )
+	    continue ;
+
+	  s.mag = atof(f[5]) ;
+	  if( s.mag > maxmag )
+	    continue ;
+
+	  s.ra = atof(f[8]) ;
+	  s.dec = atof(f[9]) ;
+	  plx = atof(f[11]) * .001 ;
+	  s.pmr = atof(f[12]) * .001 ;
+	  s.pmd = atof(f[13]) * .001 ;
+	  propagateStars(1, &s.ra, &s.dec, &s.pmr, &s.pmd, &plx, NULL,
+		2000. - 1991.25, &s.ra, &s.dec) ;
+	  s.epoch = 2000 ;
+	  strcpy(s.type, "SS") ;
+	  s.spec[0] = f[76][strspn(f[76], " ")] ;
+	  s.spec[1] = '\0' ;
+
+	  compactStar(&s, &c) ;
+	  c.cat = atol(f[1]) ;
+	  if( StarCatalogAdd(cat, &c, 0, NULL) < 0 ) {
+	    fclose(ifile) ;
+	    return -1 ;
+	  }
+	  ++count ;
+	}
+
+	fclose(ifile) ;
+	return count ;
+}
+
+
+#ifdef STANDALONE
+
+#include <time.h>
+
+static	char	usage[] =
+"tycho - build a binary star catalog from Tycho-2, Hipparcos or OpenNGC\n"
+"\n"
+"  usage:  tycho [options] input... output.cat\n"
+"	-T	following inputs are Tycho-2 tyc2.dat (the default)\n"
+"	-H	following inputs are Hipparcos hip_main.dat\n"
+"	-D	following inputs are OpenNGC NGC.csv or addendum.csv\n"
+"	-m mag	faintest magnitude to keep\n"
+"\n"
+"	e.g. tycho -m 10 tyc2.dat -D NGC.csv addendum.csv sky.cat\n"
+;
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+int
+main(int argc, char **argv)
+{
+	StarCatalog cat ;
+	float	maxmag = 99. ;
+	int	format = 'T' ;
+	int	ninputs = 0 ;
+	double	t0 ;
+
+	memset(&cat, 0, sizeof(cat)) ;
+	t0 = now() ;
+	for(; --argc > 0; ++ninputs)
+	{
+	  int	n ;
+	  ++argv ;
+	  if( strcmp(*argv, "-T") == 0 || strcmp(*argv, "-H") == 0 ||
+	      strcmp(*argv, "-D") == 0 ) {
+	    format = argv[0][1] ;
+	    --ninputs ;
+	    continue ;
+	  }
+	  if( strcmp(*argv, "-m") == 0 && argc > 1 ) {
+	    --argc, maxmag = atof(*++argv) ;
+	    --ninputs ;
+	    continue ;
+	  }
+	  if( **argv == '-' || argc == 1 )
+	    break ;
+	  n = format == 'H' ? ReadHipparcosCatalog(*argv, maxmag, &cat) :
+	      format == 'D' ? ReadOpenNGC(*argv, maxmag, &cat) :
+			      ReadTycho2Catalog(*argv, maxmag, &cat) ;
+	  if( n < 0 )
+	    exit(1) ;
+	  fprintf(stderr, "%s: %d %s\n", *argv, n,
+		format == 'D' ? "objects" : "stars") ;
+	}
+	if( argc != 1 || ninputs == 0 ) {
+	  fputs(usage, stderr) ;
+	  exit(2) ;
+	}
+	fprintf(stderr, "read %d records in %.2f s\n", cat.count, now()-t0) ;
+
+	t0 = now() ;
+	if( StarCatalogIndex(&cat) < 0 ) {
+	  fprintf(stderr, "out of memory\n") ;
+	  exit(1) ;
+	}
+	fprintf(stderr, "indexed in %.2f s\n", now()-t0) ;
+
+	if( StarCatalogWrite(&cat, *argv) < 0 )
+	  exit(1) ;
+
+	FreeStarCatalog(&cat) ;
+	exit(0) ;
+}
+#endif	/* STANDALONE */
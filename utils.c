@@ -11,21 +11,16 @@
 
 
 /**
- * convert hours to "hh:mm:ss.ssss"
+ * convert hours to "hh:mm:ss.ssssss"
  * Returns a buffer that will become invalid the next time this
- * function is called. Not thread-safe.
+ * function is called in the same thread; see convertHms_r().
  */
 const char *
 convertHms(double hours)
 {
-static	char	obuf[80] ;
+static	__thread char	obuf[FMT_BUFSIZE] ;
 
-	int	h,m ;
-	double	s ;
-
-	h2hms(hours, &h,&m,&s) ;
-	snprintf(obuf, sizeof(obuf), "%d:%2.2d:%f", h,m,s) ;
-	return obuf ;
+	return convertHms_r(hours, obuf) ;
 }
 
 
@@ -106,39 +101,6 @@ deltaPolar(lat1,lon1,r1, lat2,lon2,r2, lat3,lon3,r3)
 }
 
 
-/**
- * Return a % 360
- */
-double
-limitAngle(double a)
-{
-  if( a >= 360 ) {
-    int ia = a;
-    a -= ia;
-    return ia % 360 + a;
-  } else if( a < 0 ) {
-    return 360 - limitAngle(-a);
-  }
-  return a;
-}
-
-
-/**
- * Return h % 24
- */
-double
-limitHour(double h)
-{
-  if( h >= 24 ) {
-    int ih = h;
-    h -= ih;
-    return ih % 24 + h;
-  } else if( h < 0 ) {
-    return 24 - limitHour(-h);
-  }
-  return h;
-}
-
 /**
  * Extract a float field from the given buffer
  * @param buffer - buffer to extract the field from
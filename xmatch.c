@@ -0,0 +1,400 @@
+	/* Cross-match two star catalogs by position */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "astro.h"
+
+/*
+ * Joining catalogs by SAO number only works for the stars that have
+ * one, so the general way to pair up two catalogs is by position:
+ * each star of catalog a is matched with the stars of catalog b
+ * within some radius.
+ *
+ * Catalog b must be indexed (StarCatalogIndex()); for each star of a,
+ * only the b records in the sky cells around it are examined.  Make
+ * b the larger of the two catalogs.  The b records of a cell are
+ * contiguous, so the unit vectors of b are laid out as three
+ * parallel arrays in record order and the distance test for a run
+ * of cells is one simple loop, which the compiler vectorizes.  The
+ * test is on the chord between the unit vectors, which unlike the
+ * dot product keeps full precision at arcsecond separations.
+ *
+ * The stars of a are divided into blocks which are matched on a
+ * pool of threads.
+ *
+ * int
+ * StarCatalogMatch(const StarCatalog *a, const StarCatalog *b,
+ *		double radius, int nthreads, int *best, double *sep)
+ *	For each star of a, find the nearest star of b.
+ *
+ * int
+ * StarCatalogMatchAll(const StarCatalog *a, const StarCatalog *b,
+ *		double radius, int nthreads, StarMatch **rval)
+ *	Find every pair of stars within radius.
+ */
+
+typedef struct {
+	  const StarCatalog *a, *b ;
+	  double *x, *y, *z ;		/* unit vectors of b, record order */
+	  double radius ;		/* degrees */
+	  double maxchord2 ;		/* squared chord of radius */
+	  int	block ;			/* stars of a per chunk */
+	  int	*best ;			/* StarCatalogMatch() results */
+	  double *sep ;
+	} MatchJob ;
+
+
+/**
+ * Squared chord from (ax,ay,az) to each of n unit vectors.
+ */
+static void
+chordKernel(const double *x, const double *y, const double *z, int n,
+	double ax, double ay, double az, double *c2)
+{
+	int	i ;
+	for(i=0; i < n; ++i) {
+	  double dx = x[i]-ax, dy = y[i]-ay, dz = z[i]-az ;
+	  c2[i] = dx*dx + dy*dy + dz*dz ;
+	}
+}
+
+static double
+chord2sep(double c2)
+{
+	return 2. * asin(sqrt(c2) * .5) * DEG * 3600. ;
+}
+
+/**
+ * Find the record ranges of b that could hold matches for a star.
+ */
+static int
+matchRanges(const MatchJob *job, double ra, double dec, int *ranges)
+{
+	double	r = job->radius ;
+	double	d0 = dec - r, d1 = dec + r ;
+	double	w ;
+
+	if( d0 <= -90. || d1 >= 90. )
+	  return StarCatalogRanges(job->b, 0., 360., d0, d1, ranges) ;
+	w = r / cosd(fabs(d0) > fabs(d1) ? d0 : d1) ;
+	if( w >= 180. )
+	  return StarCatalogRanges(job->b, 0., 360., d0, d1, ranges) ;
+	return StarCatalogRanges(job->b, limitAngle(ra - w), limitAngle(ra + w),
+		d0, d1, ranges) ;
+}
+
+static int
+cmpMatch(const void *p1, const void *p2)
+{
+	const StarMatch *m1 = p1, *m2 = p2 ;
+	return m1->sep < m2->sep ? -1 : m1->sep > m2->sep ;
+}
+
+/**
+ * Match one block of a.  With job->best set, records the nearest
+ * star for each; otherwise collects every pair in chunk->data.
+ */
+static int
+matchChunk(TextChunk *chunk, void *arg)
+{
+	const MatchJob *job = arg ;
+	int	ranges[4*CAT_ZONES] ;
+	double	*c2 = NULL ;
+	int	c2size = 0 ;
+	StarMatch *matches = NULL, *m ;
+	int	nalloc = 0 ;
+	int	i0 = chunk->index * job->block ;
+	int	i1 = i0 + job->block ;
+	int	i, r, k, nr ;
+
+	if( i1 > job->a->count )
+	  i1 = job->a->count ;
+
+	for(i = i0; i < i1; ++i)
+	{
+	  const CompactStar *s = &job->a->stars[i] ;
+	  double ra = s->ra / CU_PER_DEG, dec = s->dec / CU_PER_DEG ;
+	  double ax = cosd(dec)*cosd(ra), ay = cosd(dec)*sind(ra), az = sind(dec) ;
+	  double bestc2 = job->maxchord2 ;
+	  int	best = -1 ;
+	  int	first = chunk->count ;
+
+	  nr = matchRanges(job, ra, dec, ranges) ;
+	  for(r = 0; r < nr; ++r)
+	  {
+	    int b0 = ranges[2*r], n = ranges[2*r+1] - b0 ;
+	    if( n > c2size ) {
+	      double *p ;
+	      c2size = n > 2*c2size ? n : 2*c2size ;
+	      if( (p = realloc(c2, c2size * sizeof(*c2))) == NULL )
+		goto fail ;
+	      c2 = p ;
+	    }
+	    chordKernel(job->x + b0, job->y + b0, job->z + b0, n, ax,ay,az, c2) ;
+
+	    for(k = 0; k < n; ++k)
+	    {
+	      if( c2[k] > job->maxchord2 )
+		continue ;
+	      if( job->best != NULL ) {
+		if( c2[k] < bestc2 || best < 0 ) {
+		  bestc2 = c2[k] ;
+		  best = b0 + k ;
+		}
+		continue ;
+	      }
+	      if( chunk->count >= nalloc ) {
+		nalloc = nalloc > 0 ? nalloc*2 : 1024 ;
+		if( (m = realloc(matches, nalloc * sizeof(*m))) == NULL )
+		  goto fail ;
+		matches = m ;
+	      }
+	      m = &matches[chunk->count++] ;
+	      m->a = i ;
+	      m->b = b0 + k ;
+	      m->sep = chord2sep(c2[k]) ;
+	    }
+	  }
+
+	  if( job->best != NULL ) {
+	    job->best[i] = best ;
+	    if( job->sep != NULL )
+	      job->sep[i] = best >= 0 ? chord2sep(bestc2) : 0. ;
+	  }
+	  else if( chunk->count - first > 1 )
+	    qsort(matches + first, chunk->count - first, sizeof(*m), cmpMatch) ;
+	}
+
+	free(c2) ;
+	chunk->data = matches ;
+	return 0 ;
+
+fail:
+	free(c2) ;
+	free(matches) ;
+	chunk->count = 0 ;
+	return 1 ;
+}
+
+
+/**
+ * Common driver: set up the unit vectors of b and run matchChunk()
+ * over blocks of a.  Returns the chunks, or NULL on error.
+ */
+static TextChunk *
+runMatch(MatchJob *job, int nthreads, int *nchunks)
+{
+	const StarCatalog *b = job->b ;
+	TextChunk *chunks ;
+	double	r = job->radius * RAD ;
+	int	i, n ;
+
+	if( b->cells == NULL )
+	  return NULL ;
+	if( nthreads <= 0 )
+	  nthreads = numThreads() ;
+
+	job->maxchord2 = 4. * sin(r/2.) * sin(r/2.) ;
+	job->x = malloc((b->count > 0 ? b->count : 1) * 3 * sizeof(double)) ;
+	if( job->x == NULL )
+	  return NULL ;
+	job->y = job->x + b->count ;
+	job->z = job->y + b->count ;
+	for(i=0; i < b->count; ++i) {
+	  double ra = b->stars[i].ra / CU_PER_DEG ;
+	  double dec = b->stars[i].dec / CU_PER_DEG ;
+	  job->x[i] = cosd(dec)*cosd(ra) ;
+	  job->y[i] = cosd(dec)*sind(ra) ;
+	  job->z[i] = sind(dec) ;
+	}
+
+	/* Several blocks per thread so that dense and sparse parts of
+	 * the sky even out. */
+	job->block = job->a->count / (nthreads*16) + 1 ;
+	if( job->block < 1024 )
+	  job->block = 1024 ;
+	n = (job->a->count + job->block - 1) / job->block ;
+	if( (chunks = calloc(n > 0 ? n : 1, sizeof(*chunks))) == NULL ) {
+	  free(job->x) ;
+	  return NULL ;
+	}
+	for(i=0; i < n; ++i)
+	  chunks[i].index = i ;
+
+	if( runTextChunks(chunks, n, nthreads, matchChunk, job) < 0 ) {
+	  for(i=0; i < n; ++i)
+	    free(chunks[i].data) ;
+	  free(chunks) ;
+	  chunks = NULL ;
+	}
+	free(job->x) ;
+	*nchunks = n ;
+	return chunks ;
+}
+
+
+/**
+ * For each star of a, find the nearest star of b within radius
+ * arcseconds.  b must be indexed.
+ *
+ * @param nthreads - number of threads, 0 for numThreads()
+ * @param best - returned index into b of each star's match, or -1,
+ *		 room for a->count entries
+ * @param sep  - returned separations, arcseconds, or NULL
+ * @return number of stars of a that were matched, or -1 on error
+ */
+int
+StarCatalogMatch(const StarCatalog *a, const StarCatalog *b,
+	double radius, int nthreads, int *best, double *sep)
+{
+	MatchJob job ;
+	TextChunk *chunks ;
+	int	i, n, count = 0 ;
+
+	job.a = a ;
+	job.b = b ;
+	job.radius = radius / 3600. ;
+	job.best = best ;
+	job.sep = sep ;
+	if( (chunks = runMatch(&job, nthreads, &n)) == NULL )
+	  return -1 ;
+	free(chunks) ;
+
+	for(i=0; i < a->count; ++i)
+	  count += best[i] >= 0 ;
+	return count ;
+}
+
+
+/**
+ * Find all pairs of stars of a and b within radius arcseconds of each
+ * other.  b must be indexed.  The pairs are returned in *rval, in
+ * order of the star of a and, for each star of a, nearest first;
+ * free(*rval) when done.
+ *
+ * @param nthreads - number of threads, 0 for numThreads()
+ * @return number of pairs, or -1 on error
+ */
+int
+StarCatalogMatchAll(const StarCatalog *a, const StarCatalog *b,
+	double radius, int nthreads, StarMatch **rval)
+{
+	MatchJob job ;
+	TextChunk *chunks ;
+	StarMatch *ptr ;
+	int	i, n, count = 0 ;
+
+	*rval = NULL ;
+	job.a = a ;
+	job.b = b ;
+	job.radius = radius / 3600. ;
+	job.best = NULL ;
+	job.sep = NULL ;
+	if( (chunks = runMatch(&job, nthreads, &n)) == NULL )
+	  return -1 ;
+
+	for(i=0; i < n; ++i)
+	  count += chunks[i].count ;
+	if( (ptr = malloc((count > 0 ? count : 1) * sizeof(*ptr))) != NULL ) {
+	  *rval = ptr ;
+	  for(i=0; i < n; ptr += chunks[i++].count)
+	    memcpy(ptr, chunks[i].data, chunks[i].count * sizeof(*ptr)) ;
+	}
+	else
+	  count = -1 ;
+
+	for(i=0; i < n; ++i)
+	  free(chunks[i].data) ;
+	free(chunks) ;
+	return count ;
+}
+
+
+#ifdef STANDALONE
+
+/*
+ * Benchmark: match a million stars against a million, where 90% of
+ * the first catalog are the second catalog's stars displaced by up
+ * to an arcsecond, and the rest are random.
+ */
+
+#include <time.h>
+
+static double
+now()
+{
+	struct timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+static void
+randomStar(Star *s)
+{
+	memset(s, 0, sizeof(*s)) ;
+	s->ra = 360. * drand48() ;
+	s->dec = asind(2.*drand48() - 1.) ;
+	s->mag = 12.5 + log10(drand48() + 1e-9) * 2.5 ;
+	s->epoch = 2000 ;
+	strcpy(s->type, "SS") ;
+}
+
+int
+main(int argc, char **argv)
+{
+	StarCatalog a, b ;
+	StarMatch *all ;
+	Star	s ;
+	CompactStar c ;
+	int	n = argc > 1 ? atoi(argv[1]) : 1000000 ;
+	int	nthreads = argc > 2 ? atoi(argv[2]) : 0 ;
+	int	*best, i, good ;
+	double	*sep, t0 ;
+
+	srand48(1) ;
+	memset(&a, 0, sizeof(a)) ;
+	memset(&b, 0, sizeof(b)) ;
+	for(i=0; i < n; ++i) {
+	  randomStar(&s) ;
+	  compactStar(&s, &c) ;
+	  c.cat = i ;
+	  StarCatalogAdd(&b, &c, 0, NULL) ;
+	  if( i % 10 == 0 )
+	    randomStar(&s) ;
+	  else {
+	    s.dec += (drand48() - .5) / 3600. ;
+	    s.ra += (drand48() - .5) / 3600. / cosd(s.dec) ;
+	  }
+	  compactStar(&s, &c) ;
+	  c.cat = i ;
+	  StarCatalogAdd(&a, &c, 0, NULL) ;
+	}
+	t0 = now() ;
+	StarCatalogIndex(&b) ;
+	printf("%d x %d stars, indexed in %.3f s\n", n, n, now()-t0) ;
+
+	best = malloc(n * sizeof(*best)) ;
+	sep = malloc(n * sizeof(*sep)) ;
+	t0 = now() ;
+	i = StarCatalogMatch(&a, &b, 2., nthreads, best, sep) ;
+	printf("best match, 2\": %d matched in %.3f s\n", i, now()-t0) ;
+	for(i=0, good=0; i < n; ++i)
+	  good += best[i] >= 0 && b.stars[best[i]].cat == a.stars[i].cat ;
+	printf("  %d matched the star they came from\n", good) ;
+
+	t0 = now() ;
+	i = StarCatalogMatchAll(&a, &b, 60., nthreads, &all) ;
+	printf("all matches, 60\": %d pairs in %.3f s\n", i, now()-t0) ;
+
+	free(all) ;
+	free(best) ;
+	free(sep) ;
+	FreeStarCatalog(&a) ;
+	FreeStarCatalog(&b) ;
+	exit(0) ;
+}
+#endif	/* STANDALONE */
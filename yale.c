@@ -43,122 +43,193 @@ static void rstrip(char *buf);
  *	ra = ppm/64*10125/2^11
  */
 
+#define	YALE_NAMELEN	121	/* notes text, columns 13-132, plus nul */
+
+/* Sample line:
+ * 1       10        20        30        40        50        60        70        80        90       100       110       120       130       140       150       160       170
+ * |        |         |         |         |         |         |         |         |         |         |         |         |         |         |         |         |         |
+ *  372          BD+44  271   7647 37077    I                  011115.6+442231011705.1+445407127.70-17.73 6.34R                     K5                 +0.014-0.045      -052
+ */
+
+/**
+ * Fill in the constellations of n stars from their positions.
+ * They go through constellationsOf() a block at a time, so the
+ * precession matrix is built once per block, not once per star.
+ */
+static void
+yaleCons(YaleStar *ys, int n)
+{
+	double	ra[STAR_BLOCK], dec[STAR_BLOCK];
+	uint8_t	cons[STAR_BLOCK];
+	int	i, j, nb;
+
+	for (i=0; i < n; i += nb) {
+	    nb = n - i < STAR_BLOCK ? n - i : STAR_BLOCK;
+	    for (j=0; j < nb; ++j) {
+		ra[j] = ys[i+j].s.ra;
+		dec[j] = ys[i+j].s.dec;
+	    }
+	    constellationsOf(nb, ra, dec, JD2000, cons);
+	    for (j=0; j < nb; ++j)
+		if (cons[j] == 0)
+		    ys[i+j].cons[0] = '\0';
+		else
+		    memcpy(ys[i+j].cons, constellations[cons[j]], 3);
+	}
+}
+
+/**
+ * Extract position and magnitude from one bsc5.dat record and apply
+ * the query filter.  Returns nonzero if the star passes.
+ *
+ * A handful of catalog entries (novae, objects found not to be stars)
+ * have no position; these are always rejected.
+ */
+static int
+yaleFilter(const char *datbuf, float maxmag, double ra0, double ra1,
+	double d0, double d1, int wrap, double *rra, double *rdec, double *rmag)
+{
+	long	d,h,m;
+	double	s;
+	double	ra, dec, mag;
+
+	if (datbuf[75] == ' ' && datbuf[76] == ' ')
+	    return 0;
+
+	mag = recFloat(datbuf, 103,107);
+	if (mag > maxmag)
+	    return 0;
+
+	h = recLong(datbuf, 76,77);
+	m = recLong(datbuf, 78,79);
+	s = recFloat(datbuf, 80,83);
+	ra = h*3600 + m*60 + s;
+	ra = ra/3600.*(360/24);
+	d = recLong(datbuf, 85,86);
+	m = recLong(datbuf, 87,88);
+	s = recLong(datbuf, 89,90);
+	dec = d*3600. + m*60. + s;
+	dec /= 3600.;
+	if (datbuf[83] == '-')
+	    dec = -dec;
+
+	if( wrap && ra < ra0 )
+	  ra += 360;
+
+	if (dec < d0 || dec > d1 || ra < ra0 || ra > ra1)
+	    return 0;
+
+	*rra = ra;
+	*rdec = dec;
+	*rmag = mag;
+	return 1;
+}
+
+/**
+ * Open the data file and set up the RA wrap-around for a query.
+ */
+static FILE *
+yaleOpen(const char *datfilename, double ra0, double *ra1, int *wrap)
+{
+	FILE	*dfile;
+
+	if( datfilename == NULL )
+	  datfilename = "bsc5.dat";
+
+	if( (dfile = fopen(datfilename, "r")) == NULL ) {
+	  perror(datfilename);
+	  return NULL;
+	}
+
+	*wrap = *ra1 < ra0;
+	if( *wrap )
+	    *ra1 += 360;
+	return dfile;
+}
+
 /**
  * Read the Yale Star Catalog (aka Bright Star Catalog) or a
- * portion thereof.
+ * portion thereof, passing matching stars to a callback one block
+ * at a time.  Memory use is bounded by STAR_BLOCK records no matter
+ * how many stars match.
  *
  * @param maxmag - maximum magnitude
  * @param ra0,ra1 - right ascension bounds
  * @param d0,d1   - declination bounds
  * @param datfile - data filename, NULL defaults to "bsc5.dat"
  * @param notefile - notes filename, NULL defaults to "bsc5.notes"
- * @param rval     - returned array of YaleStar structs
- * @param recsize  - returned size of one struct
+ * @param visit    - callback, see YaleStarVisitor in astro.h
+ * @param arg      - passed through to visit
  *
- * @return number of structs returned in rval
+ * @return number of stars passed to visit, or -1 if either file
+ * could not be opened.
  *
- * Only returns items inside the box defined by ra0,ra1, d0,d1 and
- * with magnitude maxmag or less.
+ * The star names passed to visit live in the same reusable block
+ * as the records; copy them if they need to outlive the callback.
  */
 int
-ReadYaleStars(float maxmag, double ra0, double ra1,
+VisitYaleStars(float maxmag, double ra0, double ra1,
 	double d0, double d1,
 	const char *datfilename,
 	const char *notefilename,
-	YaleStar **rval, size_t *recsize)
+	YaleStarVisitor visit, void *arg)
 {
 	char	datbuf[300];
 	char	notebuf[200];
 	char	tmp[140];
 	FILE	*dfile;		/* data file */
 	FILE	*nfile;		/* notes file */
-	long	idx, nidx, sao;
+	long	idx, nidx;
 	double	ra,dec, mag;
 	int	count = 0;
-	int	nalloc = 256;
-	long	d,h,m;
-	double	s;
+	int	n = 0;
 	int	wrap;
-	YaleStar *ptr;
+	YaleStar *block, *ptr;
+	char	*names;		/* name storage for the current block */
+
+	if( (dfile = yaleOpen(datfilename, ra0, &ra1, &wrap)) == NULL )
+	  return -1;
 
-	if( datfilename == NULL )
-	  datfilename = "bsc5.dat";
 	if( notefilename == NULL )
 	  notefilename = "bsc5.notes";
 
-	if( (dfile = fopen(datfilename, "r")) == NULL ) {
-	  perror(datfilename);
-	  return 0;
-	}
-
 	if( (nfile = fopen(notefilename, "r")) == NULL ) {
 	  perror(notefilename);
 	  fclose(dfile);
-	  return 0;
+	  return -1;
 	}
 
-	*rval = NULL;
-	ptr = (YaleStar *)malloc(nalloc*sizeof(*ptr));
-
-	if( ptr == NULL )
-	  return 0;
-
-	wrap = ra1 < ra0;
-	if( wrap )
-	    ra1 += 360;
-
-	/* Sample line:
-	 * 1       10        20        30        40        50        60        70        80        90       100       110       120       130       140       150       160       170
-	 * |        |         |         |         |         |         |         |         |         |         |         |         |         |         |         |         |         |
-	 *  372          BD+44  271   7647 37077    I                  011115.6+442231011705.1+445407127.70-17.73 6.34R                     K5                 +0.014-0.045      -052
-	 */
+	block = malloc(STAR_BLOCK * (sizeof(*block) + YALE_NAMELEN));
+	if( block == NULL ) {
+	  fclose(dfile);
+	  fclose(nfile);
+	  return -1;
+	}
+	names = (char *)(block + STAR_BLOCK);
 
 	nidx = -1;
 
 	while( fgets(datbuf, sizeof(datbuf), dfile) != NULL )
 	{
-	    idx = recLong(datbuf, 1,4);
-	    sao = recLong(datbuf, 32,37);
-	    h = recLong(datbuf, 76,77);
-	    m = recLong(datbuf, 78,79);
-	    s = recFloat(datbuf, 80,83);
-	    ra = h*24*60 + m*60 + s;
-	    ra = ra/3600.*(360/24);
-	    d = recLong(datbuf, 84,86);
-	    m = recLong(datbuf, 87,88);
-	    s = recLong(datbuf, 89,90);
-	    dec = d >= 0 ? d*3600. + m*60. + s : d*3600. - m*60. - s;;
-	    dec /= 3600.;
-	    mag = recFloat(datbuf, 103,107);
-
-	    /* We have enough information to apply filter now */
-
-	    if( wrap && ra < ra0 )
-	      ra += 360*60*60;
-
-	    if (dec < d0 || dec > d1 || ra < ra0 || ra > ra1 || mag > maxmag)
+	    if (!yaleFilter(datbuf, maxmag, ra0,ra1, d0,d1, wrap,
+	    		&ra, &dec, &mag))
 		continue;
 
-	    /* Reserve space in the returned array */
-	    if( count >= nalloc ) {
-		nalloc *= 2;
-		ptr = (YaleStar *)realloc(ptr, nalloc*sizeof(*ptr));
-		if( ptr == NULL )
-		  return 0;
-	    }
-
-	    ptr[count].s.ra = ra;
-	    ptr[count].s.dec = dec;
-	    ptr[count].s.mag = mag;
-	    ptr[count].s.epoch = 2000;
-	    ptr[count].s.pmr = recFloat(datbuf, 149,154);
-	    ptr[count].s.pmd = recFloat(datbuf, 155,160);
-	    strcpy(ptr[count].s.type, "SS");
-	    recString(datbuf, 148,148, ptr[count].s.spec);
-	    ptr[count].s.sao = recLong(datbuf, 32,37);
-	    ptr[count].s.name = NULL;
-	    ptr[count].cons[0] = '\0';
-	    ptr[count].yale_cat = idx;
+	    idx = recLong(datbuf, 1,4);
+	    ptr = &block[n];
+	    ptr->s.ra = ra;
+	    ptr->s.dec = dec;
+	    ptr->s.mag = mag;
+	    ptr->s.epoch = 2000;
+	    ptr->s.pmr = recFloat(datbuf, 149,154);
+	    ptr->s.pmd = recFloat(datbuf, 155,160);
+	    strcpy(ptr->s.type, "SS");
+	    recString(datbuf, 128,147, tmp);
+	    ptr->s.spec[0] = tmp[strspn(tmp, " ")];
+	    ptr->s.spec[1] = '\0';
+	    ptr->s.sao = recLong(datbuf, 32,37);
+	    ptr->s.name = NULL;
+	    ptr->yale_cat = idx;
 
 	    /* Fetch data from notes file, if any */
 	    while (nidx < idx) {
@@ -173,7 +244,7 @@ ReadYaleStars(float maxmag, double ra0, double ra1,
 		if (tmp[0] == 'N') {
 		    recString(notebuf, 13,132, tmp);
 		    rstrip(tmp);
-		    ptr[count].s.name = strdup(tmp);
+		    ptr->s.name = strcpy(names + n*YALE_NAMELEN, tmp);
 		}
 		if (fgets(notebuf, sizeof(notebuf), nfile) == NULL) {
 		    nidx = 99999999;
@@ -183,16 +254,517 @@ ReadYaleStars(float maxmag, double ra0, double ra1,
 	    }
 
 	    ++count;
-	  }
+	    if (++n == STAR_BLOCK) {
+		n = 0;
+		yaleCons(block, STAR_BLOCK);
+		if ((*visit)(block, STAR_BLOCK, arg))
+		    break;
+	    }
+	}
+	if (n > 0) {
+	    yaleCons(block, n);
+	    (*visit)(block, n, arg);
+	}
 
-	  fprintf(stderr, "%d stars up to magnitude %.1f\n", count, maxmag);
+	fclose(dfile);
+	fclose(nfile);
+	free(block);
+	return count;
+}
 
-	  fclose(dfile);
-	  fclose(nfile);
+/**
+ * Count the stars that VisitYaleStars() would return.  Only the
+ * data file is read, and only the position and magnitude fields
+ * are parsed, so this is much cheaper than a full read.
+ *
+ * @return number of matching stars, or -1 on error.
+ */
+int
+CountYaleStars(float maxmag, double ra0, double ra1,
+	double d0, double d1, const char *datfilename)
+{
+	char	datbuf[300];
+	FILE	*dfile;
+	double	ra,dec, mag;
+	int	count = 0;
+	int	wrap;
+
+	if( (dfile = yaleOpen(datfilename, ra0, &ra1, &wrap)) == NULL )
+	  return -1;
+
+	while( fgets(datbuf, sizeof(datbuf), dfile) != NULL )
+	    count += yaleFilter(datbuf, maxmag, ra0,ra1, d0,d1, wrap,
+			&ra, &dec, &mag);
+
+	fclose(dfile);
+	return count;
+}
+
+typedef struct {
+	YaleStar *ptr;
+	int	count;
+	int	max;
+} YaleCollector;
+
+static int
+yaleCollect(const YaleStar *stars, int n, void *arg)
+{
+	YaleCollector *c = arg;
+	YaleStar *ptr;
+	int	i;
+
+	if (n > c->max - c->count)
+	    n = c->max - c->count;
+	ptr = c->ptr + c->count;
+	memcpy(ptr, stars, n*sizeof(*stars));
+	for (i=0; i < n; ++i, ++ptr)
+	    if (ptr->s.name != NULL)
+		ptr->s.name = strdup(ptr->s.name);
+	c->count += n;
+	return c->count >= c->max;
+}
+
+/**
+ * Read the Yale Star Catalog (aka Bright Star Catalog) or a
+ * portion thereof.
+ *
+ * @param maxmag - maximum magnitude
+ * @param ra0,ra1 - right ascension bounds
+ * @param d0,d1   - declination bounds
+ * @param datfile - data filename, NULL defaults to "bsc5.dat"
+ * @param notefile - notes filename, NULL defaults to "bsc5.notes"
+ * @param rval     - returned array of YaleStar structs
+ * @param recsize  - returned size of one struct
+ *
+ * @return number of structs returned in rval
+ *
+ * Only returns items inside the box defined by ra0,ra1, d0,d1 and
+ * with magnitude maxmag or less.  A counting pass is made first so
+ * that the returned array is allocated once, at its final size.
+ */
+int
+ReadYaleStars(float maxmag, double ra0, double ra1,
+	double d0, double d1,
+	const char *datfilename,
+	const char *notefilename,
+	YaleStar **rval, size_t *recsize)
+{
+	YaleCollector c;
+
+	*rval = NULL;
+
+	c.max = CountYaleStars(maxmag, ra0, ra1, d0, d1, datfilename);
+	if (c.max < 0)
+	    return 0;
+
+	c.ptr = (YaleStar *)malloc((c.max > 0 ? c.max : 1) * sizeof(*c.ptr));
+	c.count = 0;
+	if (c.ptr == NULL)
+	    return 0;
+
+	if (c.max > 0 &&
+	    VisitYaleStars(maxmag, ra0, ra1, d0, d1,
+		datfilename, notefilename, yaleCollect, &c) < 0)
+	{
+	    free(c.ptr);
+	    return 0;
+	}
+
+	fprintf(stderr, "%d stars up to magnitude %.1f\n", c.count, maxmag);
+
+	*rval = c.ptr;
+	*recsize = sizeof(*c.ptr);
+	return c.count;
+}
+
+/**
+ * Release an array returned by ReadYaleStars(), including the names.
+ */
+void
+FreeYaleStars(YaleStar *stars, int count)
+{
+	int	i;
+
+	if (stars == NULL)
+	    return;
+	for (i=0; i < count; ++i)
+	    free(stars[i].s.name);
+	free(stars);
+}
+
+typedef struct {
+	YaleCatalog *cat;
+	int	max;
+	size_t	poolsize;	/* bytes allocated for cat->names */
+	int	failed;		/* out of memory for the pool */
+} YaleLoader;
+
+static int
+yaleLoad(const YaleStar *stars, int n, void *arg)
+{
+	YaleLoader *l = arg;
+	YaleCatalog *cat = l->cat;
+	YaleStar *ptr;
+	size_t	len;
+	char	*pool;
+	int	i;
+
+	if (n > l->max - cat->count)
+	    n = l->max - cat->count;
+	ptr = cat->stars + cat->count;
+	memcpy(ptr, stars, n*sizeof(*stars));
+	for (i=0; i < n; ++i, ++ptr)
+	{
+	    if (ptr->s.name == NULL)
+		continue;
+	    len = strlen(ptr->s.name) + 1;
+	    if (cat->namesize + len > l->poolsize) {
+		l->poolsize = l->poolsize*2 + len;
+		if ((pool = realloc(cat->names, l->poolsize)) == NULL) {
+		    l->failed = 1;
+		    return 1;
+		}
+		cat->names = pool;
+	    }
+	    memcpy(cat->names + cat->namesize, ptr->s.name, len);
+	    /* The pool may still move; hold the offset for now */
+	    ptr->s.name = (char *)(uintptr_t)(cat->namesize + 1);
+	    cat->namesize += len;
+	}
+	cat->count += n;
+	return cat->count >= l->max;
+}
+
+/**
+ * Read the Yale Star Catalog into a YaleCatalog.  Same arguments
+ * as ReadYaleStars().  The records are allocated as one block sized
+ * by a counting pass, and all names are packed into a single string
+ * pool, so the whole result is two allocations which
+ * FreeYaleCatalog() releases together.
+ *
+ * @return number of stars loaded, or -1 on error.
+ */
+int
+LoadYaleCatalog(float maxmag, double ra0, double ra1,
+	double d0, double d1,
+	const char *datfilename,
+	const char *notefilename,
+	YaleCatalog *cat)
+{
+	YaleLoader l;
+	YaleStar *ptr;
+	int	i;
+
+	cat->stars = NULL;
+	cat->count = 0;
+	cat->names = NULL;
+	cat->namesize = 0;
+
+	l.cat = cat;
+	l.max = CountYaleStars(maxmag, ra0, ra1, d0, d1, datfilename);
+	l.poolsize = 0;
+	l.failed = 0;
+	if (l.max < 0)
+	    return -1;
+
+	cat->stars = (YaleStar *)malloc((l.max > 0 ? l.max : 1) * sizeof(YaleStar));
+	if (cat->stars == NULL)
+	    return -1;
+
+	if ((l.max > 0 &&
+	     VisitYaleStars(maxmag, ra0, ra1, d0, d1,
+		datfilename, notefilename, yaleLoad, &l) < 0) || l.failed)
+	{
+	    FreeYaleCatalog(cat);
+	    return -1;
+	}
+
+	/* Pool is final; convert name offsets to pointers */
+	for (i=0, ptr=cat->stars; i < cat->count; ++i, ++ptr)
+	    if (ptr->s.name != NULL)
+		ptr->s.name = cat->names + ((uintptr_t)ptr->s.name - 1);
+
+	return cat->count;
+}
+
+/**
+ * Release everything owned by a YaleCatalog.
+ */
+void
+FreeYaleCatalog(YaleCatalog *cat)
+{
+	free(cat->stars);
+	free(cat->names);
+	cat->stars = NULL;
+	cat->names = NULL;
+	cat->count = 0;
+	cat->namesize = 0;
+}
+
+/*
+ * Parallel loader.  Both files are mapped and cut into chunks at line
+ * boundaries.  The notes are parsed first, each chunk producing a list
+ * of (Yale #, name) pairs; since the notes file is sorted, the lists
+ * concatenated in chunk order form one sorted index.  The data chunks
+ * are then parsed against that index, each into its own records and
+ * name pool, and finally merged in catalog order.
+ */
 
-	  *rval = ptr;
-	  *recsize = sizeof(*ptr);
-	  return count;
+typedef struct {
+	long	idx;		/* Yale # */
+	const char *text;	/* name, in the mapped notes file */
+	int	len;
+} YaleNote;
+
+typedef struct {
+	float	maxmag;
+	double	ra0, ra1, d0, d1;
+	int	wrap;
+	const YaleNote *notes;
+	int	nnotes;
+} YaleQuery;
+
+static int
+yaleNoteChunk(TextChunk *chunk, void *arg)
+{
+	char	notebuf[200];
+	char	tmp[140];
+	const char *ptr = chunk->start;
+	const char *line;
+	YaleNote *notes = NULL, *p;
+	int	nalloc = 0;
+
+	for (line = ptr; textLine(&ptr, chunk->end, notebuf, sizeof(notebuf));
+	    line = ptr)
+	{
+	    recString(notebuf, 8,11, tmp);
+	    if (tmp[0] != 'N')
+		continue;
+	    if (chunk->count >= nalloc) {
+		nalloc = nalloc > 0 ? nalloc*2 : 256;
+		if ((p = realloc(notes, nalloc*sizeof(*p))) == NULL) {
+		    free(notes);
+		    return 1;
+		}
+		notes = p;
+	    }
+	    recString(notebuf, 13,132, tmp);
+	    rstrip(tmp);
+	    p = &notes[chunk->count++];
+	    p->idx = recLong(notebuf, 2,5);
+	    p->text = line + 12;
+	    p->len = strlen(tmp);
+	}
+	chunk->data = notes;
+	return 0;
+}
+
+/**
+ * Find the name for a Yale #.  As in VisitYaleStars(), if a star has
+ * several name notes the last one wins.
+ */
+static const YaleNote *
+yaleFindNote(const YaleNote *notes, int n, long idx)
+{
+	int	lo = 0, hi = n;		/* first entry > idx */
+
+	while (lo < hi) {
+	    int mid = (lo+hi)/2;
+	    if (notes[mid].idx <= idx)
+		lo = mid+1;
+	    else
+		hi = mid;
+	}
+	return lo > 0 && notes[lo-1].idx == idx ? &notes[lo-1] : NULL;
+}
+
+static int
+yaleDataChunk(TextChunk *chunk, void *arg)
+{
+	const YaleQuery *q = arg;
+	char	datbuf[200];
+	char	tmp[140];
+	const char *ptr = chunk->start;
+	const YaleNote *note;
+	YaleStar *stars = NULL, *s;
+	char	*pool = NULL, *p;
+	size_t	poolsize = 0;
+	int	nalloc = 0;
+	double	ra,dec, mag;
+
+	while (textLine(&ptr, chunk->end, datbuf, sizeof(datbuf)) != NULL)
+	{
+	    if (!yaleFilter(datbuf, q->maxmag, q->ra0,q->ra1, q->d0,q->d1,
+			q->wrap, &ra, &dec, &mag))
+		continue;
+
+	    if (chunk->count >= nalloc) {
+		nalloc = nalloc > 0 ? nalloc*2 : 256;
+		if ((s = realloc(stars, nalloc*sizeof(*s))) == NULL)
+		    goto fail;
+		stars = s;
+	    }
+	    s = &stars[chunk->count++];
+	    s->s.ra = ra;
+	    s->s.dec = dec;
+	    s->s.mag = mag;
+	    s->s.epoch = 2000;
+	    s->s.pmr = recFloat(datbuf, 149,154);
+	    s->s.pmd = recFloat(datbuf, 155,160);
+	    strcpy(s->s.type, "SS");
+	    recString(datbuf, 128,147, tmp);
+	    s->s.spec[0] = tmp[strspn(tmp, " ")];
+	    s->s.spec[1] = '\0';
+	    s->s.sao = recLong(datbuf, 32,37);
+	    s->s.name = NULL;
+	    s->yale_cat = recLong(datbuf, 1,4);
+
+	    note = yaleFindNote(q->notes, q->nnotes, s->yale_cat);
+	    if (note == NULL)
+		continue;
+	    if (chunk->auxsize + note->len + 1 > poolsize) {
+		poolsize = poolsize*2 + note->len + 1;
+		if ((p = realloc(pool, poolsize)) == NULL)
+		    goto fail;
+		pool = p;
+	    }
+	    memcpy(pool + chunk->auxsize, note->text, note->len);
+	    pool[chunk->auxsize + note->len] = '\0';
+	    /* Offset within this chunk's pool, fixed up at merge */
+	    s->s.name = (char *)(uintptr_t)(chunk->auxsize + 1);
+	    chunk->auxsize += note->len + 1;
+	}
+	yaleCons(stars, chunk->count);
+	chunk->data = stars;
+	chunk->aux = pool;
+	return 0;
+
+fail:
+	free(stars);
+	free(pool);
+	chunk->count = 0;
+	chunk->auxsize = 0;
+	return 1;
+}
+
+static void
+freeChunks(TextChunk *chunks, int n)
+{
+	int	i;
+	for (i=0; i < n; ++i) {
+	    free(chunks[i].data);
+	    free(chunks[i].aux);
+	}
+	free(chunks);
+}
+
+/**
+ * Same as LoadYaleCatalog(), but the files are memory-mapped and
+ * parsed on a pool of nthreads threads (numThreads() if nthreads
+ * is 0).  The result is identical, records in catalog order.
+ *
+ * @return number of stars loaded, or -1 on error.
+ */
+int
+LoadYaleCatalogThreads(float maxmag, double ra0, double ra1,
+	double d0, double d1,
+	const char *datfilename,
+	const char *notefilename,
+	int nthreads, YaleCatalog *cat)
+{
+	const char *dat, *notes;
+	size_t	datsize, notesize;
+	TextChunk *dchunks = NULL, *nchunks = NULL;
+	YaleNote *index = NULL;
+	YaleQuery q;
+	YaleStar *ptr;
+	int	nd = 0, nn = 0;
+	int	i, j;
+	int	rval = -1;
+
+	cat->stars = NULL;
+	cat->count = 0;
+	cat->names = NULL;
+	cat->namesize = 0;
+
+	if (datfilename == NULL)
+	    datfilename = "bsc5.dat";
+	if (notefilename == NULL)
+	    notefilename = "bsc5.notes";
+	if (nthreads <= 0)
+	    nthreads = numThreads();
+
+	if ((dat = mapTextFile(datfilename, &datsize)) == NULL)
+	    return -1;
+	if ((notes = mapTextFile(notefilename, &notesize)) == NULL) {
+	    unmapTextFile(dat, datsize);
+	    return -1;
+	}
+
+	/* Several chunks per thread, so a slow chunk doesn't hold up the rest */
+	dchunks = malloc(nthreads*4 * sizeof(*dchunks));
+	nchunks = malloc(nthreads*4 * sizeof(*nchunks));
+	if (dchunks == NULL || nchunks == NULL)
+	    goto done;
+	nd = splitTextChunks(dat, datsize, nthreads*4, dchunks);
+	nn = splitTextChunks(notes, notesize, nthreads*4, nchunks);
+
+	/* Build the notes index */
+	if (runTextChunks(nchunks, nn, nthreads, yaleNoteChunk, NULL) < 0)
+	    goto done;
+	for (i=0, q.nnotes=0; i < nn; ++i)
+	    q.nnotes += nchunks[i].count;
+	if ((index = malloc((q.nnotes > 0 ? q.nnotes : 1) * sizeof(*index))) == NULL)
+	    goto done;
+	for (i=0, j=0; i < nn; j += nchunks[i++].count)
+	    memcpy(index+j, nchunks[i].data, nchunks[i].count*sizeof(*index));
+	q.notes = index;
+
+	/* Parse the data */
+	q.maxmag = maxmag;
+	q.ra0 = ra0;
+	q.ra1 = ra1;
+	q.d0 = d0;
+	q.d1 = d1;
+	q.wrap = ra1 < ra0;
+	if (q.wrap)
+	    q.ra1 += 360;
+	if (runTextChunks(dchunks, nd, nthreads, yaleDataChunk, &q) < 0)
+	    goto done;
+
+	/* Merge */
+	for (i=0; i < nd; ++i) {
+	    cat->count += dchunks[i].count;
+	    cat->namesize += dchunks[i].auxsize;
+	}
+	cat->stars = malloc((cat->count > 0 ? cat->count : 1) * sizeof(YaleStar));
+	cat->names = malloc(cat->namesize > 0 ? cat->namesize : 1);
+	if (cat->stars == NULL || cat->names == NULL) {
+	    FreeYaleCatalog(cat);
+	    goto done;
+	}
+	ptr = cat->stars;
+	for (i=0, cat->namesize=0; i < nd; ++i)
+	{
+	    memcpy(ptr, dchunks[i].data, dchunks[i].count*sizeof(*ptr));
+	    memcpy(cat->names + cat->namesize, dchunks[i].aux, dchunks[i].auxsize);
+	    for (j=0; j < dchunks[i].count; ++j, ++ptr)
+		if (ptr->s.name != NULL)
+		    ptr->s.name = cat->names + cat->namesize +
+				((uintptr_t)ptr->s.name - 1);
+	    cat->namesize += dchunks[i].auxsize;
+	}
+	rval = cat->count;
+
+done:
+	if (dchunks != NULL)
+	    freeChunks(dchunks, nd);
+	if (nchunks != NULL)
+	    freeChunks(nchunks, nn);
+	free(index);
+	unmapTextFile(dat, datsize);
+	unmapTextFile(notes, notesize);
+	return rval;
 }
 
 static void
@@ -209,16 +781,15 @@ rstrip(char *buf)
 int
 main()
 {
-    YaleStar *rval, *ptr;
-    size_t recsize;
+    YaleCatalog cat;
+    YaleStar *ptr;
     int count;
     int i;
 
-    count = ReadYaleStars(5.0, 0., 360., -90, 90.,
-    	"../Yale/bsc5.dat", "../Yale/bsc5.notes",
-	&rval, &recsize);
+    count = LoadYaleCatalog(5.0, 0., 360., -90, 90.,
+    	"../Yale/bsc5.dat", "../Yale/bsc5.notes", &cat);
 
-    ptr = rval;
+    ptr = cat.stars;
     printf("%5s: %8s  %8s  %7s %7s %5s %8s %8s\n",
 	"i", "Yale", "SAO", "RA", "decl", "mag", "pmr", "pmd");
     for (i=0; i < count; ++i) {
@@ -230,6 +801,7 @@ main()
 	++ptr;
     }
 
+    FreeYaleCatalog(&cat);
     return 0;
 }
 #endif	/* STANDALONE */